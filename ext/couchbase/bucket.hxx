@@ -17,11 +17,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <type_traits>
 #include <utility>
 #include <queue>
 
 #include <operations.hxx>
 #include <origin.hxx>
+#include <metrics_registry.hxx>
+#include <orphan_reporter.hxx>
+#include <threshold_logging_tracer.hxx>
 
 namespace couchbase
 {
@@ -30,15 +35,25 @@ class bucket : public std::enable_shared_from_this<bucket>
   public:
     explicit bucket(const std::string& client_id,
                     asio::io_context& ctx,
+                    asio::ssl::context& tls,
                     std::string name,
                     couchbase::origin origin,
-                    const std::vector<protocol::hello_feature>& known_features)
+                    const std::vector<protocol::hello_feature>& known_features,
+                    std::shared_ptr<threshold_logging_tracer> tracer,
+                    std::shared_ptr<orphan_reporter> orphan_reporter,
+                    std::shared_ptr<metrics_registry> metrics,
+                    std::shared_ptr<io::timer_wheel> timers)
 
       : client_id_(client_id)
       , ctx_(ctx)
+      , tls_(tls)
       , name_(std::move(name))
       , origin_(std::move(origin))
       , known_features_(known_features)
+      , tracer_(std::move(tracer))
+      , orphan_reporter_(std::move(orphan_reporter))
+      , metrics_(std::move(metrics))
+      , timers_(std::move(timers))
     {
     }
 
@@ -55,55 +70,124 @@ class bucket : public std::enable_shared_from_this<bucket>
     template<typename Handler>
     void bootstrap(Handler&& handler)
     {
-        auto new_session = std::make_shared<io::mcbp_session>(client_id_, ctx_, origin_, name_, known_features_);
+        auto new_session = make_session(origin_);
         new_session->bootstrap([self = shared_from_this(), new_session, h = std::forward<Handler>(handler)](
                                  std::error_code ec, const configuration& cfg) mutable {
             if (!ec) {
-                self->config_ = cfg;
-                size_t this_index = new_session->index();
-                self->sessions_.emplace(this_index, std::move(new_session));
-                if (cfg.nodes.size() > 1) {
-                    for (const auto& n : cfg.nodes) {
-                        if (n.index != this_index) {
-                            couchbase::origin origin(
-                              self->origin_.get_username(), self->origin_.get_password(), n.hostname, *n.services_plain.key_value);
-                            auto s =
-                              std::make_shared<io::mcbp_session>(self->client_id_, self->ctx_, origin, self->name_, self->known_features_);
-                            s->bootstrap([host = n.hostname, bucket = self->name_](std::error_code err, const configuration& /*config*/) {
-                                // TODO: retry, we know that auth is correct
-                                if (err) {
-                                    spdlog::warn("unable to bootstrap node {} ({}): {}", host, bucket, err.message());
-                                }
-                            });
-                            self->sessions_.emplace(n.index, std::move(s));
-                        }
-                    }
+                {
+                    std::scoped_lock lock(self->sessions_mutex_);
+                    self->sessions_[self->node_key(cfg.nodes.at(new_session->index()))].emplace_back(std::move(new_session));
                 }
-                while (!self->deferred_commands_.empty()) {
-                    self->deferred_commands_.front()();
-                    self->deferred_commands_.pop();
+                self->open_sessions(cfg);
+                {
+                    std::scoped_lock lock(self->config_mutex_);
+                    self->config_ = cfg;
                 }
+            } else {
+                std::scoped_lock lock(self->config_mutex_);
+                self->bootstrap_error_ = ec;
             }
+            // the commands would never get the configuration, if the bootstrap has failed
+            self->drain_deferred_commands(ec);
             h(ec, cfg);
         });
     }
 
+    /**
+     * Applies configuration received by any of the sessions, if it is newer than the current one: opens sessions to the
+     * nodes added by the rebalance, and closes sessions to the nodes that left the cluster.
+     */
+    void update_config(const configuration& config)
+    {
+        if (closed_ || !config.vbmap) {
+            return;
+        }
+        {
+            std::scoped_lock lock(config_mutex_);
+            // until the bootstrap is complete, the configuration is owned by the bootstrap session
+            if (!config_ || config.rev <= config_->rev) {
+                return;
+            }
+        }
+        spdlog::debug(R"(bucket "{}" switches to configuration rev={})", name_, config.rev);
+        open_sessions(config);
+        {
+            std::scoped_lock lock(config_mutex_);
+            if (config.rev <= config_->rev) {
+                return;
+            }
+            config_ = config;
+        }
+        std::vector<std::shared_ptr<io::mcbp_session>> removed{};
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            for (auto it = sessions_.begin(); it != sessions_.end();) {
+                bool found = std::any_of(
+                  config.nodes.begin(), config.nodes.end(), [this, &it](const configuration::node& n) { return node_key(n) == it->first; });
+                if (found) {
+                    ++it;
+                } else {
+                    spdlog::debug(R"(bucket "{}" closes sessions to {}, the node is not in the configuration anymore)", name_, it->first);
+                    removed.insert(removed.end(), it->second.begin(), it->second.end());
+                    reconnects_.erase(it->first);
+                    it = sessions_.erase(it);
+                }
+            }
+        }
+        for (auto& session : removed) {
+            session->stop();
+        }
+    }
+
     template<typename Request, typename Handler>
     void execute(Request request, Handler&& handler)
     {
         if (closed_) {
             return;
         }
-        auto cmd = std::make_shared<operations::mcbp_command<Request>>(ctx_, request);
-        cmd->start([cmd, handler = std::forward<Handler>(handler)](std::error_code ec, std::optional<io::mcbp_message> msg) mutable {
+        auto cmd = std::make_shared<operations::mcbp_command<Request>>(timers_, std::move(request));
+        cmd->router_ = [self = weak_from_this()](std::shared_ptr<operations::mcbp_command<Request>> command) {
+            if (auto bucket = self.lock(); bucket && !bucket->closed_) {
+                return bucket->map_and_send(command);
+            }
+            command->invoke_handler(std::make_error_code(error::common_errc::request_canceled));
+        };
+        cmd->start([cmd, tracer = tracer_, handler = std::forward<Handler>(handler)](std::error_code ec,
+                                                                                    std::optional<io::mcbp_message> msg) mutable {
             using encoded_response_type = typename Request::encoded_response_type;
-            handler(make_response(ec, cmd->request, msg ? encoded_response_type(*msg) : encoded_response_type{}));
+            encoded_response_type encoded = msg ? encoded_response_type(*msg) : encoded_response_type{};
+            if (msg && encoded.info().server_duration_us > 0) {
+                cmd->timings.server_duration = std::chrono::microseconds(static_cast<std::int64_t>(encoded.info().server_duration_us));
+            }
+            auto response = make_response(ec, cmd->request, std::move(encoded));
+            response.timings = cmd->timings;
+            response.timings.decoded = std::chrono::steady_clock::now();
+            record_metrics(*cmd, response.timings, ec);
+            if (tracer) {
+                report_to_tracer(*tracer, *cmd, response.timings);
+            }
+            handler(std::move(response));
         });
-        if (config_) {
-            map_and_send(cmd);
-        } else {
-            deferred_commands_.emplace([self = shared_from_this(), cmd]() { self->map_and_send(cmd); });
+        std::error_code bootstrap_error{};
+        {
+            std::scoped_lock lock(config_mutex_);
+            if (!config_) {
+                bootstrap_error = bootstrap_error_;
+                if (!bootstrap_error) {
+                    deferred_commands_.emplace([self = shared_from_this(), cmd](std::error_code ec) {
+                        if (ec) {
+                            return cmd->invoke_handler(ec);
+                        }
+                        self->map_and_send(cmd);
+                    });
+                    return;
+                }
+            }
         }
+        if (bootstrap_error) {
+            return cmd->invoke_handler(bootstrap_error);
+        }
+        map_and_send(cmd);
     }
 
     void close()
@@ -112,32 +196,352 @@ class bucket : public std::enable_shared_from_this<bucket>
             return;
         }
         closed_ = true;
-        for (auto& session : sessions_) {
-            session.second->stop();
+        drain_deferred_commands(std::make_error_code(error::common_errc::request_canceled));
+        std::scoped_lock lock(sessions_mutex_);
+        for (auto& [index, pool] : sessions_) {
+            for (auto& session : pool) {
+                session->stop();
+            }
         }
     }
 
     template<typename Request>
     void map_and_send(std::shared_ptr<operations::mcbp_command<Request>> cmd)
     {
-        size_t index = 0;
-        std::tie(cmd->request.partition, index) = config_->map_key(cmd->request.id.key);
-        auto session = sessions_.at(index);
+        std::string key{};
+        std::uint64_t rev = 0;
+        {
+            std::scoped_lock lock(config_mutex_);
+            std::optional<std::size_t> index{};
+            std::tie(cmd->request.partition, index) = config_->map_key(cmd->request.id.key, node_index(cmd->request));
+            if (index) {
+                key = node_key(config_->nodes.at(index.value()));
+                rev = config_->rev;
+            }
+        }
+        if (key.empty()) {
+            // the replica has not been assigned to any node (e.g. failover without rebalance)
+            return cmd->invoke_handler(std::make_error_code(error::key_value_errc::document_irretrievable));
+        }
+        std::shared_ptr<io::mcbp_session> session{};
+        bool has_dead_sessions = false;
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            // pick the connection with the least number of outstanding operations, so that the command does not wait
+            // behind large values being transferred by the other connections
+            if (auto pool = sessions_.find(key); pool != sessions_.end()) {
+                // stopped sessions report no outstanding operations, so they have to be removed before the selection
+                auto dead = std::remove_if(pool->second.begin(), pool->second.end(), [](const auto& s) { return s->is_stopped(); });
+                has_dead_sessions = dead != pool->second.end();
+                pool->second.erase(dead, pool->second.end());
+                // sessions, that are still bootstrapping, report no outstanding operations either, but the command would
+                // wait in their buffer (and get canceled if the bootstrap fails), so they are used only as the last resort
+                auto best = std::min_element(pool->second.begin(), pool->second.end(), [](const auto& a, const auto& b) {
+                    return std::make_pair(!a->is_bootstrapped(), a->outstanding_operations()) <
+                           std::make_pair(!b->is_bootstrapped(), b->outstanding_operations());
+                });
+                if (best != pool->second.end()) {
+                    session = *best;
+                }
+            }
+        }
+        if (has_dead_sessions) {
+            schedule_reconnect(key);
+        }
+        if (!session) {
+            {
+                std::scoped_lock lock(config_mutex_);
+                if (config_->rev == rev) {
+                    spdlog::warn(R"(bucket "{}" has no sessions to {}, rev={})", name_, key, rev);
+                    rev = 0;
+                }
+            }
+            if (rev == 0) {
+                return cmd->invoke_handler(std::make_error_code(error::network_errc::configuration_not_available));
+            }
+            // the node has been removed by the newer configuration while the command was being mapped
+            return map_and_send(cmd);
+        }
         cmd->send_to(session);
     }
 
+    /**
+     * Invokes handler with the current configuration, or defers it until the bucket is bootstrapped. If the bootstrap fails
+     * or the bucket gets closed in the meantime, the handler receives the error. The caller is responsible for the deadline.
+     */
+    template<typename Handler>
+    void with_configuration(Handler&& handler)
+    {
+        std::optional<configuration> config{};
+        std::error_code bootstrap_error{};
+        {
+            std::scoped_lock lock(config_mutex_);
+            if (!config_) {
+                bootstrap_error = bootstrap_error_;
+                if (!bootstrap_error) {
+                    deferred_commands_.emplace(
+                      [self = shared_from_this(), handler = std::forward<Handler>(handler)](std::error_code ec) mutable {
+                          if (ec) {
+                              return handler(ec, configuration{});
+                          }
+                          std::optional<configuration> cfg{};
+                          {
+                              std::scoped_lock config_lock(self->config_mutex_);
+                              cfg = self->config_;
+                          }
+                          handler(std::error_code{}, cfg.value());
+                      });
+                    return;
+                }
+            }
+            config = config_;
+        }
+        if (bootstrap_error) {
+            return handler(bootstrap_error, configuration{});
+        }
+        handler(std::error_code{}, config.value());
+    }
+
   private:
+    void drain_deferred_commands(std::error_code ec)
+    {
+        std::queue<std::function<void(std::error_code)>> commands{};
+        {
+            std::scoped_lock lock(config_mutex_);
+            std::swap(commands, deferred_commands_);
+        }
+        while (!commands.empty()) {
+            commands.front()(ec);
+            commands.pop();
+        }
+    }
+
+    template<typename Request>
+    static void record_metrics(const operations::mcbp_command<Request>& cmd, const operation_timings& timings, std::error_code ec)
+    {
+        if (!cmd.session_ || !cmd.session_->metrics()) {
+            // the command has not been dispatched to any node
+            return;
+        }
+        auto& metrics = *cmd.session_->metrics();
+        metrics.key_value(Request::encoded_request_type::body_type::opcode)
+          .record(std::chrono::duration_cast<std::chrono::microseconds>(timings.decoded - timings.queued));
+        if (ec == error::common_errc::ambiguous_timeout || ec == error::common_errc::unambiguous_timeout) {
+            ++metrics.timeouts;
+        }
+    }
+
+    template<typename Request>
+    static void report_to_tracer(threshold_logging_tracer& tracer,
+                                 const operations::mcbp_command<Request>& cmd,
+                                 const operation_timings& timings)
+    {
+        auto total = std::chrono::duration_cast<std::chrono::microseconds>(timings.decoded - timings.queued);
+        if (!tracer.exceeds_threshold(service_type::kv, total)) {
+            return;
+        }
+        threshold_logging_tracer::span span{ fmt::format("{}", Request::encoded_request_type::body_type::opcode), total };
+        if (cmd.opaque_) {
+            span.operation_id = fmt::format("0x{:x}", cmd.opaque_.value());
+        }
+        span.document_id = cmd.request.id.key;
+        if (cmd.session_) {
+            span.remote_socket = cmd.session_->remote_address();
+        }
+        span.timings = timings;
+        tracer.report(service_type::kv, std::move(span));
+    }
+
+    template<typename Request>
+    static std::size_t node_index(const Request& request)
+    {
+        if constexpr (std::is_same_v<Request, operations::get_replica_request>) {
+            return request.replica_index;
+        }
+        return 0;
+    }
+
+    std::shared_ptr<io::mcbp_session> make_session(const couchbase::origin& origin)
+    {
+        std::shared_ptr<io::mcbp_session> session{};
+        if (origin.options().enable_tls) {
+            session = std::make_shared<io::mcbp_session>(client_id_, ctx_, tls_, origin, name_, known_features_);
+        } else {
+            session = std::make_shared<io::mcbp_session>(client_id_, ctx_, origin, name_, known_features_);
+        }
+        session->report_orphans_to(orphan_reporter_);
+        session->collect_metrics_to(metrics_);
+        session->on_configuration_update([self = weak_from_this()](const configuration& config) {
+            if (auto bucket = self.lock()) {
+                bucket->update_config(config);
+            }
+        });
+        return session;
+    }
+
+    /**
+     * Node indexes are not stable across rebalances, so the pools are keyed by the address of the KV service.
+     */
+    [[nodiscard]] std::string node_key(const configuration::node& node) const
+    {
+        auto port = origin_.options().enable_tls ? node.services_tls.key_value : node.services_plain.key_value;
+        return fmt::format("{}:{}", node.hostname, port.value_or(0));
+    }
+
+    /**
+     * Fills the pools of the nodes in the configuration up to the configured size.
+     */
+    void open_sessions(const configuration& config)
+    {
+        for (const auto& n : config.nodes) {
+            open_node_sessions(n);
+        }
+    }
+
+    void open_node_sessions(const configuration::node& n)
+    {
+        const auto& options = origin_.options();
+        auto port = options.enable_tls ? n.services_tls.key_value : n.services_plain.key_value;
+        if (!port) {
+            return;
+        }
+        auto key = node_key(n);
+        std::vector<std::shared_ptr<io::mcbp_session>> new_sessions{};
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            // the pool of the bootstrap node already has the bootstrap session
+            auto& pool = sessions_[key];
+            while (pool.size() < options.kv_pool_size) {
+                couchbase::origin origin(origin_.get_username(), origin_.get_password(), n.hostname, *port);
+                origin.options(options);
+                new_sessions.emplace_back(make_session(origin));
+                pool.emplace_back(new_sessions.back());
+            }
+        }
+        for (auto& s : new_sessions) {
+            s->bootstrap([self = weak_from_this(), key, session = std::weak_ptr<io::mcbp_session>(s)](std::error_code err,
+                                                                                                      const configuration& /*config*/) {
+                auto bucket = self.lock();
+                if (!bucket) {
+                    return;
+                }
+                if (!err) {
+                    std::scoped_lock lock(bucket->sessions_mutex_);
+                    bucket->reconnects_[key].attempts = 0;
+                    return;
+                }
+                spdlog::warn(R"(unable to bootstrap session to {} for bucket "{}": {})", key, bucket->name_, err.message());
+                bucket->remove_session(key, session.lock());
+                if (err == error::common_errc::request_canceled) {
+                    // the session has been stopped by the bucket
+                    return;
+                }
+                if (err == error::common_errc::authentication_failure || err == error::common_errc::bucket_not_found) {
+                    // reconnecting will not help, the pool will be refilled with the next configuration
+                    return;
+                }
+                bucket->schedule_reconnect(key);
+            });
+        }
+    }
+
+    void remove_session(const std::string& key, const std::shared_ptr<io::mcbp_session>& session)
+    {
+        std::scoped_lock lock(sessions_mutex_);
+        if (auto pool = sessions_.find(key); pool != sessions_.end()) {
+            pool->second.erase(std::remove(pool->second.begin(), pool->second.end(), session), pool->second.end());
+        }
+    }
+
+    /**
+     * Refills the pool of the node, that lost its sessions, after the backoff. The backoff grows exponentially with the
+     * number of failed attempts, so that the node refusing connections does not get flooded with them, and is reset once
+     * any session to the node completes the bootstrap.
+     */
+    void schedule_reconnect(const std::string& key)
+    {
+        if (closed_) {
+            return;
+        }
+        std::chrono::milliseconds delay{};
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            auto& state = reconnects_[key];
+            if (state.scheduled) {
+                return;
+            }
+            state.scheduled = true;
+            delay = std::min(reconnect_backoff_max, reconnect_backoff_min * (1U << std::min(state.attempts, 7U)));
+            ++state.attempts;
+        }
+        spdlog::debug(R"(bucket "{}" will reconnect to {} in {}ms)", name_, key, delay.count());
+        timers_->schedule_after(delay, [self = weak_from_this(), key](std::error_code ec) {
+            auto bucket = self.lock();
+            if (!bucket) {
+                return;
+            }
+            {
+                std::scoped_lock lock(bucket->sessions_mutex_);
+                if (auto state = bucket->reconnects_.find(key); state != bucket->reconnects_.end()) {
+                    state->second.scheduled = false;
+                }
+            }
+            if (!ec && !bucket->closed_) {
+                bucket->reconnect(key);
+            }
+        });
+    }
+
+    void reconnect(const std::string& key)
+    {
+        std::optional<configuration::node> node{};
+        {
+            std::scoped_lock lock(config_mutex_);
+            if (config_) {
+                auto it = std::find_if(
+                  config_->nodes.begin(), config_->nodes.end(), [this, &key](const configuration::node& n) { return node_key(n) == key; });
+                if (it != config_->nodes.end()) {
+                    node = *it;
+                }
+            }
+        }
+        if (!node) {
+            // the node has left the cluster in the meantime
+            std::scoped_lock lock(sessions_mutex_);
+            reconnects_.erase(key);
+            return;
+        }
+        open_node_sessions(node.value());
+    }
+
     std::string client_id_;
     asio::io_context& ctx_;
+    asio::ssl::context& tls_;
     std::string name_;
     origin origin_;
 
     std::optional<configuration> config_{};
     std::vector<protocol::hello_feature> known_features_;
+    std::shared_ptr<threshold_logging_tracer> tracer_;
+    std::shared_ptr<orphan_reporter> orphan_reporter_;
+    std::shared_ptr<metrics_registry> metrics_;
+    std::shared_ptr<io::timer_wheel> timers_;
+
+    std::error_code bootstrap_error_{};
+    std::queue<std::function<void(std::error_code)>> deferred_commands_{};
+    std::mutex config_mutex_{}; // protects config_, bootstrap_error_ and deferred_commands_
+
+    struct reconnect_state {
+        std::uint32_t attempts{ 0 };
+        bool scheduled{ false };
+    };
 
-    std::queue<std::function<void()>> deferred_commands_{};
+    static constexpr std::chrono::milliseconds reconnect_backoff_min{ 100 };
+    static constexpr std::chrono::milliseconds reconnect_backoff_max{ 10'000 };
 
-    bool closed_{ false };
-    std::map<size_t, std::shared_ptr<io::mcbp_session>> sessions_{};
+    std::atomic_bool closed_{ false };
+    std::map<std::string, std::vector<std::shared_ptr<io::mcbp_session>>> sessions_{}; // keyed by node_key()
+    std::map<std::string, reconnect_state> reconnects_{};                              // keyed by node_key()
+    std::mutex sessions_mutex_{};                                                      // protects sessions_ and reconnects_
 };
 } // namespace couchbase
@@ -23,10 +23,15 @@
 #include <io/mcbp_session.hxx>
 #include <io/http_session_manager.hxx>
 #include <io/http_command.hxx>
+#include <io/timer_wheel.hxx>
 #include <origin.hxx>
 #include <bucket.hxx>
 #include <operations.hxx>
 #include <operations/document_query.hxx>
+#include <query_cache.hxx>
+#include <threshold_logging_tracer.hxx>
+#include <orphan_reporter.hxx>
+#include <metrics_registry.hxx>
 
 namespace couchbase
 {
@@ -37,7 +42,8 @@ class cluster
       : id_(uuid::to_string(uuid::random()))
       , ctx_(ctx)
       , work_(asio::make_work_guard(ctx_))
-      , session_manager_(std::make_shared<io::http_session_manager>(id_, ctx_))
+      , session_manager_(std::make_shared<io::http_session_manager>(id_, ctx_, tls_))
+      , timers_(std::make_shared<io::timer_wheel>(ctx_))
     {
     }
 
@@ -45,10 +51,25 @@ class cluster
     void open(const couchbase::origin& origin, Handler&& handler)
     {
         origin_ = origin;
-        session_ = std::make_shared<io::mcbp_session>(id_, ctx_, origin_);
+        query_cache_.capacity(origin_.options().query_prepared_cache_size);
+        tracer_ = std::make_shared<threshold_logging_tracer>(ctx_, origin_.options());
+        tracer_->start();
+        orphan_reporter_ = std::make_shared<orphan_reporter>(ctx_, origin_.options());
+        orphan_reporter_->start();
+        if (origin_.options().enable_tls) {
+            if (auto ec = configure_tls(); ec) {
+                return handler(ec);
+            }
+            session_ = std::make_shared<io::mcbp_session>(id_, ctx_, tls_, origin_);
+        } else {
+            session_ = std::make_shared<io::mcbp_session>(id_, ctx_, origin_);
+        }
+        session_->report_orphans_to(orphan_reporter_);
+        session_->collect_metrics_to(metrics_);
+        session_manager_->collect_metrics_to(metrics_);
         session_->bootstrap([this, handler = std::forward<Handler>(handler)](std::error_code ec, const configuration& config) mutable {
             if (!ec) {
-                session_manager_->set_configuration(config);
+                session_manager_->set_configuration(config, origin_);
             }
             handler(ec);
         });
@@ -61,9 +82,18 @@ class cluster
             if (session_) {
                 session_->stop();
             }
+            session_manager_->close();
+            std::scoped_lock lock(buckets_mutex_);
             for (auto& bucket : buckets_) {
                 bucket.second->close();
             }
+            if (tracer_) {
+                tracer_->stop();
+            }
+            if (orphan_reporter_) {
+                orphan_reporter_->stop();
+            }
+            timers_->stop();
             handler();
             work_.reset();
         }));
@@ -76,47 +106,236 @@ class cluster
         if (session_ && session_->has_config()) {
             known_features = session_->supported_features();
         }
-        auto b = std::make_shared<bucket>(id_, ctx_, bucket_name, origin_, known_features);
+        auto b = std::make_shared<bucket>(
+          id_, ctx_, tls_, bucket_name, origin_, known_features, tracer_, orphan_reporter_, metrics_, timers_);
         b->bootstrap([this, handler = std::forward<Handler>(handler)](std::error_code ec, const configuration& config) mutable {
             if (!ec && !session_->supports_gcccp()) {
-                session_manager_->set_configuration(config);
+                session_manager_->set_configuration(config, origin_);
             }
             handler(ec);
         });
+        std::scoped_lock lock(buckets_mutex_);
         buckets_.emplace(bucket_name, b);
     }
 
     template<class Request, class Handler>
     void execute(Request request, Handler&& handler)
     {
-        auto bucket = buckets_.find(request.id.bucket);
-        if (bucket == buckets_.end()) {
+        std::shared_ptr<bucket> b{};
+        {
+            std::scoped_lock lock(buckets_mutex_);
+            auto bucket = buckets_.find(request.id.bucket);
+            if (bucket != buckets_.end()) {
+                b = bucket->second;
+            }
+        }
+        if (!b) {
             return handler(operations::make_response(std::make_error_code(error::common_errc::bucket_not_found), request, {}));
         }
-        return bucket->second->execute(request, std::forward<Handler>(handler));
+        return b->execute(std::move(request), std::forward<Handler>(handler));
+    }
+
+    template<class Handler>
+    void with_bucket_configuration(const std::string& bucket_name, Handler&& handler)
+    {
+        std::shared_ptr<bucket> b{};
+        {
+            std::scoped_lock lock(buckets_mutex_);
+            auto bucket = buckets_.find(bucket_name);
+            if (bucket != buckets_.end()) {
+                b = bucket->second;
+            }
+        }
+        if (!b) {
+            return handler(std::make_error_code(error::common_errc::bucket_not_found), configuration{});
+        }
+        return b->with_configuration(std::forward<Handler>(handler));
     }
 
     template<class Request, class Handler>
     void execute_http(Request request, Handler&& handler)
     {
-        auto session = session_manager_->check_out(Request::type, origin_.get_username(), origin_.get_password());
-        if (!session) {
-            return handler(operations::make_response(std::make_error_code(error::common_errc::service_not_available), request, {}));
+        send_http(std::move(request), std::forward<Handler>(handler));
+    }
+
+    /**
+     * Non-adhoc queries are executed as prepared statements. The statement is prepared on its first execution, and the
+     * client keeps the name and the plan, so that the query service does not have to plan it again for every request.
+     * When the service does not recognize the prepared statement anymore, it is prepared again.
+     */
+    template<class Handler>
+    void execute_http(operations::query_request request, Handler&& handler)
+    {
+        if (request.adhoc || request.prepared) {
+            return send_http(std::move(request), std::forward<Handler>(handler));
         }
-        auto cmd = std::make_shared<operations::http_command<Request>>(ctx_, request);
-        cmd->send_to(session, [this, session, handler = std::forward<Handler>(handler)](typename Request::response_type resp) mutable {
-            handler(std::move(resp));
-            session_manager_->check_in(Request::type, session);
-        });
+        auto prepared = query_cache_.get(request.statement);
+        if (!prepared) {
+            return prepare_and_execute(std::move(request), std::forward<Handler>(handler));
+        }
+        request.prepared = std::move(prepared);
+        auto start = std::chrono::steady_clock::now();
+        auto retry_request = request;
+        send_http(std::move(request),
+                  [this, start, request = std::move(retry_request), handler = std::forward<Handler>(handler)](
+                    operations::query_response resp) mutable {
+                      if (resp.ec != error::query_errc::prepared_statement_failure) {
+                          return handler(std::move(resp));
+                      }
+                      spdlog::debug("[{}]: prepared statement \"{}\" has been rejected, preparing it again", id_, request.prepared->name);
+                      query_cache_.erase(request.statement);
+                      request.prepared.reset();
+                      auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                      request.timeout = std::max(request.timeout - spent, std::chrono::milliseconds(1));
+                      prepare_and_execute(std::move(request), std::move(handler));
+                  });
+    }
+
+    /**
+     * Timer wheel of the cluster, for the deadlines of the operations composed of several requests
+     */
+    [[nodiscard]] const std::shared_ptr<io::timer_wheel>& timers() const
+    {
+        return timers_;
+    }
+
+    /**
+     * Snapshot of the metrics collected for every node of the cluster
+     *
+     * @param reset whether the metrics have to be discarded after reading
+     */
+    std::map<std::string, node_metrics::snapshot> metrics(bool reset)
+    {
+        return metrics_->take_snapshot(reset);
     }
 
   private:
+    template<class Handler>
+    void prepare_and_execute(operations::query_request request, Handler&& handler)
+    {
+        operations::query_request prepare{};
+        prepare.statement = fmt::format("PREPARE {}", request.statement);
+        prepare.timeout = request.timeout;
+        auto start = std::chrono::steady_clock::now();
+        send_http(std::move(prepare),
+                  [this, start, request = std::move(request), handler = std::forward<Handler>(handler)](
+                    operations::query_response resp) mutable {
+                      if (resp.ec == error::common_errc::unambiguous_timeout || resp.ec == error::common_errc::ambiguous_timeout) {
+                          return handler(operations::make_response(resp.ec, request, {}));
+                      }
+                      if (!resp.ec && !resp.payload.rows.empty()) {
+                          try {
+                              auto row = tao::json::from_string(resp.payload.rows.front());
+                              query_cache::entry entry{ row.at("name").get_string() };
+                              if (const auto* plan = row.find("encoded_plan"); plan != nullptr && plan->is_string()) {
+                                  entry.encoded_plan = plan->get_string();
+                              }
+                              query_cache_.put(request.statement, entry);
+                              request.prepared.emplace(std::move(entry));
+                          } catch (const std::exception& e) {
+                              spdlog::warn("[{}]: unable to parse result of PREPARE: {}", id_, e.what());
+                          }
+                      }
+                      if (!request.prepared) {
+                          // the statement is executed as adhoc, so the application receives the error of the statement itself
+                          request.adhoc = true;
+                      }
+                      auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                      request.timeout = std::max(request.timeout - spent, std::chrono::milliseconds(1));
+                      send_http(std::move(request), std::move(handler));
+                  });
+    }
+
+    template<class Request, class Handler>
+    void send_http(Request request, Handler&& handler)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto timeout = request.timeout;
+        session_manager_->check_out(
+          Request::type,
+          timeout,
+          [this, start, request = std::move(request), handler = std::forward<Handler>(handler)](
+            std::error_code ec, std::shared_ptr<io::http_session> session) mutable {
+              if (ec) {
+                  return handler(operations::make_response(ec, request, {}));
+              }
+              // time spent waiting for the connection is a part of the request timeout
+              auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+              request.timeout = std::max(request.timeout - waited, std::chrono::milliseconds(1));
+              auto cmd = std::make_shared<operations::http_command<Request>>(timers_, request);
+              cmd->send_to(
+                session, [this, start, cmd, session, handler = std::move(handler)](typename Request::response_type resp) mutable {
+                    auto total = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                    if (const auto& metrics = session->metrics(); metrics) {
+                        metrics->http(Request::type).record(total);
+                        if (resp.ec == error::common_errc::unambiguous_timeout || resp.ec == error::common_errc::ambiguous_timeout) {
+                            ++metrics->timeouts;
+                        }
+                    }
+                    report_to_tracer(*cmd, *session, total);
+                    handler(std::move(resp));
+                    session_manager_->check_in(Request::type, session);
+                });
+          });
+    }
+
+    template<class Request>
+    void report_to_tracer(const operations::http_command<Request>& cmd,
+                          const io::http_session& session,
+                          std::chrono::microseconds total)
+    {
+        if (!tracer_ || !tracer_->exceeds_threshold(Request::type, total)) {
+            return;
+        }
+        threshold_logging_tracer::span span{ fmt::format("{} {}", cmd.encoded.method, cmd.encoded.path), total };
+        span.operation_id = cmd.request.client_context_id;
+        span.remote_socket = fmt::format("{}:{}", session.hostname(), session.service());
+        tracer_->report(Request::type, std::move(span));
+    }
+
+    std::error_code configure_tls()
+    {
+        const auto& options = origin_.options();
+        std::error_code ec{};
+        tls_.set_options(asio::ssl::context::default_workarounds | asio::ssl::context::no_sslv2 | asio::ssl::context::no_sslv3, ec);
+        if (ec) {
+            spdlog::error("[{}]: unable to configure TLS options: {}", id_, ec.message());
+            return ec;
+        }
+        if (options.tls_verify == tls_verify_mode::none) {
+            tls_.set_verify_mode(asio::ssl::verify_none, ec);
+        } else {
+            tls_.set_verify_mode(asio::ssl::verify_peer, ec);
+            if (!ec) {
+                if (options.trust_certificate.empty()) {
+                    tls_.set_default_verify_paths(ec);
+                } else {
+                    tls_.load_verify_file(options.trust_certificate, ec);
+                }
+            }
+        }
+        if (ec) {
+            spdlog::error("[{}]: unable to configure TLS certificate verification: {}", id_, ec.message());
+            return ec;
+        }
+        tls_sessions_.attach(tls_.native_handle());
+        return {};
+    }
+
     std::string id_;
     asio::io_context& ctx_;
     asio::executor_work_guard<asio::io_context::executor_type> work_;
+    io::tls_session_cache tls_sessions_{}; // declared before tls_, because the context refers to the cache
+    asio::ssl::context tls_{ asio::ssl::context::tls_client };
     std::shared_ptr<io::http_session_manager> session_manager_;
+    std::shared_ptr<io::timer_wheel> timers_;
     std::shared_ptr<io::mcbp_session> session_{};
     std::map<std::string, std::shared_ptr<bucket>> buckets_{};
+    std::mutex buckets_mutex_{};
     couchbase::origin origin_{};
+    query_cache query_cache_{};
+    std::shared_ptr<threshold_logging_tracer> tracer_{};
+    std::shared_ptr<orphan_reporter> orphan_reporter_{};
+    std::shared_ptr<metrics_registry> metrics_{ std::make_shared<metrics_registry>() };
 };
 } // namespace couchbase
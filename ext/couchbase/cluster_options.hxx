@@ -0,0 +1,121 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace couchbase
+{
+enum class tls_verify_mode {
+    none,
+    peer,
+};
+
+/**
+ * Tunables, that could be specified in the connection string parameters.
+ */
+struct cluster_options {
+    /**
+     * Number of threads running IO context of the backend, at most 256 (connection string parameter "io_threads").
+     */
+    std::size_t io_threads{ 1 };
+
+    /**
+     * Number of KV connections opened to each node of the bucket, at most 64 (connection string parameter
+     * "kv_pool_size").
+     */
+    std::size_t kv_pool_size{ 1 };
+
+    /**
+     * Whether the connections have to be secured with TLS (schemes "couchbases" and "https").
+     */
+    bool enable_tls{ false };
+
+    /**
+     * Path to the PEM file with certificates of trusted authorities (connection string parameter "trust_certificate").
+     * When empty, the default verification paths of OpenSSL are used.
+     */
+    std::string trust_certificate{};
+
+    /**
+     * Verification of the server certificate (connection string parameter "tls_verify", "peer" or "none").
+     */
+    tls_verify_mode tls_verify{ tls_verify_mode::peer };
+
+    /**
+     * Maximum number of HTTP connections to each node per service, 0 means unlimited (connection string parameter
+     * "max_http_connections"). When the limit is reached, requests wait for the connection to be returned to the pool.
+     */
+    std::size_t max_http_connections{ 0 };
+
+    /**
+     * Idle HTTP connections are closed after this period (connection string parameter "idle_http_connection_timeout", in
+     * milliseconds).
+     */
+    std::chrono::milliseconds idle_http_connection_timeout{ 4500 };
+
+    /**
+     * Number of HTTP connections opened in advance to each node per service (connection string parameter
+     * "http_pool_prewarm"). These connections are not closed by idle eviction.
+     */
+    std::size_t http_pool_prewarm{ 0 };
+
+    /**
+     * Maximum number of prepared N1QL statements kept by the client (connection string parameter
+     * "query_prepared_cache_size"). Only the queries with adhoc=false are prepared.
+     */
+    std::size_t query_prepared_cache_size{ 5000 };
+
+    /**
+     * Operations slower than these thresholds are reported by the threshold logging tracer (connection string parameters
+     * "tracing_threshold_kv", "tracing_threshold_query", "tracing_threshold_view", "tracing_threshold_search" and
+     * "tracing_threshold_analytics", in milliseconds).
+     */
+    std::chrono::milliseconds tracing_threshold_kv{ 500 };
+    std::chrono::milliseconds tracing_threshold_query{ 1000 };
+    std::chrono::milliseconds tracing_threshold_view{ 1000 };
+    std::chrono::milliseconds tracing_threshold_search{ 1000 };
+    std::chrono::milliseconds tracing_threshold_analytics{ 1000 };
+
+    /**
+     * Maximum number of the slowest operations of each service included into the report (connection string parameter
+     * "tracing_threshold_sample_size").
+     */
+    std::size_t tracing_threshold_sample_size{ 10 };
+
+    /**
+     * Interval between the reports of the threshold logging tracer (connection string parameter
+     * "tracing_threshold_emit_interval", in milliseconds).
+     */
+    std::chrono::milliseconds tracing_threshold_emit_interval{ 10'000 };
+
+    /**
+     * Maximum number of the orphaned responses included into the report (connection string parameter
+     * "tracing_orphaned_sample_size").
+     */
+    std::size_t tracing_orphaned_sample_size{ 64 };
+
+    /**
+     * Interval between the reports of the orphaned responses (connection string parameter
+     * "tracing_orphaned_emit_interval", in milliseconds).
+     */
+    std::chrono::milliseconds tracing_orphaned_emit_interval{ 10'000 };
+};
+} // namespace couchbase
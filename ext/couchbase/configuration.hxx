@@ -74,14 +74,23 @@ struct configuration {
         throw std::runtime_error("no nodes marked as this_node");
     }
 
-    std::pair<uint16_t, size_t> map_key(const std::string& key)
+    /**
+     * @param node_index position in the chain of the partition, zero is the active node, the rest are replicas
+     *
+     * @return partition of the key and index of the node, the node is empty if the copy is not available
+     */
+    std::pair<uint16_t, std::optional<std::size_t>> map_key(const std::string& key, std::size_t node_index = 0)
     {
         if (!vbmap.has_value()) {
             throw std::runtime_error("cannot map key: partition map is not available");
         }
         uint32_t crc = utils::hash_crc32(key.data(), key.size());
         uint16_t vbucket = uint16_t(crc % vbmap->size());
-        return std::make_pair(vbucket, static_cast<std::size_t>(vbmap->at(vbucket)[0]));
+        const auto& chain = vbmap->at(vbucket);
+        if (node_index >= chain.size() || chain[node_index] < 0) {
+            return { vbucket, {} };
+        }
+        return std::make_pair(vbucket, static_cast<std::size_t>(chain[node_index]));
     }
 };
 
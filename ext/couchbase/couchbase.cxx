@@ -15,6 +15,11 @@
  *   limitations under the License.
  */
 
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <type_traits>
+
 #include <openssl/crypto.h>
 #include <asio/version.hpp>
 
@@ -33,6 +38,7 @@
 #include <utils/connection_string.hxx>
 
 #include <ruby.h>
+#include <ruby/thread.h>
 #if defined(HAVE_RUBY_VERSION_H)
 #include <ruby/version.h>
 #endif
@@ -92,31 +98,114 @@ init_versions(VALUE mCouchbase)
                  std::string_view(RSTRING_PTR(version_info), static_cast<std::size_t>(RSTRING_LEN(version_info))));
 }
 
+struct cb_completion_queue;
+
+/**
+ * Shared state of the operation started by one of the *_async methods.
+ *
+ * The IO thread only stores the response and signals completion. Conversion of the response into Ruby objects requires
+ * GVL, so it is deferred until the application asks for the result or the callback is about to be invoked.
+ */
+struct cb_completion {
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    bool completed{ false };
+    std::function<VALUE(VALUE&)> extract_result{};
+
+    // the fields below are accessed only by Ruby threads holding GVL
+    bool extracted{ false };
+    VALUE result{ Qnil };
+    VALUE error{ Qnil };
+    VALUE callback{ Qnil };
+
+    std::shared_ptr<cb_completion_queue> queue{};
+    bool dispatch_on_completion{ false };
+
+    explicit cb_completion(std::shared_ptr<cb_completion_queue> completion_queue)
+      : queue(std::move(completion_queue))
+    {
+    }
+};
+
+/**
+ * Completions with registered callbacks, waiting to be dispatched by the Ruby thread of the backend.
+ */
+struct cb_completion_queue {
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    std::deque<std::shared_ptr<cb_completion>> ready{};
+    bool stopped{ false };
+    bool interrupted{ false };
+
+    // the fields below are accessed only by Ruby threads holding GVL
+    std::list<std::shared_ptr<cb_completion>> pending{};
+    VALUE dispatcher{ Qnil };
+
+    void push(std::shared_ptr<cb_completion> completion)
+    {
+        {
+            std::scoped_lock lock(mutex);
+            if (stopped) {
+                return;
+            }
+            ready.emplace_back(std::move(completion));
+        }
+        cv.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::scoped_lock lock(mutex);
+            stopped = true;
+            ready.clear();
+        }
+        cv.notify_all();
+    }
+};
+
 struct cb_backend_data {
     std::unique_ptr<asio::io_context> ctx;
     std::unique_ptr<couchbase::cluster> cluster;
-    std::thread worker;
+    std::unique_ptr<std::vector<std::thread>> workers;
+    std::shared_ptr<cb_completion_queue> completions;
 };
 
 static void
 cb__backend_close(cb_backend_data* backend)
 {
+    if (backend->completions) {
+        backend->completions->stop();
+        backend->completions->pending.clear();
+    }
     if (backend->cluster) {
         auto barrier = std::make_shared<std::promise<void>>();
         auto f = barrier->get_future();
         backend->cluster->close([barrier]() { barrier->set_value(); });
         f.wait();
-        if (backend->worker.joinable()) {
-            backend->worker.join();
+        for (auto& worker : *backend->workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
         }
+        backend->workers.reset(nullptr);
         backend->cluster.reset(nullptr);
         backend->ctx.reset(nullptr);
     }
 }
 
 static void
-cb_Backend_mark(void* /* ptr */)
+cb_Backend_mark(void* ptr)
 {
+    auto* backend = reinterpret_cast<cb_backend_data*>(ptr);
+    if (backend->completions) {
+        rb_gc_mark(backend->completions->dispatcher);
+        for (const auto& completion : backend->completions->pending) {
+            rb_gc_mark(completion->callback);
+            rb_gc_mark(completion->result);
+            rb_gc_mark(completion->error);
+        }
+    }
 }
 
 static void
@@ -124,6 +213,7 @@ cb_Backend_free(void* ptr)
 {
     auto* backend = reinterpret_cast<cb_backend_data*>(ptr);
     cb__backend_close(backend);
+    backend->completions.reset();
     ruby_xfree(backend);
 }
 
@@ -158,7 +248,9 @@ cb_Backend_allocate(VALUE klass)
     VALUE obj = TypedData_Make_Struct(klass, cb_backend_data, &cb_backend_type, backend);
     backend->ctx = std::make_unique<asio::io_context>();
     backend->cluster = std::make_unique<couchbase::cluster>(*backend->ctx);
-    backend->worker = std::thread([backend]() { backend->ctx->run(); });
+    backend->workers = std::make_unique<std::vector<std::thread>>();
+    backend->workers->emplace_back([backend]() { backend->ctx->run(); });
+    backend->completions = std::make_shared<cb_completion_queue>();
     return obj;
 }
 
@@ -506,6 +598,547 @@ cb__map_error_code(std::error_code ec, const std::string& message)
     return rb_exc_new_cstr(eBackendError, fmt::format("{}: {}", message, ec.message()).c_str());
 }
 
+/**
+ * State shared by cb_promise and cb_future.
+ *
+ * Unlike std::future, waiting for it can be interrupted by the unblock function of the VM, so the Ruby thread sleeps on
+ * the condition variable until either the response arrives or the thread gets interrupted, instead of polling.
+ */
+template<typename Response>
+struct cb_barrier {
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    std::optional<Response> response{};
+    bool interrupted{ false };
+};
+
+template<typename Response>
+struct cb_future {
+    std::shared_ptr<cb_barrier<Response>> state;
+};
+
+/**
+ * Hands over the response from the IO thread to the Ruby thread, that waits for it with cb__wait_for_future.
+ */
+template<typename Response>
+class cb_promise
+{
+  public:
+    void set_value(Response response)
+    {
+        {
+            std::scoped_lock lock(state_->mutex);
+            state_->response.emplace(std::move(response));
+        }
+        state_->cv.notify_all();
+    }
+
+    cb_future<Response> get_future()
+    {
+        return { state_ };
+    }
+
+  private:
+    std::shared_ptr<cb_barrier<Response>> state_{ std::make_shared<cb_barrier<Response>>() };
+};
+
+template<typename Response>
+static void*
+cb__wait_for_future_without_gvl(void* arg)
+{
+    auto* state = static_cast<cb_barrier<Response>*>(arg);
+    std::unique_lock lock(state->mutex);
+    state->cv.wait(lock, [state]() { return state->response.has_value() || state->interrupted; });
+    return nullptr;
+}
+
+template<typename Response>
+static void
+cb__wait_for_future_unblock(void* arg)
+{
+    auto* state = static_cast<cb_barrier<Response>*>(arg);
+    {
+        std::scoped_lock lock(state->mutex);
+        state->interrupted = true;
+    }
+    state->cv.notify_all();
+}
+
+/**
+ * Waits for the operation to complete without holding GVL, so that other Ruby threads could run in the meantime.
+ *
+ * The operation cannot be revoked once it has been dispatched, so the method keeps waiting for the response even when
+ * the thread has been woken up (trapped signal, Thread#wakeup), and lets the VM process pending interrupts between the
+ * waits. Only when the interrupt raises an exception (Thread#raise, Thread#kill, Interrupt), the wait is abandoned, and
+ * the operation is left to complete in the background.
+ */
+template<typename Response>
+static Response
+cb__wait_for_future(cb_future<Response>& f)
+{
+    auto* state = f.state.get();
+    while (true) {
+        {
+            std::scoped_lock lock(state->mutex);
+            if (state->response) {
+                return std::move(state->response.value());
+            }
+            state->interrupted = false;
+        }
+        rb_thread_call_without_gvl2(cb__wait_for_future_without_gvl<Response>, state, cb__wait_for_future_unblock<Response>, state);
+        // the operation is still in progress, but the thread has been interrupted, let the VM process it
+        rb_thread_check_ints();
+    }
+}
+
+/**
+ * Rows of the streaming query, that have been received by the IO thread, but not yet yielded to the block.
+ *
+ * When the block is slower than the network, the stream is paused after max_buffered_rows, and the session stops reading
+ * the response until the block has consumed half of them. The limit is soft, because the rows of the data, that has been
+ * already read from the socket, are still queued.
+ */
+template<typename Response>
+struct cb_row_stream {
+    static constexpr std::size_t max_buffered_rows = 1024;
+
+    // converts raw JSON of the row to Ruby object (Qundef skips the row), when not set, the rows are yielded as strings
+    VALUE (*convert_row)(const std::string& row){ nullptr };
+    std::shared_ptr<couchbase::io::http_streaming_control> control{ std::make_shared<couchbase::io::http_streaming_control>() };
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    std::deque<std::string> rows{};
+    std::optional<Response> response{};
+    bool interrupted{ false };
+    bool abandoned{ false };
+    bool paused{ false };
+
+    void push_row(std::string&& row)
+    {
+        std::scoped_lock lock(mutex);
+        if (abandoned) {
+            return;
+        }
+        rows.emplace_back(std::move(row));
+        if (!paused && rows.size() >= max_buffered_rows) {
+            paused = true;
+            control->pause();
+        }
+        cv.notify_one();
+    }
+
+    /**
+     * Called by the consumer with the mutex held, after taking the row from the queue.
+     */
+    void maybe_resume()
+    {
+        if (paused && rows.size() <= max_buffered_rows / 2) {
+            paused = false;
+            control->resume();
+        }
+    }
+
+    void complete(Response&& resp)
+    {
+        std::scoped_lock lock(mutex);
+        response.emplace(std::move(resp));
+        cv.notify_one();
+    }
+
+    /**
+     * Discards the rows and cancels the request, so that its connection does not stay busy with the rest of the response.
+     */
+    void abandon()
+    {
+        {
+            std::scoped_lock lock(mutex);
+            abandoned = true;
+            rows.clear();
+        }
+        control->cancel();
+    }
+};
+
+template<typename Response>
+static void*
+cb__row_stream_wait_without_gvl(void* arg)
+{
+    auto* stream = static_cast<cb_row_stream<Response>*>(arg);
+    std::unique_lock lock(stream->mutex);
+    stream->cv.wait(lock, [stream] { return stream->interrupted || !stream->rows.empty() || stream->response.has_value(); });
+    return nullptr;
+}
+
+template<typename Response>
+static void
+cb__row_stream_unblock(void* arg)
+{
+    auto* stream = static_cast<cb_row_stream<Response>*>(arg);
+    std::scoped_lock lock(stream->mutex);
+    stream->interrupted = true;
+    stream->cv.notify_all();
+}
+
+template<typename Response>
+static VALUE
+cb__row_stream_yield_rows(VALUE arg)
+{
+    auto* stream = reinterpret_cast<cb_row_stream<Response>*>(arg);
+    while (true) {
+        VALUE row = Qundef;
+        bool empty = false;
+        {
+            std::string data;
+            {
+                std::scoped_lock lock(stream->mutex);
+                if (!stream->rows.empty()) {
+                    data = std::move(stream->rows.front());
+                    stream->rows.pop_front();
+                    stream->maybe_resume();
+                } else if (stream->response) {
+                    return Qnil;
+                } else {
+                    stream->interrupted = false;
+                    empty = true;
+                }
+            }
+            if (!empty) {
+                row = stream->convert_row == nullptr ? rb_str_new(data.data(), static_cast<long>(data.size())) : stream->convert_row(data);
+            }
+        }
+        // neither lock nor C++ objects might be alive here, as the block and interrupts leave the function with longjmp
+        if (empty) {
+            rb_thread_call_without_gvl2(cb__row_stream_wait_without_gvl<Response>, stream, cb__row_stream_unblock<Response>, stream);
+            rb_thread_check_ints();
+        } else if (row != Qundef) {
+            rb_yield(row);
+        }
+    }
+}
+
+/**
+ * Executes query-like request, and yields rows to the block of the current method as soon as they arrive. Rows are
+ * awaited without holding GVL.
+ *
+ * When the block leaves early (exception, break, interrupt of the thread), the remaining rows are discarded, the
+ * request is cancelled, and jump_tag receives the tag to be passed to rb_jump_tag() once the caller has released its
+ * resources.
+ *
+ * @return response with metadata, its rows are always empty
+ */
+template<typename Request>
+static typename Request::response_type
+cb__execute_streaming_query(couchbase::cluster& cluster, Request& req, int& jump_tag, VALUE (*convert_row)(const std::string&) = nullptr)
+{
+    using response_type = typename Request::response_type;
+    auto stream = std::make_shared<cb_row_stream<response_type>>();
+    stream->convert_row = convert_row;
+    req.row_callback = [stream](std::string&& row) { stream->push_row(std::move(row)); };
+    req.streaming_control = stream->control;
+    cluster.execute_http(req, [stream](response_type resp) mutable { stream->complete(std::move(resp)); });
+    rb_protect(cb__row_stream_yield_rows<response_type>, reinterpret_cast<VALUE>(stream.get()), &jump_tag);
+    if (jump_tag != 0) {
+        stream->abandon();
+        response_type resp{};
+        resp.ec = std::make_error_code(couchbase::error::common_errc::request_canceled);
+        return resp;
+    }
+    std::scoped_lock lock(stream->mutex);
+    return std::move(*stream->response);
+}
+
+static VALUE cBackendFuture;
+
+struct cb_future_data {
+    std::shared_ptr<cb_completion> completion;
+};
+
+static void
+cb_Future_mark(void* ptr)
+{
+    auto* future = reinterpret_cast<cb_future_data*>(ptr);
+    if (future->completion) {
+        rb_gc_mark(future->completion->result);
+        rb_gc_mark(future->completion->error);
+        rb_gc_mark(future->completion->callback);
+    }
+}
+
+static void
+cb_Future_free(void* ptr)
+{
+    auto* future = reinterpret_cast<cb_future_data*>(ptr);
+    future->completion.reset();
+    ruby_xfree(future);
+}
+
+static size_t
+cb_Future_memsize(const void* ptr)
+{
+    const auto* future = reinterpret_cast<const cb_future_data*>(ptr);
+    return sizeof(*future) + sizeof(cb_completion);
+}
+
+static const rb_data_type_t cb_future_type{
+    "Couchbase/Backend/Future",
+    { cb_Future_mark,
+      cb_Future_free,
+      cb_Future_memsize,
+// only one reserved field when GC.compact implemented
+#ifdef T_MOVED
+      nullptr,
+#endif
+      {} },
+#ifdef RUBY_TYPED_FREE_IMMEDIATELY
+    nullptr,
+    nullptr,
+    RUBY_TYPED_FREE_IMMEDIATELY,
+#endif
+};
+
+static VALUE
+cb__future_new(std::shared_ptr<cb_completion> completion)
+{
+    cb_future_data* future = nullptr;
+    VALUE obj = TypedData_Make_Struct(cBackendFuture, cb_future_data, &cb_future_type, future);
+    future->completion = std::move(completion);
+    return obj;
+}
+
+/**
+ * Called by the IO thread. The extractor will be invoked later by the Ruby thread, and have to return the result of the
+ * operation or set the exception.
+ */
+static void
+cb__completion_complete(const std::shared_ptr<cb_completion>& completion, std::function<VALUE(VALUE&)>&& extract_result)
+{
+    bool dispatch = false;
+    {
+        std::scoped_lock lock(completion->mutex);
+        completion->extract_result = std::move(extract_result);
+        completion->completed = true;
+        dispatch = completion->dispatch_on_completion;
+    }
+    completion->cv.notify_all();
+    if (dispatch) {
+        completion->queue->push(completion);
+    }
+}
+
+static void
+cb__completion_extract_result(cb_completion* completion)
+{
+    if (!completion->extracted) {
+        completion->extracted = true;
+        completion->result = completion->extract_result(completion->error);
+        completion->extract_result = nullptr;
+    }
+}
+
+struct cb__completion_wait_context {
+    cb_completion* completion;
+    bool interrupted;
+};
+
+static void*
+cb__completion_wait_without_gvl(void* arg)
+{
+    auto* ctx = static_cast<cb__completion_wait_context*>(arg);
+    std::unique_lock lock(ctx->completion->mutex);
+    ctx->completion->cv.wait(lock, [ctx]() { return ctx->completion->completed || ctx->interrupted; });
+    return nullptr;
+}
+
+static void
+cb__completion_wait_unblock(void* arg)
+{
+    auto* ctx = static_cast<cb__completion_wait_context*>(arg);
+    {
+        std::scoped_lock lock(ctx->completion->mutex);
+        ctx->interrupted = true;
+    }
+    ctx->completion->cv.notify_all();
+}
+
+static bool
+cb__completion_is_completed(cb_completion* completion)
+{
+    std::scoped_lock lock(completion->mutex);
+    return completion->completed;
+}
+
+static VALUE
+cb_Future_completed(VALUE self)
+{
+    cb_future_data* future = nullptr;
+    TypedData_Get_Struct(self, cb_future_data, &cb_future_type, future);
+    return cb__completion_is_completed(future->completion.get()) ? Qtrue : Qfalse;
+}
+
+static VALUE
+cb_Future_wait(VALUE self)
+{
+    cb_future_data* future = nullptr;
+    TypedData_Get_Struct(self, cb_future_data, &cb_future_type, future);
+
+    cb_completion* completion = future->completion.get();
+    while (!cb__completion_is_completed(completion)) {
+        cb__completion_wait_context ctx{ completion, false };
+        rb_thread_call_without_gvl2(cb__completion_wait_without_gvl, &ctx, cb__completion_wait_unblock, &ctx);
+        // the operation is still in progress, but the thread has been interrupted, let the VM process it
+        rb_thread_check_ints();
+    }
+    cb__completion_extract_result(completion);
+    if (!NIL_P(completion->error)) {
+        rb_exc_raise(completion->error);
+    }
+    return completion->result;
+}
+
+static VALUE
+cb__completion_invoke_callback(VALUE arg)
+{
+    auto* completion = reinterpret_cast<cb_completion*>(arg);
+    cb__completion_extract_result(completion);
+    return rb_funcall(completion->callback, rb_intern("call"), 2, completion->result, completion->error);
+}
+
+/**
+ * Pops the next completion from the queue and invokes its callback.
+ *
+ * @return false if the queue has been stopped
+ */
+static bool
+cb__completion_dispatch_next(cb_completion_queue* queue)
+{
+    std::shared_ptr<cb_completion> completion{};
+    {
+        std::scoped_lock lock(queue->mutex);
+        if (queue->stopped) {
+            return false;
+        }
+        queue->interrupted = false;
+        if (queue->ready.empty()) {
+            return true;
+        }
+        completion = queue->ready.front();
+        queue->ready.pop_front();
+    }
+    // the completion stays in the pending list (and its callback marked) until the callback returns, the local copy keeps
+    // the callback alive even if the backend gets closed (and the list cleared) by the callback itself
+    VALUE callback = completion->callback;
+    int state = 0;
+    rb_protect(cb__completion_invoke_callback, reinterpret_cast<VALUE>(completion.get()), &state);
+    RB_GC_GUARD(callback);
+    queue->pending.remove(completion);
+    if (state != 0) {
+        VALUE error = rb_errinfo();
+        VALUE message = rb_funcall(error, rb_intern("inspect"), 0);
+        spdlog::warn("exception in completion callback: {}",
+                     std::string_view(RSTRING_PTR(message), static_cast<std::size_t>(RSTRING_LEN(message))));
+        rb_set_errinfo(Qnil);
+    }
+    return true;
+}
+
+static void*
+cb__completion_queue_wait_without_gvl(void* arg)
+{
+    auto* queue = static_cast<cb_completion_queue*>(arg);
+    std::unique_lock lock(queue->mutex);
+    queue->cv.wait(lock, [queue]() { return queue->stopped || queue->interrupted || !queue->ready.empty(); });
+    return nullptr;
+}
+
+static void
+cb__completion_queue_unblock(void* arg)
+{
+    auto* queue = static_cast<cb_completion_queue*>(arg);
+    {
+        std::scoped_lock lock(queue->mutex);
+        queue->interrupted = true;
+    }
+    queue->cv.notify_all();
+}
+
+static VALUE
+cb__completion_dispatch_run(VALUE arg)
+{
+    cb_completion_queue* queue = reinterpret_cast<std::shared_ptr<cb_completion_queue>*>(arg)->get();
+    do {
+        rb_thread_call_without_gvl2(cb__completion_queue_wait_without_gvl, queue, cb__completion_queue_unblock, queue);
+        rb_thread_check_ints();
+    } while (cb__completion_dispatch_next(queue));
+    return Qnil;
+}
+
+static VALUE
+cb__completion_dispatch_cleanup(VALUE arg)
+{
+    auto* holder = reinterpret_cast<std::shared_ptr<cb_completion_queue>*>(arg);
+    // next call of on_complete will start new dispatcher, if this one has been killed
+    (*holder)->dispatcher = Qnil;
+    delete holder;
+    return Qnil;
+}
+
+static VALUE
+cb__completion_dispatch_loop(void* arg)
+{
+    // the thread owns the reference to the queue, so that it outlives the backend
+    VALUE holder = reinterpret_cast<VALUE>(arg);
+    return rb_ensure(cb__completion_dispatch_run, holder, cb__completion_dispatch_cleanup, holder);
+}
+
+static VALUE
+cb_Future_on_complete(VALUE self)
+{
+    cb_future_data* future = nullptr;
+    TypedData_Get_Struct(self, cb_future_data, &cb_future_type, future);
+
+    if (!rb_block_given_p()) {
+        rb_raise(rb_eArgError, "block required to handle completion");
+    }
+    VALUE callback = rb_block_proc();
+
+    cb_completion* completion = future->completion.get();
+    if (!NIL_P(completion->callback)) {
+        rb_raise(rb_eArgError, "completion callback has been registered already");
+    }
+    completion->callback = callback;
+
+    bool completed = false;
+    {
+        std::scoped_lock lock(completion->mutex);
+        completed = completion->completed;
+        if (!completed) {
+            completion->dispatch_on_completion = true;
+        }
+    }
+    if (completed) {
+        cb__completion_extract_result(completion);
+        rb_funcall(callback, rb_intern("call"), 2, completion->result, completion->error);
+        return self;
+    }
+
+    cb_completion_queue* queue = completion->queue.get();
+    queue->pending.push_back(future->completion);
+    if (NIL_P(queue->dispatcher)) {
+        queue->dispatcher = rb_thread_create(cb__completion_dispatch_loop, new std::shared_ptr<cb_completion_queue>(completion->queue));
+    }
+    return self;
+}
+
+static void
+init_future(VALUE cBackend)
+{
+    cBackendFuture = rb_define_class_under(cBackend, "Future", rb_cObject);
+    rb_undef_alloc_func(cBackendFuture);
+    rb_define_method(cBackendFuture, "completed?", VALUE_FUNC(cb_Future_completed), 0);
+    rb_define_method(cBackendFuture, "wait", VALUE_FUNC(cb_Future_wait), 0);
+    rb_define_method(cBackendFuture, "on_complete", VALUE_FUNC(cb_Future_on_complete), 0);
+}
+
 static VALUE
 cb_Backend_open(VALUE self, VALUE connection_string, VALUE username, VALUE password)
 {
@@ -523,14 +1156,17 @@ cb_Backend_open(VALUE self, VALUE connection_string, VALUE username, VALUE passw
     {
         std::string input(RSTRING_PTR(connection_string), static_cast<size_t>(RSTRING_LEN(connection_string)));
         auto connstr = couchbase::utils::parse_connection_string(input);
+        while (backend->workers->size() < connstr.options.io_threads) {
+            backend->workers->emplace_back([backend]() { backend->ctx->run(); });
+        }
 
         std::string user(RSTRING_PTR(username), static_cast<size_t>(RSTRING_LEN(username)));
         std::string pass(RSTRING_PTR(password), static_cast<size_t>(RSTRING_LEN(password)));
         couchbase::origin origin(user, pass, connstr);
-        auto barrier = std::make_shared<std::promise<std::error_code>>();
+        auto barrier = std::make_shared<cb_promise<std::error_code>>();
         auto f = barrier->get_future();
         backend->cluster->open(origin, [barrier](std::error_code ec) mutable { barrier->set_value(ec); });
-        if (auto ec = f.get()) {
+        if (auto ec = cb__wait_for_future(f)) {
             exc = cb__map_error_code(ec, fmt::format("unable open cluster at {}", origin.next_address().first));
         }
     }
@@ -568,10 +1204,10 @@ cb_Backend_open_bucket(VALUE self, VALUE bucket, VALUE wait_until_ready)
         std::string name(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
 
         if (wait) {
-            auto barrier = std::make_shared<std::promise<std::error_code>>();
+            auto barrier = std::make_shared<cb_promise<std::error_code>>();
             auto f = barrier->get_future();
             backend->cluster->open_bucket(name, [barrier](std::error_code ec) mutable { barrier->set_value(ec); });
-            if (auto ec = f.get()) {
+            if (auto ec = cb__wait_for_future(f)) {
                 exc = cb__map_error_code(ec, fmt::format("unable open bucket \"{}\"", name));
             }
         } else {
@@ -585,24 +1221,30 @@ cb_Backend_open_bucket(VALUE self, VALUE bucket, VALUE wait_until_ready)
     return Qnil;
 }
 
-template<typename Request>
-void
-cb__extract_timeout(Request& req, VALUE timeout)
+static VALUE
+cb__extract_histograms(const std::map<std::string, couchbase::utils::latency_histogram::snapshot>& histograms)
 {
-    if (!NIL_P(timeout)) {
-        switch (TYPE(timeout)) {
-            case T_FIXNUM:
-            case T_BIGNUM:
-                req.timeout = std::chrono::milliseconds(NUM2ULL(timeout));
-                break;
-            default:
-                rb_raise(rb_eArgError, "timeout must be an Integer");
-        }
+    VALUE res = rb_hash_new();
+    for (const auto& [name, histogram] : histograms) {
+        VALUE entry = rb_hash_new();
+        rb_hash_aset(entry, rb_id2sym(rb_intern("count")), ULL2NUM(histogram.count));
+        rb_hash_aset(entry, rb_id2sym(rb_intern("mean")), ULL2NUM(histogram.mean_us));
+        rb_hash_aset(entry, rb_id2sym(rb_intern("max")), ULL2NUM(histogram.max_us));
+        VALUE percentiles = rb_hash_new();
+        for (const auto& [percentile, value] : histogram.percentiles_us) {
+            rb_hash_aset(percentiles, DBL2NUM(percentile), ULL2NUM(value));
+        }
+        rb_hash_aset(entry, rb_id2sym(rb_intern("percentiles")), percentiles);
+        rb_hash_aset(res, rb_str_new(name.data(), static_cast<long>(name.size())), entry);
     }
+    return res;
 }
 
+/**
+ * Returns latencies (in microseconds) and counters collected by the IO threads for every node of the cluster
+ */
 static VALUE
-cb_Backend_document_get(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
+cb_Backend_metrics(VALUE self, VALUE reset)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -611,47 +1253,168 @@ cb_Backend_document_get(VALUE self, VALUE bucket, VALUE collection, VALUE id, VA
         rb_raise(rb_eArgError, "Cluster has been closed already");
     }
 
+    VALUE res = rb_hash_new();
+    for (const auto& [address, metrics] : backend->cluster->metrics(RTEST(reset))) {
+        VALUE node = rb_hash_new();
+        rb_hash_aset(node, rb_id2sym(rb_intern("kv")), cb__extract_histograms(metrics.key_value));
+        rb_hash_aset(node, rb_id2sym(rb_intern("http")), cb__extract_histograms(metrics.http));
+        rb_hash_aset(node, rb_id2sym(rb_intern("bytes_in")), ULL2NUM(metrics.bytes_in));
+        rb_hash_aset(node, rb_id2sym(rb_intern("bytes_out")), ULL2NUM(metrics.bytes_out));
+        rb_hash_aset(node, rb_id2sym(rb_intern("retries")), ULL2NUM(metrics.retries));
+        rb_hash_aset(node, rb_id2sym(rb_intern("timeouts")), ULL2NUM(metrics.timeouts));
+        rb_hash_aset(node, rb_id2sym(rb_intern("not_my_vbucket")), ULL2NUM(metrics.not_my_vbucket));
+        rb_hash_aset(node, rb_id2sym(rb_intern("connects")), ULL2NUM(metrics.connects));
+        rb_hash_aset(res, rb_str_new(address.data(), static_cast<long>(address.size())), node);
+    }
+    return res;
+}
+
+template<typename Request>
+void
+cb__extract_timeout(Request& req, VALUE timeout)
+{
+    if (!NIL_P(timeout)) {
+        switch (TYPE(timeout)) {
+            case T_FIXNUM:
+            case T_BIGNUM:
+                req.timeout = std::chrono::milliseconds(NUM2ULL(timeout));
+                break;
+            default:
+                rb_raise(rb_eArgError, "timeout must be an Integer");
+        }
+    }
+}
+
+static couchbase::document_id
+cb__extract_document_id(VALUE bucket, VALUE collection, VALUE id)
+{
     Check_Type(bucket, T_STRING);
     Check_Type(collection, T_STRING);
     Check_Type(id, T_STRING);
 
+    couchbase::document_id doc_id;
+    doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
+    doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
+    doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
+    return doc_id;
+}
+
+static void
+cb__extract_cas(std::uint64_t& cas, VALUE value)
+{
+    switch (TYPE(value)) {
+        case T_FIXNUM:
+        case T_BIGNUM:
+            cas = NUM2ULL(value);
+            break;
+        default:
+            rb_raise(rb_eArgError, "CAS must be an Integer");
+    }
+}
+
+/**
+ * Builds the KV request, that needs only the document id and the timeout. The sync and async methods share the
+ * builders, so that they accept exactly the same arguments.
+ */
+template<typename Request>
+static Request
+cb__build_document_request(VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
+{
+    Request req{ cb__extract_document_id(bucket, collection, id) };
+    cb__extract_timeout(req, timeout);
+    return req;
+}
+
+/**
+ * Sends the KV request and waits for the response without holding GVL.
+ */
+template<typename Response, typename Request, typename Extractor>
+static VALUE
+cb__execute_sync(cb_backend_data* backend, Request req, const char* action, Extractor extractor)
+{
     VALUE exc = Qnil;
     do {
-        couchbase::document_id doc_id;
-        doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
-        doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
-        doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
-
-        couchbase::operations::get_request req{ doc_id };
-        cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::get_response>>();
+        auto barrier = std::make_shared<cb_promise<Response>>();
         auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::get_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        backend->cluster->execute(std::move(req), [barrier](Response resp) mutable { barrier->set_value(std::move(resp)); });
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable fetch {} (opaque={})", doc_id, resp.opaque));
+            exc = cb__map_error_code(resp.ec, fmt::format("unable to {} {} (opaque={})", action, resp.id, resp.opaque));
             break;
         }
-
-        VALUE res = rb_hash_new();
-        rb_hash_aset(res, rb_id2sym(rb_intern("content")), rb_str_new(resp.value.data(), static_cast<long>(resp.value.size())));
-        rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
-        rb_hash_aset(res, rb_id2sym(rb_intern("flags")), UINT2NUM(resp.flags));
-        return res;
+        return extractor(resp);
     } while (false);
     rb_exc_raise(exc);
     return Qnil;
 }
 
+/**
+ * Sends the KV request without waiting for the response. The returned future is completed by the IO thread, and the
+ * extractor converts the response into Ruby object once the Ruby thread asks for the result.
+ */
+template<typename Response, typename Request, typename Extractor>
 static VALUE
-cb_Backend_document_get_projected(VALUE self,
-                                  VALUE bucket,
-                                  VALUE collection,
-                                  VALUE id,
-                                  VALUE timeout,
-                                  VALUE with_expiration,
-                                  VALUE projections,
-                                  VALUE preserve_array_indexes)
+cb__execute_async(cb_backend_data* backend, Request req, const char* action, Extractor extractor)
+{
+    auto completion = std::make_shared<cb_completion>(backend->completions);
+    backend->cluster->execute(std::move(req), [completion, action, extractor](Response resp) mutable {
+        cb__completion_complete(completion, [action, extractor, resp = std::move(resp)](VALUE& exc) -> VALUE {
+            if (resp.ec) {
+                exc = cb__map_error_code(resp.ec, fmt::format("unable to {} {} (opaque={})", action, resp.id, resp.opaque));
+                return Qnil;
+            }
+            return extractor(resp);
+        });
+    });
+    return cb__future_new(completion);
+}
+
+static VALUE
+cb__timings_interval(couchbase::operation_timings::clock::time_point start, couchbase::operation_timings::clock::time_point end)
+{
+    if (start.time_since_epoch().count() == 0 || end.time_since_epoch().count() == 0 || end < start) {
+        return Qnil;
+    }
+    return LL2NUM(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+}
+
+/**
+ * Converts timestamps of the KV operation to the durations of its stages in microseconds (nil, when the stage has not
+ * been reached)
+ */
+static VALUE
+cb__extract_timings(const couchbase::operation_timings& timings)
+{
+    VALUE res = rb_hash_new();
+    rb_hash_aset(res, rb_id2sym(rb_intern("queue")), cb__timings_interval(timings.queued, timings.encoded));
+    rb_hash_aset(res, rb_id2sym(rb_intern("dispatch")), cb__timings_interval(timings.encoded, timings.written));
+    VALUE network = cb__timings_interval(timings.written, timings.received);
+    if (!NIL_P(network) && timings.server_duration) {
+        network = LL2NUM(std::max(NUM2LL(network) - static_cast<long long>(timings.server_duration->count()), 0LL));
+    }
+    rb_hash_aset(res, rb_id2sym(rb_intern("network")), network);
+    rb_hash_aset(res,
+                 rb_id2sym(rb_intern("server")),
+                 timings.server_duration ? LL2NUM(static_cast<long long>(timings.server_duration->count())) : Qnil);
+    rb_hash_aset(res, rb_id2sym(rb_intern("decode")), cb__timings_interval(timings.received, timings.decoded));
+    rb_hash_aset(res, rb_id2sym(rb_intern("total")), cb__timings_interval(timings.queued, timings.decoded));
+    return res;
+}
+
+template<typename Response>
+static VALUE
+cb__extract_get_result(const Response& resp)
+{
+    VALUE res = rb_hash_new();
+    rb_hash_aset(res, rb_id2sym(rb_intern("content")), rb_str_new(resp.value.data(), static_cast<long>(resp.value.size())));
+    rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
+    rb_hash_aset(res, rb_id2sym(rb_intern("flags")), UINT2NUM(resp.flags));
+    rb_hash_aset(res, rb_id2sym(rb_intern("timings")), cb__extract_timings(resp.timings));
+    return res;
+}
+
+static VALUE
+cb_Backend_document_get(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -660,56 +1423,145 @@ cb_Backend_document_get_projected(VALUE self,
         rb_raise(rb_eArgError, "Cluster has been closed already");
     }
 
-    Check_Type(bucket, T_STRING);
-    Check_Type(collection, T_STRING);
-    Check_Type(id, T_STRING);
+    return cb__execute_sync<couchbase::operations::get_response>(
+      backend,
+      cb__build_document_request<couchbase::operations::get_request>(bucket, collection, id, timeout),
+      "fetch",
+      cb__extract_get_result<couchbase::operations::get_response>);
+}
 
-    VALUE exc = Qnil;
-    do {
-        couchbase::document_id doc_id;
-        doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
-        doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
-        doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
+/**
+ * Copies of the document, that have been received from the active node and the replicas
+ */
+struct cb_replica_reads {
+    struct entry {
+        bool is_replica;
+        std::string value;
+        std::uint64_t cas;
+        std::uint32_t flags;
+    };
+    std::error_code ec{};
+    std::vector<entry> entries{};
+};
 
-        couchbase::operations::get_projected_request req{ doc_id };
-        cb__extract_timeout(req, timeout);
-        req.with_expiration = RTEST(with_expiration);
-        req.preserve_array_indexes = RTEST(preserve_array_indexes);
-        if (!NIL_P(projections)) {
-            Check_Type(projections, T_ARRAY);
-            auto entries_num = static_cast<size_t>(RARRAY_LEN(projections));
-            req.projections.reserve(entries_num);
-            for (size_t i = 0; i < entries_num; ++i) {
-                VALUE entry = rb_ary_entry(projections, static_cast<long>(i));
-                Check_Type(entry, T_STRING);
-                req.projections.emplace_back(std::string(RSTRING_PTR(entry), static_cast<std::size_t>(RSTRING_LEN(entry))));
+struct cb_replica_read_context {
+    std::mutex mutex{};
+    cb_promise<cb_replica_reads> barrier{};
+    cb_replica_reads result{};
+    bool first_only;
+    bool completed{ false };
+    std::size_t expected{ 0 };
+    std::size_t received{ 0 };
+    std::error_code last_error{};
+    std::shared_ptr<couchbase::io::timer_wheel> timers;
+    std::atomic<couchbase::io::timer_wheel::timer_id> deadline{ 0 };
+
+    cb_replica_read_context(bool first, std::shared_ptr<couchbase::io::timer_wheel> timer_wheel)
+      : first_only(first)
+      , timers(std::move(timer_wheel))
+    {
+    }
+
+    void fail(std::error_code ec)
+    {
+        {
+            std::scoped_lock lock(mutex);
+            if (completed) {
+                return;
             }
+            completed = true;
+            result.ec = ec;
+            barrier.set_value(std::move(result));
         }
+        timers->cancel(deadline.exchange(0));
+    }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::get_projected_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::get_projected_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
-        if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable fetch with projections {} (opaque={})", doc_id, resp.opaque));
-            break;
+    void add(bool is_replica, std::error_code ec, std::string&& value, std::uint64_t cas, std::uint32_t flags)
+    {
+        {
+            std::scoped_lock lock(mutex);
+            ++received;
+            if (completed) {
+                return;
+            }
+            if (ec) {
+                last_error = ec;
+            } else {
+                result.entries.push_back({ is_replica, std::move(value), cas, flags });
+            }
+            if ((!first_only || result.entries.empty()) && received != expected) {
+                return;
+            }
+            completed = true;
+            if (result.entries.empty()) {
+                result.ec = last_error == std::make_error_code(couchbase::error::key_value_errc::document_not_found)
+                              ? std::make_error_code(couchbase::error::key_value_errc::document_irretrievable)
+                              : last_error;
+            }
+            barrier.set_value(std::move(result));
         }
+        timers->cancel(deadline.exchange(0));
+    }
+};
 
-        VALUE res = rb_hash_new();
-        rb_hash_aset(res, rb_id2sym(rb_intern("content")), rb_str_new(resp.value.data(), static_cast<long>(resp.value.size())));
-        rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
-        rb_hash_aset(res, rb_id2sym(rb_intern("flags")), UINT2NUM(resp.flags));
-        if (resp.expiration) {
-            rb_hash_aset(res, rb_id2sym(rb_intern("expiration")), UINT2NUM(resp.expiration.value()));
-        }
-        return res;
-    } while (false);
-    rb_exc_raise(exc);
-    return Qnil;
+/**
+ * Sends get to the active node and get_replica to every replica of the partition at the same time.
+ *
+ * @param first_only complete as soon as any copy has been received, otherwise wait for all of them
+ */
+static cb_replica_reads
+cb__execute_replica_reads(couchbase::cluster* cluster,
+                          const couchbase::document_id& doc_id,
+                          std::chrono::milliseconds timeout,
+                          bool first_only)
+{
+    auto ctx = std::make_shared<cb_replica_read_context>(first_only, cluster->timers());
+    auto f = ctx->barrier.get_future();
+    // the configuration might not be available until the bucket has been bootstrapped, so the deadline covers the whole
+    // operation, and not only the requests to the nodes
+    ctx->deadline = ctx->timers->schedule_after(timeout, [ctx](std::error_code ec) {
+        ctx->fail(ec ? ec : std::make_error_code(couchbase::error::common_errc::unambiguous_timeout));
+    });
+    cluster->with_bucket_configuration(
+      doc_id.bucket, [cluster, ctx, doc_id, timeout](std::error_code ec, const couchbase::configuration& config) mutable {
+          if (ec) {
+              return ctx->fail(ec);
+          }
+          std::size_t num_replicas = config.num_replicas.value_or(0);
+          {
+              std::scoped_lock lock(ctx->mutex);
+              ctx->expected = num_replicas + 1;
+          }
+          couchbase::operations::get_request active{ doc_id };
+          active.timeout = timeout;
+          cluster->execute(active, [ctx](couchbase::operations::get_response resp) {
+              ctx->add(false, resp.ec, std::move(resp.value), resp.cas, resp.flags);
+          });
+          for (std::size_t index = 1; index <= num_replicas; ++index) {
+              couchbase::operations::get_replica_request req{ doc_id };
+              req.timeout = timeout;
+              req.replica_index = index;
+              cluster->execute(req, [ctx](couchbase::operations::get_replica_response resp) {
+                  ctx->add(true, resp.ec, std::move(resp.value), resp.cas, resp.flags);
+              });
+          }
+      });
+    return cb__wait_for_future(f);
 }
 
 static VALUE
-cb_Backend_document_get_and_lock(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE lock_time)
+cb__extract_replica_read(const cb_replica_reads::entry& entry)
+{
+    VALUE res = rb_hash_new();
+    rb_hash_aset(res, rb_id2sym(rb_intern("content")), rb_str_new(entry.value.data(), static_cast<long>(entry.value.size())));
+    rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(entry.cas));
+    rb_hash_aset(res, rb_id2sym(rb_intern("flags")), UINT2NUM(entry.flags));
+    rb_hash_aset(res, rb_id2sym(rb_intern("is_replica")), entry.is_replica ? Qtrue : Qfalse);
+    return res;
+}
+
+static VALUE
+cb_Backend_document_get_any_replica(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -721,7 +1573,6 @@ cb_Backend_document_get_and_lock(VALUE self, VALUE bucket, VALUE collection, VAL
     Check_Type(bucket, T_STRING);
     Check_Type(collection, T_STRING);
     Check_Type(id, T_STRING);
-    Check_Type(lock_time, T_FIXNUM);
 
     VALUE exc = Qnil;
     do {
@@ -730,31 +1581,22 @@ cb_Backend_document_get_and_lock(VALUE self, VALUE bucket, VALUE collection, VAL
         doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
         doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
 
-        couchbase::operations::get_and_lock_request req{ doc_id };
+        couchbase::operations::get_request req{ doc_id };
         cb__extract_timeout(req, timeout);
-        req.lock_time = NUM2UINT(lock_time);
-
-        auto barrier = std::make_shared<std::promise<couchbase::operations::get_and_lock_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::get_and_lock_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__execute_replica_reads(backend->cluster.get(), doc_id, req.timeout, true);
         if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable lock and fetch {} (opaque={})", doc_id, resp.opaque));
+            exc = cb__map_error_code(resp.ec, fmt::format("unable to get replica of {}", doc_id));
             break;
         }
 
-        VALUE res = rb_hash_new();
-        rb_hash_aset(res, rb_id2sym(rb_intern("content")), rb_str_new(resp.value.data(), static_cast<long>(resp.value.size())));
-        rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
-        rb_hash_aset(res, rb_id2sym(rb_intern("flags")), UINT2NUM(resp.flags));
-        return res;
+        return cb__extract_replica_read(resp.entries.front());
     } while (false);
     rb_exc_raise(exc);
     return Qnil;
 }
 
 static VALUE
-cb_Backend_document_get_and_touch(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE expiration)
+cb_Backend_document_get_all_replicas(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -766,7 +1608,6 @@ cb_Backend_document_get_and_touch(VALUE self, VALUE bucket, VALUE collection, VA
     Check_Type(bucket, T_STRING);
     Check_Type(collection, T_STRING);
     Check_Type(id, T_STRING);
-    Check_Type(expiration, T_FIXNUM);
 
     VALUE exc = Qnil;
     do {
@@ -775,48 +1616,43 @@ cb_Backend_document_get_and_touch(VALUE self, VALUE bucket, VALUE collection, VA
         doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
         doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
 
-        couchbase::operations::get_and_touch_request req{ doc_id };
+        couchbase::operations::get_request req{ doc_id };
         cb__extract_timeout(req, timeout);
-        req.expiration = NUM2UINT(expiration);
-
-        auto barrier = std::make_shared<std::promise<couchbase::operations::get_and_touch_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::get_and_touch_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__execute_replica_reads(backend->cluster.get(), doc_id, req.timeout, false);
         if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable fetch and touch {} (opaque={})", doc_id, resp.opaque));
+            exc = cb__map_error_code(resp.ec, fmt::format("unable to get replicas of {}", doc_id));
             break;
         }
 
-        VALUE res = rb_hash_new();
-        rb_hash_aset(res, rb_id2sym(rb_intern("content")), rb_str_new(resp.value.data(), static_cast<long>(resp.value.size())));
-        rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
-        rb_hash_aset(res, rb_id2sym(rb_intern("flags")), UINT2NUM(resp.flags));
+        VALUE res = rb_ary_new_capa(static_cast<long>(resp.entries.size()));
+        for (const auto& entry : resp.entries) {
+            rb_ary_push(res, cb__extract_replica_read(entry));
+        }
         return res;
     } while (false);
     rb_exc_raise(exc);
     return Qnil;
 }
 
-template<typename Response>
 static VALUE
-cb__extract_mutation_result(Response resp)
+cb_Backend_document_get_async(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
 {
-    VALUE res = rb_hash_new();
-    rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
-    VALUE token = rb_hash_new();
-    rb_hash_aset(token, rb_id2sym(rb_intern("partition_uuid")), ULL2NUM(resp.token.partition_uuid));
-    rb_hash_aset(token, rb_id2sym(rb_intern("sequence_number")), ULONG2NUM(resp.token.sequence_number));
-    rb_hash_aset(token, rb_id2sym(rb_intern("partition_id")), UINT2NUM(resp.token.partition_id));
-    rb_hash_aset(token,
-                 rb_id2sym(rb_intern("bucket_name")),
-                 rb_str_new(resp.token.bucket_name.c_str(), static_cast<long>(resp.token.bucket_name.size())));
-    rb_hash_aset(res, rb_id2sym(rb_intern("mutation_token")), token);
-    return res;
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_async<couchbase::operations::get_response>(
+      backend,
+      cb__build_document_request<couchbase::operations::get_request>(bucket, collection, id, timeout),
+      "fetch",
+      cb__extract_get_result<couchbase::operations::get_response>);
 }
 
 static VALUE
-cb_Backend_document_touch(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE expiration)
+cb_Backend_document_get_multi(VALUE self, VALUE bucket, VALUE collection, VALUE ids, VALUE timeout)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -827,31 +1663,64 @@ cb_Backend_document_touch(VALUE self, VALUE bucket, VALUE collection, VALUE id,
 
     Check_Type(bucket, T_STRING);
     Check_Type(collection, T_STRING);
-    Check_Type(id, T_STRING);
-    Check_Type(expiration, T_FIXNUM);
+    Check_Type(ids, T_ARRAY);
+    auto num_ids = static_cast<size_t>(RARRAY_LEN(ids));
+    for (size_t i = 0; i < num_ids; ++i) {
+        Check_Type(rb_ary_entry(ids, static_cast<long>(i)), T_STRING);
+    }
+    if (num_ids == 0) {
+        return rb_ary_new();
+    }
 
     VALUE exc = Qnil;
     do {
-        couchbase::document_id doc_id;
-        doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
-        doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
-        doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
-
-        couchbase::operations::touch_request req{ doc_id };
-        cb__extract_timeout(req, timeout);
-        req.expiration = NUM2UINT(expiration);
-
-        auto barrier = std::make_shared<std::promise<couchbase::operations::touch_response>>();
+        std::vector<couchbase::operations::get_request> requests;
+        requests.reserve(num_ids);
+        for (size_t i = 0; i < num_ids; ++i) {
+            VALUE id = rb_ary_entry(ids, static_cast<long>(i));
+            couchbase::document_id doc_id;
+            doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
+            doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
+            doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
+            auto& req = requests.emplace_back(couchbase::operations::get_request{ doc_id });
+            cb__extract_timeout(req, timeout);
+        }
+
+        // all requests are scheduled at once, so that they will be pipelined on the sessions, and the barrier is released
+        // only when the last response arrives
+        auto responses = std::make_shared<std::vector<couchbase::operations::get_response>>(num_ids);
+        auto remaining = std::make_shared<std::atomic_size_t>(num_ids);
+        auto barrier = std::make_shared<cb_promise<std::error_code>>();
         auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::touch_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
-        if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable to touch {} (opaque={})", doc_id, resp.opaque));
+        for (size_t i = 0; i < num_ids; ++i) {
+            backend->cluster->execute(requests[i],
+                                      [barrier, responses, remaining, i](couchbase::operations::get_response resp) mutable {
+                                          (*responses)[i] = std::move(resp);
+                                          if (--(*remaining) == 0) {
+                                              barrier->set_value({});
+                                          }
+                                      });
+        }
+        if (auto ec = cb__wait_for_future(f)) {
+            exc = cb__map_error_code(ec, fmt::format("unable to fetch {} documents", num_ids));
             break;
         }
 
-        VALUE res = rb_hash_new();
-        rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
+        VALUE res = rb_ary_new_capa(static_cast<long>(num_ids));
+        for (size_t i = 0; i < num_ids; ++i) {
+            const auto& resp = (*responses)[i];
+            VALUE entry = Qnil;
+            if (resp.ec) {
+                entry = rb_hash_new();
+                rb_hash_aset(entry,
+                             rb_id2sym(rb_intern("error")),
+                             cb__map_error_code(resp.ec, fmt::format("unable fetch {} (opaque={})", resp.id, resp.opaque)));
+            } else {
+                entry = cb__extract_get_result(resp);
+            }
+            rb_hash_aset(entry, rb_id2sym(rb_intern("id")), rb_ary_entry(ids, static_cast<long>(i)));
+            rb_ary_push(res, entry);
+        }
         return res;
     } while (false);
     rb_exc_raise(exc);
@@ -859,7 +1728,14 @@ cb_Backend_document_touch(VALUE self, VALUE bucket, VALUE collection, VALUE id,
 }
 
 static VALUE
-cb_Backend_document_exists(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
+cb_Backend_document_get_projected(VALUE self,
+                                  VALUE bucket,
+                                  VALUE collection,
+                                  VALUE id,
+                                  VALUE timeout,
+                                  VALUE with_expiration,
+                                  VALUE projections,
+                                  VALUE preserve_array_indexes)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -879,37 +1755,36 @@ cb_Backend_document_exists(VALUE self, VALUE bucket, VALUE collection, VALUE id,
         doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
         doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
 
-        couchbase::operations::exists_request req{ doc_id };
+        couchbase::operations::get_projected_request req{ doc_id };
         cb__extract_timeout(req, timeout);
+        req.with_expiration = RTEST(with_expiration);
+        req.preserve_array_indexes = RTEST(preserve_array_indexes);
+        if (!NIL_P(projections)) {
+            Check_Type(projections, T_ARRAY);
+            auto entries_num = static_cast<size_t>(RARRAY_LEN(projections));
+            req.projections.reserve(entries_num);
+            for (size_t i = 0; i < entries_num; ++i) {
+                VALUE entry = rb_ary_entry(projections, static_cast<long>(i));
+                Check_Type(entry, T_STRING);
+                req.projections.emplace_back(std::string(RSTRING_PTR(entry), static_cast<std::size_t>(RSTRING_LEN(entry))));
+            }
+        }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::exists_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::get_projected_response>>();
         auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::exists_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        backend->cluster->execute(req, [barrier](couchbase::operations::get_projected_response resp) mutable { barrier->set_value(resp); });
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable to exists {} (opaque={})", doc_id, resp.opaque));
+            exc = cb__map_error_code(resp.ec, fmt::format("unable fetch with projections {} (opaque={})", doc_id, resp.opaque));
             break;
         }
 
         VALUE res = rb_hash_new();
+        rb_hash_aset(res, rb_id2sym(rb_intern("content")), rb_str_new(resp.value.data(), static_cast<long>(resp.value.size())));
         rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
-        rb_hash_aset(res, rb_id2sym(rb_intern("partition_id")), UINT2NUM(resp.partition_id));
-        switch (resp.status) {
-            case couchbase::operations::exists_response::observe_status::invalid:
-                rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("invalid")));
-                break;
-            case couchbase::operations::exists_response::observe_status::found:
-                rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("found")));
-                break;
-            case couchbase::operations::exists_response::observe_status::not_found:
-                rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("not_found")));
-                break;
-            case couchbase::operations::exists_response::observe_status::persisted:
-                rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("persisted")));
-                break;
-            case couchbase::operations::exists_response::observe_status::logically_deleted:
-                rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("logically_deleted")));
-                break;
+        rb_hash_aset(res, rb_id2sym(rb_intern("flags")), UINT2NUM(resp.flags));
+        if (resp.expiration) {
+            rb_hash_aset(res, rb_id2sym(rb_intern("expiration")), UINT2NUM(resp.expiration.value()));
         }
         return res;
     } while (false);
@@ -917,57 +1792,61 @@ cb_Backend_document_exists(VALUE self, VALUE bucket, VALUE collection, VALUE id,
     return Qnil;
 }
 
-static VALUE
-cb_Backend_document_unlock(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE cas)
+static couchbase::operations::get_and_lock_request
+cb__build_get_and_lock_request(VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE lock_time)
 {
-    cb_backend_data* backend = nullptr;
-    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
-
+    Check_Type(lock_time, T_FIXNUM);
+    auto req = cb__build_document_request<couchbase::operations::get_and_lock_request>(bucket, collection, id, timeout);
+    req.lock_time = NUM2UINT(lock_time);
+    return req;
+}
+
+static VALUE
+cb_Backend_document_get_and_lock(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE lock_time)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
     if (!backend->cluster) {
         rb_raise(rb_eArgError, "Cluster has been closed already");
     }
 
-    Check_Type(bucket, T_STRING);
-    Check_Type(collection, T_STRING);
-    Check_Type(id, T_STRING);
+    return cb__execute_sync<couchbase::operations::get_and_lock_response>(
+      backend,
+      cb__build_get_and_lock_request(bucket, collection, id, timeout, lock_time),
+      "lock and fetch",
+      cb__extract_get_result<couchbase::operations::get_and_lock_response>);
+}
 
-    VALUE exc = Qnil;
-    do {
-        couchbase::document_id doc_id;
-        doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
-        doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
-        doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
+static VALUE
+cb_Backend_document_get_and_lock_async(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE lock_time)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
 
-        couchbase::operations::unlock_request req{ doc_id };
-        cb__extract_timeout(req, timeout);
-        switch (TYPE(cas)) {
-            case T_FIXNUM:
-            case T_BIGNUM:
-                req.cas = NUM2ULL(cas);
-                break;
-            default:
-                rb_raise(rb_eArgError, "CAS must be an Integer");
-        }
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::unlock_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::unlock_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
-        if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable to unlock {} (opaque={})", doc_id, resp.opaque));
-            break;
-        }
+    return cb__execute_async<couchbase::operations::get_and_lock_response>(
+      backend,
+      cb__build_get_and_lock_request(bucket, collection, id, timeout, lock_time),
+      "lock and fetch",
+      cb__extract_get_result<couchbase::operations::get_and_lock_response>);
+}
 
-        VALUE res = rb_hash_new();
-        rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
-        return res;
-    } while (false);
-    rb_exc_raise(exc);
-    return Qnil;
+template<typename Request>
+static Request
+cb__build_touch_request(VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE expiration)
+{
+    Check_Type(expiration, T_FIXNUM);
+    auto req = cb__build_document_request<Request>(bucket, collection, id, timeout);
+    req.expiration = NUM2UINT(expiration);
+    return req;
 }
 
 static VALUE
-cb_Backend_document_upsert(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE content, VALUE flags, VALUE options)
+cb_Backend_document_get_and_touch(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE expiration)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -976,71 +1855,136 @@ cb_Backend_document_upsert(VALUE self, VALUE bucket, VALUE collection, VALUE id,
         rb_raise(rb_eArgError, "Cluster has been closed already");
     }
 
-    Check_Type(bucket, T_STRING);
-    Check_Type(collection, T_STRING);
-    Check_Type(id, T_STRING);
-    Check_Type(content, T_STRING);
-    Check_Type(flags, T_FIXNUM);
+    return cb__execute_sync<couchbase::operations::get_and_touch_response>(
+      backend,
+      cb__build_touch_request<couchbase::operations::get_and_touch_request>(bucket, collection, id, timeout, expiration),
+      "fetch and touch",
+      cb__extract_get_result<couchbase::operations::get_and_touch_response>);
+}
 
-    VALUE exc = Qnil;
-    do {
-        couchbase::document_id doc_id;
-        doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
-        doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
-        doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
-        std::string value(RSTRING_PTR(content), static_cast<size_t>(RSTRING_LEN(content)));
+static VALUE
+cb_Backend_document_get_and_touch_async(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE expiration)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
 
-        couchbase::operations::upsert_request req{ doc_id, value };
-        cb__extract_timeout(req, timeout);
-        req.flags = FIX2UINT(flags);
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
 
-        if (!NIL_P(options)) {
-            Check_Type(options, T_HASH);
-            VALUE durability_level = rb_hash_aref(options, rb_id2sym(rb_intern("durability_level")));
-            if (!NIL_P(durability_level)) {
-                Check_Type(durability_level, T_SYMBOL);
-                ID level = rb_sym2id(durability_level);
-                if (level == rb_intern("none")) {
-                    req.durability_level = couchbase::protocol::durability_level::none;
-                } else if (level == rb_intern("majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority;
-                } else if (level == rb_intern("majority_and_persist_to_active")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority_and_persist_to_active;
-                } else if (level == rb_intern("persist_to_majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::persist_to_majority;
-                } else {
-                    rb_raise(rb_eArgError, "Unknown durability level");
-                }
-                VALUE durability_timeout = rb_hash_aref(options, rb_id2sym(rb_intern("durability_timeout")));
-                if (!NIL_P(durability_timeout)) {
-                    Check_Type(durability_timeout, T_FIXNUM);
-                    req.durability_timeout = FIX2UINT(durability_timeout);
-                }
-            }
-            VALUE expiration = rb_hash_aref(options, rb_id2sym(rb_intern("expiration")));
-            if (!NIL_P(expiration)) {
-                Check_Type(expiration, T_FIXNUM);
-                req.expiration = FIX2UINT(expiration);
-            }
-        }
+    return cb__execute_async<couchbase::operations::get_and_touch_response>(
+      backend,
+      cb__build_touch_request<couchbase::operations::get_and_touch_request>(bucket, collection, id, timeout, expiration),
+      "fetch and touch",
+      cb__extract_get_result<couchbase::operations::get_and_touch_response>);
+}
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::upsert_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::upsert_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
-        if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable to upsert {} (opaque={})", doc_id, resp.opaque));
+template<typename Response>
+static VALUE
+cb__extract_mutation_result(const Response& resp)
+{
+    VALUE res = rb_hash_new();
+    rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
+    VALUE token = rb_hash_new();
+    rb_hash_aset(token, rb_id2sym(rb_intern("partition_uuid")), ULL2NUM(resp.token.partition_uuid));
+    rb_hash_aset(token, rb_id2sym(rb_intern("sequence_number")), ULONG2NUM(resp.token.sequence_number));
+    rb_hash_aset(token, rb_id2sym(rb_intern("partition_id")), UINT2NUM(resp.token.partition_id));
+    rb_hash_aset(token,
+                 rb_id2sym(rb_intern("bucket_name")),
+                 rb_str_new(resp.token.bucket_name.c_str(), static_cast<long>(resp.token.bucket_name.size())));
+    rb_hash_aset(res, rb_id2sym(rb_intern("mutation_token")), token);
+    rb_hash_aset(res, rb_id2sym(rb_intern("timings")), cb__extract_timings(resp.timings));
+    return res;
+}
+
+template<typename Response>
+static VALUE
+cb__extract_cas_result(const Response& resp)
+{
+    VALUE res = rb_hash_new();
+    rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
+    return res;
+}
+
+static VALUE
+cb_Backend_document_touch(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE expiration)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_sync<couchbase::operations::touch_response>(
+      backend,
+      cb__build_touch_request<couchbase::operations::touch_request>(bucket, collection, id, timeout, expiration),
+      "touch",
+      cb__extract_cas_result<couchbase::operations::touch_response>);
+}
+
+static VALUE
+cb_Backend_document_touch_async(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE expiration)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_async<couchbase::operations::touch_response>(
+      backend,
+      cb__build_touch_request<couchbase::operations::touch_request>(bucket, collection, id, timeout, expiration),
+      "touch",
+      cb__extract_cas_result<couchbase::operations::touch_response>);
+}
+
+static VALUE
+cb__extract_exists_result(const couchbase::operations::exists_response& resp)
+{
+    VALUE res = rb_hash_new();
+    rb_hash_aset(res, rb_id2sym(rb_intern("cas")), ULL2NUM(resp.cas));
+    rb_hash_aset(res, rb_id2sym(rb_intern("partition_id")), UINT2NUM(resp.partition_id));
+    switch (resp.status) {
+        case couchbase::operations::exists_response::observe_status::invalid:
+            rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("invalid")));
             break;
-        }
+        case couchbase::operations::exists_response::observe_status::found:
+            rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("found")));
+            break;
+        case couchbase::operations::exists_response::observe_status::not_found:
+            rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("not_found")));
+            break;
+        case couchbase::operations::exists_response::observe_status::persisted:
+            rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("persisted")));
+            break;
+        case couchbase::operations::exists_response::observe_status::logically_deleted:
+            rb_hash_aset(res, rb_id2sym(rb_intern("status")), rb_id2sym(rb_intern("logically_deleted")));
+            break;
+    }
+    return res;
+}
 
-        return cb__extract_mutation_result(resp);
-    } while (false);
-    rb_exc_raise(exc);
-    return Qnil;
+static VALUE
+cb_Backend_document_exists(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_sync<couchbase::operations::exists_response>(
+      backend,
+      cb__build_document_request<couchbase::operations::exists_request>(bucket, collection, id, timeout),
+      "check existence of",
+      cb__extract_exists_result);
 }
 
 static VALUE
-cb_Backend_document_replace(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE content, VALUE flags, VALUE options)
+cb_Backend_document_exists_async(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -1049,78 +1993,210 @@ cb_Backend_document_replace(VALUE self, VALUE bucket, VALUE collection, VALUE id
         rb_raise(rb_eArgError, "Cluster has been closed already");
     }
 
-    Check_Type(bucket, T_STRING);
-    Check_Type(collection, T_STRING);
-    Check_Type(id, T_STRING);
+    return cb__execute_async<couchbase::operations::exists_response>(
+      backend,
+      cb__build_document_request<couchbase::operations::exists_request>(bucket, collection, id, timeout),
+      "check existence of",
+      cb__extract_exists_result);
+}
+
+static couchbase::operations::unlock_request
+cb__build_unlock_request(VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE cas)
+{
+    auto req = cb__build_document_request<couchbase::operations::unlock_request>(bucket, collection, id, timeout);
+    cb__extract_cas(req.cas, cas);
+    return req;
+}
+
+static VALUE
+cb_Backend_document_unlock(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE cas)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_sync<couchbase::operations::unlock_response>(
+      backend,
+      cb__build_unlock_request(bucket, collection, id, timeout, cas),
+      "unlock",
+      cb__extract_cas_result<couchbase::operations::unlock_response>);
+}
+
+static VALUE
+cb_Backend_document_unlock_async(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE cas)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_async<couchbase::operations::unlock_response>(
+      backend,
+      cb__build_unlock_request(bucket, collection, id, timeout, cas),
+      "unlock",
+      cb__extract_cas_result<couchbase::operations::unlock_response>);
+}
+
+template<typename Request>
+void
+cb__extract_durability(Request& req, VALUE options)
+{
+    VALUE durability_level = rb_hash_aref(options, rb_id2sym(rb_intern("durability_level")));
+    if (!NIL_P(durability_level)) {
+        Check_Type(durability_level, T_SYMBOL);
+        ID level = rb_sym2id(durability_level);
+        if (level == rb_intern("none")) {
+            req.durability_level = couchbase::protocol::durability_level::none;
+        } else if (level == rb_intern("majority")) {
+            req.durability_level = couchbase::protocol::durability_level::majority;
+        } else if (level == rb_intern("majority_and_persist_to_active")) {
+            req.durability_level = couchbase::protocol::durability_level::majority_and_persist_to_active;
+        } else if (level == rb_intern("persist_to_majority")) {
+            req.durability_level = couchbase::protocol::durability_level::persist_to_majority;
+        } else {
+            rb_raise(rb_eArgError, "Unknown durability level");
+        }
+        VALUE durability_timeout = rb_hash_aref(options, rb_id2sym(rb_intern("durability_timeout")));
+        if (!NIL_P(durability_timeout)) {
+            Check_Type(durability_timeout, T_FIXNUM);
+            req.durability_timeout = FIX2UINT(durability_timeout);
+        }
+    }
+}
+
+/**
+ * Builds the full document mutation (insert, upsert or replace), the CAS option is only accepted by replace.
+ */
+template<typename Request>
+static Request
+cb__build_mutation_request(VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE content, VALUE flags, VALUE options)
+{
     Check_Type(content, T_STRING);
     Check_Type(flags, T_FIXNUM);
 
-    VALUE exc = Qnil;
-    do {
-        couchbase::document_id doc_id;
-        doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
-        doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
-        doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
-        std::string value(RSTRING_PTR(content), static_cast<size_t>(RSTRING_LEN(content)));
-
-        couchbase::operations::replace_request req{ doc_id, value };
-        cb__extract_timeout(req, timeout);
-        req.flags = FIX2UINT(flags);
+    Request req{ cb__extract_document_id(bucket, collection, id),
+                 std::string(RSTRING_PTR(content), static_cast<size_t>(RSTRING_LEN(content))) };
+    cb__extract_timeout(req, timeout);
+    req.flags = FIX2UINT(flags);
 
-        if (!NIL_P(options)) {
-            Check_Type(options, T_HASH);
-            VALUE durability_level = rb_hash_aref(options, rb_id2sym(rb_intern("durability_level")));
-            if (!NIL_P(durability_level)) {
-                Check_Type(durability_level, T_SYMBOL);
-                ID level = rb_sym2id(durability_level);
-                if (level == rb_intern("none")) {
-                    req.durability_level = couchbase::protocol::durability_level::none;
-                } else if (level == rb_intern("majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority;
-                } else if (level == rb_intern("majority_and_persist_to_active")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority_and_persist_to_active;
-                } else if (level == rb_intern("persist_to_majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::persist_to_majority;
-                } else {
-                    rb_raise(rb_eArgError, "Unknown durability level");
-                }
-                VALUE durability_timeout = rb_hash_aref(options, rb_id2sym(rb_intern("durability_timeout")));
-                if (!NIL_P(durability_timeout)) {
-                    Check_Type(durability_timeout, T_FIXNUM);
-                    req.durability_timeout = FIX2UINT(durability_timeout);
-                }
-            }
-            VALUE expiration = rb_hash_aref(options, rb_id2sym(rb_intern("expiration")));
-            if (!NIL_P(expiration)) {
-                Check_Type(expiration, T_FIXNUM);
-                req.expiration = FIX2UINT(expiration);
-            }
+    if (!NIL_P(options)) {
+        Check_Type(options, T_HASH);
+        cb__extract_durability(req, options);
+        VALUE expiration = rb_hash_aref(options, rb_id2sym(rb_intern("expiration")));
+        if (!NIL_P(expiration)) {
+            Check_Type(expiration, T_FIXNUM);
+            req.expiration = FIX2UINT(expiration);
+        }
+        if constexpr (std::is_same_v<Request, couchbase::operations::replace_request>) {
             VALUE cas = rb_hash_aref(options, rb_id2sym(rb_intern("cas")));
             if (!NIL_P(cas)) {
-                switch (TYPE(cas)) {
-                    case T_FIXNUM:
-                    case T_BIGNUM:
-                        req.cas = NUM2ULL(cas);
-                        break;
-                    default:
-                        rb_raise(rb_eArgError, "CAS must be an Integer");
-                }
+                cb__extract_cas(req.cas, cas);
             }
         }
+    }
+    return req;
+}
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::replace_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::replace_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
-        if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable to replace {} (opaque={})", doc_id, resp.opaque));
-            break;
+static couchbase::operations::remove_request
+cb__build_remove_request(VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE options)
+{
+    auto req = cb__build_document_request<couchbase::operations::remove_request>(bucket, collection, id, timeout);
+    if (!NIL_P(options)) {
+        Check_Type(options, T_HASH);
+        cb__extract_durability(req, options);
+        VALUE cas = rb_hash_aref(options, rb_id2sym(rb_intern("cas")));
+        if (!NIL_P(cas)) {
+            cb__extract_cas(req.cas, cas);
         }
+    }
+    return req;
+}
 
-        return cb__extract_mutation_result(resp);
-    } while (false);
-    rb_exc_raise(exc);
-    return Qnil;
+static VALUE
+cb_Backend_document_upsert(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE content, VALUE flags, VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_sync<couchbase::operations::upsert_response>(
+      backend,
+      cb__build_mutation_request<couchbase::operations::upsert_request>(bucket, collection, id, timeout, content, flags, options),
+      "upsert",
+      cb__extract_mutation_result<couchbase::operations::upsert_response>);
+}
+
+static VALUE
+cb_Backend_document_upsert_async(VALUE self,
+                                 VALUE bucket,
+                                 VALUE collection,
+                                 VALUE id,
+                                 VALUE timeout,
+                                 VALUE content,
+                                 VALUE flags,
+                                 VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_async<couchbase::operations::upsert_response>(
+      backend,
+      cb__build_mutation_request<couchbase::operations::upsert_request>(bucket, collection, id, timeout, content, flags, options),
+      "upsert",
+      cb__extract_mutation_result<couchbase::operations::upsert_response>);
+}
+
+static VALUE
+cb_Backend_document_replace(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE content, VALUE flags, VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_sync<couchbase::operations::replace_response>(
+      backend,
+      cb__build_mutation_request<couchbase::operations::replace_request>(bucket, collection, id, timeout, content, flags, options),
+      "replace",
+      cb__extract_mutation_result<couchbase::operations::replace_response>);
+}
+
+static VALUE
+cb_Backend_document_replace_async(VALUE self,
+                                  VALUE bucket,
+                                  VALUE collection,
+                                  VALUE id,
+                                  VALUE timeout,
+                                  VALUE content,
+                                  VALUE flags,
+                                  VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_async<couchbase::operations::replace_response>(
+      backend,
+      cb__build_mutation_request<couchbase::operations::replace_request>(bucket, collection, id, timeout, content, flags, options),
+      "replace",
+      cb__extract_mutation_result<couchbase::operations::replace_response>);
 }
 
 static VALUE
@@ -1133,71 +2209,114 @@ cb_Backend_document_insert(VALUE self, VALUE bucket, VALUE collection, VALUE id,
         rb_raise(rb_eArgError, "Cluster has been closed already");
     }
 
-    Check_Type(bucket, T_STRING);
-    Check_Type(collection, T_STRING);
-    Check_Type(id, T_STRING);
-    Check_Type(content, T_STRING);
-    Check_Type(flags, T_FIXNUM);
+    return cb__execute_sync<couchbase::operations::insert_response>(
+      backend,
+      cb__build_mutation_request<couchbase::operations::insert_request>(bucket, collection, id, timeout, content, flags, options),
+      "insert",
+      cb__extract_mutation_result<couchbase::operations::insert_response>);
+}
 
-    VALUE exc = Qnil;
-    do {
-        couchbase::document_id doc_id;
-        doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
-        doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
-        doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
-        std::string value(RSTRING_PTR(content), static_cast<size_t>(RSTRING_LEN(content)));
+static VALUE
+cb_Backend_document_insert_async(VALUE self,
+                                 VALUE bucket,
+                                 VALUE collection,
+                                 VALUE id,
+                                 VALUE timeout,
+                                 VALUE content,
+                                 VALUE flags,
+                                 VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
 
-        couchbase::operations::insert_request req{ doc_id, value };
-        cb__extract_timeout(req, timeout);
-        req.flags = FIX2UINT(flags);
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
 
-        if (!NIL_P(options)) {
-            Check_Type(options, T_HASH);
-            VALUE durability_level = rb_hash_aref(options, rb_id2sym(rb_intern("durability_level")));
-            if (!NIL_P(durability_level)) {
-                Check_Type(durability_level, T_SYMBOL);
-                ID level = rb_sym2id(durability_level);
-                if (level == rb_intern("none")) {
-                    req.durability_level = couchbase::protocol::durability_level::none;
-                } else if (level == rb_intern("majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority;
-                } else if (level == rb_intern("majority_and_persist_to_active")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority_and_persist_to_active;
-                } else if (level == rb_intern("persist_to_majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::persist_to_majority;
-                } else {
-                    rb_raise(rb_eArgError, "Unknown durability level");
-                }
-                VALUE durability_timeout = rb_hash_aref(options, rb_id2sym(rb_intern("durability_timeout")));
-                if (!NIL_P(durability_timeout)) {
-                    Check_Type(durability_timeout, T_FIXNUM);
-                    req.durability_timeout = FIX2UINT(durability_timeout);
-                }
-            }
-            VALUE expiration = rb_hash_aref(options, rb_id2sym(rb_intern("expiration")));
-            if (!NIL_P(expiration)) {
-                Check_Type(expiration, T_FIXNUM);
-                req.expiration = FIX2UINT(expiration);
-            }
-        }
+    return cb__execute_async<couchbase::operations::insert_response>(
+      backend,
+      cb__build_mutation_request<couchbase::operations::insert_request>(bucket, collection, id, timeout, content, flags, options),
+      "insert",
+      cb__extract_mutation_result<couchbase::operations::insert_response>);
+}
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::insert_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::insert_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
-        if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable to insert {} (opaque={})", doc_id, resp.opaque));
-            break;
-        }
+static VALUE
+cb_Backend_document_remove(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_sync<couchbase::operations::remove_response>(
+      backend,
+      cb__build_remove_request(bucket, collection, id, timeout, options),
+      "remove",
+      cb__extract_mutation_result<couchbase::operations::remove_response>);
+}
+
+static VALUE
+cb_Backend_document_remove_async(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    return cb__execute_async<couchbase::operations::remove_response>(
+      backend,
+      cb__build_remove_request(bucket, collection, id, timeout, options),
+      "remove",
+      cb__extract_mutation_result<couchbase::operations::remove_response>);
+}
+
+struct cb__batch_mutation_outcome {
+    couchbase::document_id id{};
+    std::uint32_t opaque{};
+    std::error_code ec{};
+    std::uint64_t cas{};
+    couchbase::mutation_token token{};
+    couchbase::operation_timings timings{};
+};
 
-        return cb__extract_mutation_result(resp);
-    } while (false);
-    rb_exc_raise(exc);
-    return Qnil;
+struct cb__batch_mutation_state {
+    std::vector<cb__batch_mutation_outcome> outcomes;
+    std::atomic_size_t remaining;
+    cb_promise<std::error_code> barrier{};
+
+    explicit cb__batch_mutation_state(size_t size)
+      : outcomes(size)
+      , remaining(size)
+    {
+    }
+};
+
+template<typename Request>
+static std::function<void(couchbase::cluster&)>
+cb__batch_mutation_schedule(Request req, const std::shared_ptr<cb__batch_mutation_state>& state, size_t index)
+{
+    return [req = std::move(req), state, index](couchbase::cluster& cluster) mutable {
+        cluster.execute(std::move(req), [state, index](auto resp) {
+            auto& outcome = state->outcomes[index];
+            outcome.id = resp.id;
+            outcome.opaque = resp.opaque;
+            outcome.ec = resp.ec;
+            outcome.cas = resp.cas;
+            outcome.token = resp.token;
+            outcome.timings = resp.timings;
+            if (--state->remaining == 0) {
+                state->barrier.set_value({});
+            }
+        });
+    };
 }
 
 static VALUE
-cb_Backend_document_remove(VALUE self, VALUE bucket, VALUE collection, VALUE id, VALUE timeout, VALUE options)
+cb_Backend_document_mutate_multi(VALUE self, VALUE bucket, VALUE collection, VALUE timeout, VALUE mutations)
 {
     cb_backend_data* backend = nullptr;
     TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
@@ -1208,51 +2327,131 @@ cb_Backend_document_remove(VALUE self, VALUE bucket, VALUE collection, VALUE id,
 
     Check_Type(bucket, T_STRING);
     Check_Type(collection, T_STRING);
-    Check_Type(id, T_STRING);
+    Check_Type(mutations, T_ARRAY);
+    auto num_mutations = static_cast<size_t>(RARRAY_LEN(mutations));
+    for (size_t i = 0; i < num_mutations; ++i) {
+        VALUE mutation = rb_ary_entry(mutations, static_cast<long>(i));
+        Check_Type(mutation, T_HASH);
+        VALUE operation = rb_hash_aref(mutation, rb_id2sym(rb_intern("operation")));
+        Check_Type(operation, T_SYMBOL);
+        Check_Type(rb_hash_aref(mutation, rb_id2sym(rb_intern("id"))), T_STRING);
+        ID operation_id = rb_sym2id(operation);
+        if (operation_id != rb_intern("upsert") && operation_id != rb_intern("insert") && operation_id != rb_intern("replace") &&
+            operation_id != rb_intern("remove")) {
+            rb_raise(rb_eArgError, "Unsupported mutation operation: %+" PRIsVALUE, operation);
+        }
+        VALUE cas = rb_hash_aref(mutation, rb_id2sym(rb_intern("cas")));
+        if (!NIL_P(cas)) {
+            if (operation_id != rb_intern("replace") && operation_id != rb_intern("remove")) {
+                rb_raise(rb_eArgError, "CAS is only supported by replace and remove mutations");
+            }
+            std::uint64_t value = 0;
+            cb__extract_cas(value, cas);
+        }
+        if (operation_id == rb_intern("remove")) {
+            continue;
+        }
+        Check_Type(rb_hash_aref(mutation, rb_id2sym(rb_intern("content"))), T_STRING);
+        Check_Type(rb_hash_aref(mutation, rb_id2sym(rb_intern("flags"))), T_FIXNUM);
+        VALUE expiration = rb_hash_aref(mutation, rb_id2sym(rb_intern("expiration")));
+        if (!NIL_P(expiration)) {
+            Check_Type(expiration, T_FIXNUM);
+        }
+    }
+    if (num_mutations == 0) {
+        return rb_ary_new();
+    }
 
     VALUE exc = Qnil;
     do {
-        couchbase::document_id doc_id;
-        doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
-        doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
-        doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
+        auto state = std::make_shared<cb__batch_mutation_state>(num_mutations);
+        std::vector<std::function<void(couchbase::cluster&)>> commands;
+        commands.reserve(num_mutations);
+        for (size_t i = 0; i < num_mutations; ++i) {
+            VALUE mutation = rb_ary_entry(mutations, static_cast<long>(i));
+            VALUE id = rb_hash_aref(mutation, rb_id2sym(rb_intern("id")));
+            couchbase::document_id doc_id;
+            doc_id.bucket.assign(RSTRING_PTR(bucket), static_cast<size_t>(RSTRING_LEN(bucket)));
+            doc_id.collection.assign(RSTRING_PTR(collection), static_cast<size_t>(RSTRING_LEN(collection)));
+            doc_id.key.assign(RSTRING_PTR(id), static_cast<size_t>(RSTRING_LEN(id)));
+
+            ID operation = rb_sym2id(rb_hash_aref(mutation, rb_id2sym(rb_intern("operation"))));
+            VALUE cas = rb_hash_aref(mutation, rb_id2sym(rb_intern("cas")));
+            if (operation == rb_intern("remove")) {
+                couchbase::operations::remove_request req{ doc_id };
+                cb__extract_timeout(req, timeout);
+                cb__extract_durability(req, mutation);
+                if (!NIL_P(cas)) {
+                    req.cas = NUM2ULL(cas);
+                }
+                commands.emplace_back(cb__batch_mutation_schedule(std::move(req), state, i));
+                continue;
+            }
 
-        couchbase::operations::remove_request req{ doc_id };
-        cb__extract_timeout(req, timeout);
-        if (!NIL_P(options)) {
-            Check_Type(options, T_HASH);
-            VALUE durability_level = rb_hash_aref(options, rb_id2sym(rb_intern("durability_level")));
-            if (!NIL_P(durability_level)) {
-                Check_Type(durability_level, T_SYMBOL);
-                ID level = rb_sym2id(durability_level);
-                if (level == rb_intern("none")) {
-                    req.durability_level = couchbase::protocol::durability_level::none;
-                } else if (level == rb_intern("majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority;
-                } else if (level == rb_intern("majority_and_persist_to_active")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority_and_persist_to_active;
-                } else if (level == rb_intern("persist_to_majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::persist_to_majority;
-                } else {
-                    rb_raise(rb_eArgError, "Unknown durability level");
+            VALUE content = rb_hash_aref(mutation, rb_id2sym(rb_intern("content")));
+            std::string value(RSTRING_PTR(content), static_cast<size_t>(RSTRING_LEN(content)));
+            auto flags = FIX2UINT(rb_hash_aref(mutation, rb_id2sym(rb_intern("flags"))));
+            VALUE expiration = rb_hash_aref(mutation, rb_id2sym(rb_intern("expiration")));
+            if (operation == rb_intern("upsert")) {
+                couchbase::operations::upsert_request req{ doc_id, std::move(value) };
+                cb__extract_timeout(req, timeout);
+                cb__extract_durability(req, mutation);
+                req.flags = flags;
+                if (!NIL_P(expiration)) {
+                    req.expiration = FIX2UINT(expiration);
+                }
+                commands.emplace_back(cb__batch_mutation_schedule(std::move(req), state, i));
+            } else if (operation == rb_intern("insert")) {
+                couchbase::operations::insert_request req{ doc_id, std::move(value) };
+                cb__extract_timeout(req, timeout);
+                cb__extract_durability(req, mutation);
+                req.flags = flags;
+                if (!NIL_P(expiration)) {
+                    req.expiration = FIX2UINT(expiration);
+                }
+                commands.emplace_back(cb__batch_mutation_schedule(std::move(req), state, i));
+            } else {
+                couchbase::operations::replace_request req{ doc_id, std::move(value) };
+                cb__extract_timeout(req, timeout);
+                cb__extract_durability(req, mutation);
+                req.flags = flags;
+                if (!NIL_P(expiration)) {
+                    req.expiration = FIX2UINT(expiration);
                 }
-                VALUE durability_timeout = rb_hash_aref(options, rb_id2sym(rb_intern("durability_timeout")));
-                if (!NIL_P(durability_timeout)) {
-                    Check_Type(durability_timeout, T_FIXNUM);
-                    req.durability_timeout = FIX2UINT(durability_timeout);
+                if (!NIL_P(cas)) {
+                    req.cas = NUM2ULL(cas);
                 }
+                commands.emplace_back(cb__batch_mutation_schedule(std::move(req), state, i));
             }
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::remove_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute(req, [barrier](couchbase::operations::remove_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
-        if (resp.ec) {
-            exc = cb__map_error_code(resp.ec, fmt::format("unable to remove {} (opaque={})", doc_id, resp.opaque));
+        // every request is routed to its node by the bucket, so the commands for the same node are pipelined on its session
+        auto f = state->barrier.get_future();
+        for (auto& command : commands) {
+            command(*backend->cluster);
+        }
+        if (auto ec = cb__wait_for_future(f)) {
+            exc = cb__map_error_code(ec, fmt::format("unable to mutate {} documents", num_mutations));
             break;
         }
-        return cb__extract_mutation_result(resp);
+
+        VALUE res = rb_ary_new_capa(static_cast<long>(num_mutations));
+        for (size_t i = 0; i < num_mutations; ++i) {
+            const auto& outcome = state->outcomes[i];
+            VALUE entry = Qnil;
+            if (outcome.ec) {
+                entry = rb_hash_new();
+                rb_hash_aset(entry,
+                             rb_id2sym(rb_intern("error")),
+                             cb__map_error_code(outcome.ec, fmt::format("unable to mutate {} (opaque={})", outcome.id, outcome.opaque)));
+            } else {
+                entry = cb__extract_mutation_result(outcome);
+            }
+            VALUE mutation = rb_ary_entry(mutations, static_cast<long>(i));
+            rb_hash_aset(entry, rb_id2sym(rb_intern("id")), rb_hash_aref(mutation, rb_id2sym(rb_intern("id"))));
+            rb_ary_push(res, entry);
+        }
+        return res;
     } while (false);
     rb_exc_raise(exc);
     return Qnil;
@@ -1283,27 +2482,7 @@ cb_Backend_document_increment(VALUE self, VALUE bucket, VALUE collection, VALUE
         cb__extract_timeout(req, timeout);
         if (!NIL_P(options)) {
             Check_Type(options, T_HASH);
-            VALUE durability_level = rb_hash_aref(options, rb_id2sym(rb_intern("durability_level")));
-            if (!NIL_P(durability_level)) {
-                Check_Type(durability_level, T_SYMBOL);
-                ID level = rb_sym2id(durability_level);
-                if (level == rb_intern("none")) {
-                    req.durability_level = couchbase::protocol::durability_level::none;
-                } else if (level == rb_intern("majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority;
-                } else if (level == rb_intern("majority_and_persist_to_active")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority_and_persist_to_active;
-                } else if (level == rb_intern("persist_to_majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::persist_to_majority;
-                } else {
-                    rb_raise(rb_eArgError, "Unknown durability level");
-                }
-                VALUE durability_timeout = rb_hash_aref(options, rb_id2sym(rb_intern("durability_timeout")));
-                if (!NIL_P(durability_timeout)) {
-                    Check_Type(durability_timeout, T_FIXNUM);
-                    req.durability_timeout = FIX2UINT(durability_timeout);
-                }
-            }
+            cb__extract_durability(req, options);
             VALUE delta = rb_hash_aref(options, rb_id2sym(rb_intern("delta")));
             if (!NIL_P(delta)) {
                 switch (TYPE(delta)) {
@@ -1333,10 +2512,10 @@ cb_Backend_document_increment(VALUE self, VALUE bucket, VALUE collection, VALUE
             }
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::increment_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::increment_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute(req, [barrier](couchbase::operations::increment_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to increment {} by {} (opaque={})", doc_id, req.delta, resp.opaque));
             break;
@@ -1375,27 +2554,7 @@ cb_Backend_document_decrement(VALUE self, VALUE bucket, VALUE collection, VALUE
         cb__extract_timeout(req, timeout);
         if (!NIL_P(options)) {
             Check_Type(options, T_HASH);
-            VALUE durability_level = rb_hash_aref(options, rb_id2sym(rb_intern("durability_level")));
-            if (!NIL_P(durability_level)) {
-                Check_Type(durability_level, T_SYMBOL);
-                ID level = rb_sym2id(durability_level);
-                if (level == rb_intern("none")) {
-                    req.durability_level = couchbase::protocol::durability_level::none;
-                } else if (level == rb_intern("majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority;
-                } else if (level == rb_intern("majority_and_persist_to_active")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority_and_persist_to_active;
-                } else if (level == rb_intern("persist_to_majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::persist_to_majority;
-                } else {
-                    rb_raise(rb_eArgError, "Unknown durability level");
-                }
-                VALUE durability_timeout = rb_hash_aref(options, rb_id2sym(rb_intern("durability_timeout")));
-                if (!NIL_P(durability_timeout)) {
-                    Check_Type(durability_timeout, T_FIXNUM);
-                    req.durability_timeout = FIX2UINT(durability_timeout);
-                }
-            }
+            cb__extract_durability(req, options);
             VALUE delta = rb_hash_aref(options, rb_id2sym(rb_intern("delta")));
             if (!NIL_P(delta)) {
                 switch (TYPE(delta)) {
@@ -1425,10 +2584,10 @@ cb_Backend_document_decrement(VALUE self, VALUE bucket, VALUE collection, VALUE
             }
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::decrement_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::decrement_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute(req, [barrier](couchbase::operations::decrement_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to decrement {} by {} (opaque={})", doc_id, req.delta, resp.opaque));
             break;
@@ -1666,10 +2825,10 @@ cb_Backend_document_lookup_in(VALUE self, VALUE bucket, VALUE collection, VALUE
             req.specs.add_spec(opcode, xattr, std::string(RSTRING_PTR(path), static_cast<size_t>(RSTRING_LEN(path))));
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::lookup_in_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::lookup_in_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute(req, [barrier](couchbase::operations::lookup_in_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable fetch {} (opaque={})", doc_id, resp.opaque));
             break;
@@ -1731,27 +2890,7 @@ cb_Backend_document_mutate_in(VALUE self, VALUE bucket, VALUE collection, VALUE
         cb__extract_timeout(req, timeout);
         if (!NIL_P(options)) {
             Check_Type(options, T_HASH);
-            VALUE durability_level = rb_hash_aref(options, rb_id2sym(rb_intern("durability_level")));
-            if (!NIL_P(durability_level)) {
-                Check_Type(durability_level, T_SYMBOL);
-                ID level = rb_sym2id(durability_level);
-                if (level == rb_intern("none")) {
-                    req.durability_level = couchbase::protocol::durability_level::none;
-                } else if (level == rb_intern("majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority;
-                } else if (level == rb_intern("majority_and_persist_to_active")) {
-                    req.durability_level = couchbase::protocol::durability_level::majority_and_persist_to_active;
-                } else if (level == rb_intern("persist_to_majority")) {
-                    req.durability_level = couchbase::protocol::durability_level::persist_to_majority;
-                } else {
-                    rb_raise(rb_eArgError, "Unknown durability level");
-                }
-                VALUE durability_timeout = rb_hash_aref(options, rb_id2sym(rb_intern("durability_timeout")));
-                if (!NIL_P(durability_timeout)) {
-                    Check_Type(durability_timeout, T_FIXNUM);
-                    req.durability_timeout = FIX2UINT(durability_timeout);
-                }
-            }
+            cb__extract_durability(req, options);
             VALUE access_deleted = rb_hash_aref(options, rb_id2sym(rb_intern("access_deleted")));
             if (!NIL_P(access_deleted)) {
                 req.access_deleted = RTEST(access_deleted);
@@ -1844,10 +2983,10 @@ cb_Backend_document_mutate_in(VALUE self, VALUE bucket, VALUE collection, VALUE
             }
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::mutate_in_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::mutate_in_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute(req, [barrier](couchbase::operations::mutate_in_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to mutate {} (opaque={})", doc_id, resp.opaque));
             break;
@@ -1898,6 +3037,204 @@ cb__for_each_named_param(VALUE key, VALUE value, VALUE arg)
     return ST_CONTINUE;
 }
 
+static void
+cb__extract_query_options(couchbase::operations::query_request& req, VALUE options)
+{
+    VALUE client_context_id = rb_hash_aref(options, rb_id2sym(rb_intern("client_context_id")));
+    if (!NIL_P(client_context_id)) {
+        Check_Type(client_context_id, T_STRING);
+        req.client_context_id.assign(RSTRING_PTR(client_context_id), static_cast<size_t>(RSTRING_LEN(client_context_id)));
+    }
+    cb__extract_timeout(req, rb_hash_aref(options, rb_id2sym(rb_intern("timeout"))));
+    VALUE adhoc = rb_hash_aref(options, rb_id2sym(rb_intern("adhoc")));
+    if (!NIL_P(adhoc)) {
+        req.adhoc = RTEST(adhoc);
+    }
+    VALUE metrics = rb_hash_aref(options, rb_id2sym(rb_intern("metrics")));
+    if (!NIL_P(metrics)) {
+        req.metrics = RTEST(metrics);
+    }
+    VALUE readonly = rb_hash_aref(options, rb_id2sym(rb_intern("readonly")));
+    if (!NIL_P(readonly)) {
+        req.readonly = RTEST(readonly);
+    }
+    VALUE scan_cap = rb_hash_aref(options, rb_id2sym(rb_intern("scan_cap")));
+    if (!NIL_P(scan_cap)) {
+        req.scan_cap = NUM2ULONG(scan_cap);
+    }
+    VALUE scan_wait = rb_hash_aref(options, rb_id2sym(rb_intern("scan_wait")));
+    if (!NIL_P(scan_wait)) {
+        req.scan_wait = NUM2ULONG(scan_wait);
+    }
+    VALUE max_parallelism = rb_hash_aref(options, rb_id2sym(rb_intern("max_parallelism")));
+    if (!NIL_P(max_parallelism)) {
+        req.max_parallelism = NUM2ULONG(max_parallelism);
+    }
+    VALUE pipeline_cap = rb_hash_aref(options, rb_id2sym(rb_intern("pipeline_cap")));
+    if (!NIL_P(pipeline_cap)) {
+        req.pipeline_cap = NUM2ULONG(pipeline_cap);
+    }
+    VALUE pipeline_batch = rb_hash_aref(options, rb_id2sym(rb_intern("pipeline_batch")));
+    if (!NIL_P(pipeline_batch)) {
+        req.pipeline_batch = NUM2ULONG(pipeline_batch);
+    }
+    VALUE profile = rb_hash_aref(options, rb_id2sym(rb_intern("profile")));
+    if (!NIL_P(profile)) {
+        Check_Type(profile, T_SYMBOL);
+        ID mode = rb_sym2id(profile);
+        if (mode == rb_intern("phases")) {
+            req.profile = couchbase::operations::query_request::profile_mode::phases;
+        } else if (mode == rb_intern("timings")) {
+            req.profile = couchbase::operations::query_request::profile_mode::timings;
+        } else if (mode == rb_intern("off")) {
+            req.profile = couchbase::operations::query_request::profile_mode::off;
+        }
+    }
+    VALUE positional_params = rb_hash_aref(options, rb_id2sym(rb_intern("positional_parameters")));
+    if (!NIL_P(positional_params)) {
+        Check_Type(positional_params, T_ARRAY);
+        auto entries_num = static_cast<size_t>(RARRAY_LEN(positional_params));
+        req.positional_parameters.reserve(entries_num);
+        for (size_t i = 0; i < entries_num; ++i) {
+            VALUE entry = rb_ary_entry(positional_params, static_cast<long>(i));
+            Check_Type(entry, T_STRING);
+            req.positional_parameters.emplace_back(
+              tao::json::from_string(std::string_view(RSTRING_PTR(entry), static_cast<std::size_t>(RSTRING_LEN(entry)))));
+        }
+    }
+    VALUE named_params = rb_hash_aref(options, rb_id2sym(rb_intern("named_parameters")));
+    if (!NIL_P(named_params)) {
+        Check_Type(named_params, T_HASH);
+        rb_hash_foreach(named_params, INT_FUNC(cb__for_each_named_param), reinterpret_cast<VALUE>(&req));
+    }
+    VALUE scan_consistency = rb_hash_aref(options, rb_id2sym(rb_intern("scan_consistency")));
+    if (!NIL_P(scan_consistency)) {
+        Check_Type(scan_consistency, T_SYMBOL);
+        ID type = rb_sym2id(scan_consistency);
+        if (type == rb_intern("not_bounded")) {
+            req.scan_consistency = couchbase::operations::query_request::scan_consistency_type::not_bounded;
+        } else if (type == rb_intern("request_plus")) {
+            req.scan_consistency = couchbase::operations::query_request::scan_consistency_type::request_plus;
+        }
+    }
+    VALUE mutation_state = rb_hash_aref(options, rb_id2sym(rb_intern("mutation_state")));
+    if (!NIL_P(mutation_state)) {
+        Check_Type(mutation_state, T_ARRAY);
+        auto state_size = static_cast<size_t>(RARRAY_LEN(mutation_state));
+        req.mutation_state.reserve(state_size);
+        for (size_t i = 0; i < state_size; ++i) {
+            VALUE token = rb_ary_entry(mutation_state, static_cast<long>(i));
+            Check_Type(token, T_HASH);
+            VALUE bucket_name = rb_hash_aref(token, rb_id2sym(rb_intern("bucket_name")));
+            Check_Type(bucket_name, T_STRING);
+            VALUE partition_id = rb_hash_aref(token, rb_id2sym(rb_intern("partition_id")));
+            Check_Type(partition_id, T_FIXNUM);
+            VALUE partition_uuid = rb_hash_aref(token, rb_id2sym(rb_intern("partition_uuid")));
+            switch (TYPE(partition_uuid)) {
+                case T_FIXNUM:
+                case T_BIGNUM:
+                    break;
+                default:
+                    rb_raise(rb_eArgError, "partition_uuid must be an Integer");
+            }
+            VALUE sequence_number = rb_hash_aref(token, rb_id2sym(rb_intern("sequence_number")));
+            switch (TYPE(sequence_number)) {
+                case T_FIXNUM:
+                case T_BIGNUM:
+                    break;
+                default:
+                    rb_raise(rb_eArgError, "sequence_number must be an Integer");
+            }
+            req.mutation_state.emplace_back(
+              couchbase::mutation_token{ NUM2ULL(partition_uuid),
+                                         NUM2ULL(sequence_number),
+                                         gsl::narrow_cast<std::uint16_t>(NUM2UINT(partition_id)),
+                                         std::string(RSTRING_PTR(bucket_name), static_cast<std::size_t>(RSTRING_LEN(bucket_name))) });
+        }
+    }
+
+    VALUE raw_params = rb_hash_aref(options, rb_id2sym(rb_intern("raw_parameters")));
+    if (!NIL_P(raw_params)) {
+        Check_Type(raw_params, T_HASH);
+        rb_hash_foreach(raw_params, INT_FUNC(cb__for_each_named_param), reinterpret_cast<VALUE>(&req));
+    }
+}
+
+static VALUE
+cb__map_query_error(const std::string& statement, const couchbase::operations::query_response& resp)
+{
+    if (resp.payload.meta_data.errors && !resp.payload.meta_data.errors->empty()) {
+        const auto& first_error = resp.payload.meta_data.errors->front();
+        return cb__map_error_code(resp.ec,
+                                  fmt::format("unable to query: \"{}{}\" ({}: {})",
+                                              statement.substr(0, 50),
+                                              statement.size() > 50 ? "..." : "",
+                                              first_error.code,
+                                              first_error.message));
+    }
+    return cb__map_error_code(resp.ec,
+                              fmt::format("unable to query: \"{}{}\"", statement.substr(0, 50), statement.size() > 50 ? "..." : ""));
+}
+
+static VALUE
+cb__extract_query_result(const couchbase::operations::query_response& resp)
+{
+    VALUE res = rb_hash_new();
+    VALUE rows = rb_ary_new_capa(static_cast<long>(resp.payload.rows.size()));
+    rb_hash_aset(res, rb_id2sym(rb_intern("rows")), rows);
+    for (auto& row : resp.payload.rows) {
+        rb_ary_push(rows, rb_str_new(row.data(), static_cast<long>(row.size())));
+    }
+    VALUE meta = rb_hash_new();
+    rb_hash_aset(res, rb_id2sym(rb_intern("meta")), meta);
+    rb_hash_aset(meta,
+                 rb_id2sym(rb_intern("status")),
+                 rb_id2sym(rb_intern2(resp.payload.meta_data.status.data(), static_cast<long>(resp.payload.meta_data.status.size()))));
+    rb_hash_aset(meta,
+                 rb_id2sym(rb_intern("request_id")),
+                 rb_str_new(resp.payload.meta_data.request_id.data(), static_cast<long>(resp.payload.meta_data.request_id.size())));
+    rb_hash_aset(
+      meta,
+      rb_id2sym(rb_intern("client_context_id")),
+      rb_str_new(resp.payload.meta_data.client_context_id.data(), static_cast<long>(resp.payload.meta_data.client_context_id.size())));
+    if (resp.payload.meta_data.signature) {
+        rb_hash_aset(meta,
+                     rb_id2sym(rb_intern("signature")),
+                     rb_str_new(resp.payload.meta_data.signature->data(), static_cast<long>(resp.payload.meta_data.signature->size())));
+    }
+    if (resp.payload.meta_data.profile) {
+        rb_hash_aset(meta,
+                     rb_id2sym(rb_intern("profile")),
+                     rb_str_new(resp.payload.meta_data.profile->data(), static_cast<long>(resp.payload.meta_data.profile->size())));
+    }
+    VALUE metrics = rb_hash_new();
+    rb_hash_aset(meta, rb_id2sym(rb_intern("metrics")), metrics);
+    rb_hash_aset(metrics,
+                 rb_id2sym(rb_intern("elapsed_time")),
+                 rb_str_new(resp.payload.meta_data.metrics.elapsed_time.data(),
+                            static_cast<long>(resp.payload.meta_data.metrics.elapsed_time.size())));
+    rb_hash_aset(metrics,
+                 rb_id2sym(rb_intern("execution_time")),
+                 rb_str_new(resp.payload.meta_data.metrics.execution_time.data(),
+                            static_cast<long>(resp.payload.meta_data.metrics.execution_time.size())));
+    rb_hash_aset(metrics, rb_id2sym(rb_intern("result_count")), ULL2NUM(resp.payload.meta_data.metrics.result_count));
+    rb_hash_aset(metrics, rb_id2sym(rb_intern("result_size")), ULL2NUM(resp.payload.meta_data.metrics.result_count));
+    if (resp.payload.meta_data.metrics.sort_count) {
+        rb_hash_aset(metrics, rb_id2sym(rb_intern("sort_count")), ULL2NUM(*resp.payload.meta_data.metrics.sort_count));
+    }
+    if (resp.payload.meta_data.metrics.mutation_count) {
+        rb_hash_aset(metrics, rb_id2sym(rb_intern("mutation_count")), ULL2NUM(*resp.payload.meta_data.metrics.mutation_count));
+    }
+    if (resp.payload.meta_data.metrics.error_count) {
+        rb_hash_aset(metrics, rb_id2sym(rb_intern("error_count")), ULL2NUM(*resp.payload.meta_data.metrics.error_count));
+    }
+    if (resp.payload.meta_data.metrics.warning_count) {
+        rb_hash_aset(metrics, rb_id2sym(rb_intern("warning_count")), ULL2NUM(*resp.payload.meta_data.metrics.warning_count));
+    }
+
+    return res;
+}
+
 static VALUE
 cb_Backend_document_query(VALUE self, VALUE statement, VALUE options)
 {
@@ -1912,206 +3249,68 @@ cb_Backend_document_query(VALUE self, VALUE statement, VALUE options)
     Check_Type(options, T_HASH);
 
     VALUE exc = Qnil;
+    int jump_tag = 0;
     do {
         couchbase::operations::query_request req;
         req.statement.assign(RSTRING_PTR(statement), static_cast<size_t>(RSTRING_LEN(statement)));
-        VALUE client_context_id = rb_hash_aref(options, rb_id2sym(rb_intern("client_context_id")));
-        if (!NIL_P(client_context_id)) {
-            Check_Type(client_context_id, T_STRING);
-            req.client_context_id.assign(RSTRING_PTR(client_context_id), static_cast<size_t>(RSTRING_LEN(client_context_id)));
-        }
-        cb__extract_timeout(req, rb_hash_aref(options, rb_id2sym(rb_intern("timeout"))));
-        VALUE adhoc = rb_hash_aref(options, rb_id2sym(rb_intern("adhoc")));
-        if (!NIL_P(adhoc)) {
-            req.adhoc = RTEST(adhoc);
-        }
-        VALUE metrics = rb_hash_aref(options, rb_id2sym(rb_intern("metrics")));
-        if (!NIL_P(metrics)) {
-            req.metrics = RTEST(metrics);
-        }
-        VALUE readonly = rb_hash_aref(options, rb_id2sym(rb_intern("readonly")));
-        if (!NIL_P(readonly)) {
-            req.readonly = RTEST(readonly);
-        }
-        VALUE scan_cap = rb_hash_aref(options, rb_id2sym(rb_intern("scan_cap")));
-        if (!NIL_P(scan_cap)) {
-            req.scan_cap = NUM2ULONG(scan_cap);
-        }
-        VALUE scan_wait = rb_hash_aref(options, rb_id2sym(rb_intern("scan_wait")));
-        if (!NIL_P(scan_wait)) {
-            req.scan_wait = NUM2ULONG(scan_wait);
-        }
-        VALUE max_parallelism = rb_hash_aref(options, rb_id2sym(rb_intern("max_parallelism")));
-        if (!NIL_P(max_parallelism)) {
-            req.max_parallelism = NUM2ULONG(max_parallelism);
-        }
-        VALUE pipeline_cap = rb_hash_aref(options, rb_id2sym(rb_intern("pipeline_cap")));
-        if (!NIL_P(pipeline_cap)) {
-            req.pipeline_cap = NUM2ULONG(pipeline_cap);
-        }
-        VALUE pipeline_batch = rb_hash_aref(options, rb_id2sym(rb_intern("pipeline_batch")));
-        if (!NIL_P(pipeline_batch)) {
-            req.pipeline_batch = NUM2ULONG(pipeline_batch);
-        }
-        VALUE profile = rb_hash_aref(options, rb_id2sym(rb_intern("profile")));
-        if (!NIL_P(profile)) {
-            Check_Type(profile, T_SYMBOL);
-            ID mode = rb_sym2id(profile);
-            if (mode == rb_intern("phases")) {
-                req.profile = couchbase::operations::query_request::profile_mode::phases;
-            } else if (mode == rb_intern("timings")) {
-                req.profile = couchbase::operations::query_request::profile_mode::timings;
-            } else if (mode == rb_intern("off")) {
-                req.profile = couchbase::operations::query_request::profile_mode::off;
-            }
-        }
-        VALUE positional_params = rb_hash_aref(options, rb_id2sym(rb_intern("positional_parameters")));
-        if (!NIL_P(positional_params)) {
-            Check_Type(positional_params, T_ARRAY);
-            auto entries_num = static_cast<size_t>(RARRAY_LEN(positional_params));
-            req.positional_parameters.reserve(entries_num);
-            for (size_t i = 0; i < entries_num; ++i) {
-                VALUE entry = rb_ary_entry(positional_params, static_cast<long>(i));
-                Check_Type(entry, T_STRING);
-                req.positional_parameters.emplace_back(
-                  tao::json::from_string(std::string_view(RSTRING_PTR(entry), static_cast<std::size_t>(RSTRING_LEN(entry)))));
-            }
-        }
-        VALUE named_params = rb_hash_aref(options, rb_id2sym(rb_intern("named_parameters")));
-        if (!NIL_P(named_params)) {
-            Check_Type(named_params, T_HASH);
-            rb_hash_foreach(named_params, INT_FUNC(cb__for_each_named_param), reinterpret_cast<VALUE>(&req));
-        }
-        VALUE scan_consistency = rb_hash_aref(options, rb_id2sym(rb_intern("scan_consistency")));
-        if (!NIL_P(scan_consistency)) {
-            Check_Type(scan_consistency, T_SYMBOL);
-            ID type = rb_sym2id(scan_consistency);
-            if (type == rb_intern("not_bounded")) {
-                req.scan_consistency = couchbase::operations::query_request::scan_consistency_type::not_bounded;
-            } else if (type == rb_intern("request_plus")) {
-                req.scan_consistency = couchbase::operations::query_request::scan_consistency_type::request_plus;
-            }
-        }
-        VALUE mutation_state = rb_hash_aref(options, rb_id2sym(rb_intern("mutation_state")));
-        if (!NIL_P(mutation_state)) {
-            Check_Type(mutation_state, T_ARRAY);
-            auto state_size = static_cast<size_t>(RARRAY_LEN(mutation_state));
-            req.mutation_state.reserve(state_size);
-            for (size_t i = 0; i < state_size; ++i) {
-                VALUE token = rb_ary_entry(mutation_state, static_cast<long>(i));
-                Check_Type(token, T_HASH);
-                VALUE bucket_name = rb_hash_aref(token, rb_id2sym(rb_intern("bucket_name")));
-                Check_Type(bucket_name, T_STRING);
-                VALUE partition_id = rb_hash_aref(token, rb_id2sym(rb_intern("partition_id")));
-                Check_Type(partition_id, T_FIXNUM);
-                VALUE partition_uuid = rb_hash_aref(token, rb_id2sym(rb_intern("partition_uuid")));
-                switch (TYPE(partition_uuid)) {
-                    case T_FIXNUM:
-                    case T_BIGNUM:
-                        break;
-                    default:
-                        rb_raise(rb_eArgError, "partition_uuid must be an Integer");
-                }
-                VALUE sequence_number = rb_hash_aref(token, rb_id2sym(rb_intern("sequence_number")));
-                switch (TYPE(sequence_number)) {
-                    case T_FIXNUM:
-                    case T_BIGNUM:
-                        break;
-                    default:
-                        rb_raise(rb_eArgError, "sequence_number must be an Integer");
-                }
-                req.mutation_state.emplace_back(
-                  couchbase::mutation_token{ NUM2ULL(partition_uuid),
-                                             NUM2ULL(sequence_number),
-                                             gsl::narrow_cast<std::uint16_t>(NUM2UINT(partition_id)),
-                                             std::string(RSTRING_PTR(bucket_name), static_cast<std::size_t>(RSTRING_LEN(bucket_name))) });
-            }
-        }
-
-        VALUE raw_params = rb_hash_aref(options, rb_id2sym(rb_intern("raw_parameters")));
-        if (!NIL_P(raw_params)) {
-            Check_Type(raw_params, T_HASH);
-            rb_hash_foreach(raw_params, INT_FUNC(cb__for_each_named_param), reinterpret_cast<VALUE>(&req));
-        }
+        cb__extract_query_options(req, options);
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::query_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute_http(req, [barrier](couchbase::operations::query_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
-        if (resp.ec) {
-            if (resp.payload.meta_data.errors && !resp.payload.meta_data.errors->empty()) {
-                const auto& first_error = resp.payload.meta_data.errors->front();
-                exc = cb__map_error_code(resp.ec,
-                                         fmt::format("unable to query: \"{}{}\" ({}: {})",
-                                                     req.statement.substr(0, 50),
-                                                     req.statement.size() > 50 ? "..." : "",
-                                                     first_error.code,
-                                                     first_error.message));
-            } else {
-                exc = cb__map_error_code(
-                  resp.ec, fmt::format("unable to query: \"{}{}\"", req.statement.substr(0, 50), req.statement.size() > 50 ? "..." : ""));
+        couchbase::operations::query_response resp{};
+        if (rb_block_given_p()) {
+            resp = cb__execute_streaming_query(*backend->cluster, req, jump_tag);
+            if (jump_tag != 0) {
+                break;
             }
-            break;
-        }
-        VALUE res = rb_hash_new();
-        VALUE rows = rb_ary_new_capa(static_cast<long>(resp.payload.rows.size()));
-        rb_hash_aset(res, rb_id2sym(rb_intern("rows")), rows);
-        for (auto& row : resp.payload.rows) {
-            rb_ary_push(rows, rb_str_new(row.data(), static_cast<long>(row.size())));
-        }
-        VALUE meta = rb_hash_new();
-        rb_hash_aset(res, rb_id2sym(rb_intern("meta")), meta);
-        rb_hash_aset(meta,
-                     rb_id2sym(rb_intern("status")),
-                     rb_id2sym(rb_intern2(resp.payload.meta_data.status.data(), static_cast<long>(resp.payload.meta_data.status.size()))));
-        rb_hash_aset(meta,
-                     rb_id2sym(rb_intern("request_id")),
-                     rb_str_new(resp.payload.meta_data.request_id.data(), static_cast<long>(resp.payload.meta_data.request_id.size())));
-        rb_hash_aset(
-          meta,
-          rb_id2sym(rb_intern("client_context_id")),
-          rb_str_new(resp.payload.meta_data.client_context_id.data(), static_cast<long>(resp.payload.meta_data.client_context_id.size())));
-        if (resp.payload.meta_data.signature) {
-            rb_hash_aset(meta,
-                         rb_id2sym(rb_intern("signature")),
-                         rb_str_new(resp.payload.meta_data.signature->data(), static_cast<long>(resp.payload.meta_data.signature->size())));
-        }
-        if (resp.payload.meta_data.profile) {
-            rb_hash_aset(meta,
-                         rb_id2sym(rb_intern("profile")),
-                         rb_str_new(resp.payload.meta_data.profile->data(), static_cast<long>(resp.payload.meta_data.profile->size())));
-        }
-        metrics = rb_hash_new();
-        rb_hash_aset(meta, rb_id2sym(rb_intern("metrics")), metrics);
-        rb_hash_aset(metrics,
-                     rb_id2sym(rb_intern("elapsed_time")),
-                     rb_str_new(resp.payload.meta_data.metrics.elapsed_time.data(),
-                                static_cast<long>(resp.payload.meta_data.metrics.elapsed_time.size())));
-        rb_hash_aset(metrics,
-                     rb_id2sym(rb_intern("execution_time")),
-                     rb_str_new(resp.payload.meta_data.metrics.execution_time.data(),
-                                static_cast<long>(resp.payload.meta_data.metrics.execution_time.size())));
-        rb_hash_aset(metrics, rb_id2sym(rb_intern("result_count")), ULL2NUM(resp.payload.meta_data.metrics.result_count));
-        rb_hash_aset(metrics, rb_id2sym(rb_intern("result_size")), ULL2NUM(resp.payload.meta_data.metrics.result_count));
-        if (resp.payload.meta_data.metrics.sort_count) {
-            rb_hash_aset(metrics, rb_id2sym(rb_intern("sort_count")), ULL2NUM(*resp.payload.meta_data.metrics.sort_count));
-        }
-        if (resp.payload.meta_data.metrics.mutation_count) {
-            rb_hash_aset(metrics, rb_id2sym(rb_intern("mutation_count")), ULL2NUM(*resp.payload.meta_data.metrics.mutation_count));
-        }
-        if (resp.payload.meta_data.metrics.error_count) {
-            rb_hash_aset(metrics, rb_id2sym(rb_intern("error_count")), ULL2NUM(*resp.payload.meta_data.metrics.error_count));
+        } else {
+            auto barrier = std::make_shared<cb_promise<couchbase::operations::query_response>>();
+            auto f = barrier->get_future();
+            backend->cluster->execute_http(req,
+                                           [barrier](couchbase::operations::query_response resp) mutable { barrier->set_value(resp); });
+            resp = cb__wait_for_future(f);
         }
-        if (resp.payload.meta_data.metrics.warning_count) {
-            rb_hash_aset(metrics, rb_id2sym(rb_intern("warning_count")), ULL2NUM(*resp.payload.meta_data.metrics.warning_count));
+        if (resp.ec) {
+            exc = cb__map_query_error(req.statement, resp);
+            break;
         }
-
-        return res;
+        return cb__extract_query_result(resp);
     } while (false);
+    if (jump_tag != 0) {
+        rb_jump_tag(jump_tag);
+    }
     rb_exc_raise(exc);
     return Qnil;
 }
 
+static VALUE
+cb_Backend_document_query_async(VALUE self, VALUE statement, VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    Check_Type(statement, T_STRING);
+    Check_Type(options, T_HASH);
+
+    couchbase::operations::query_request req;
+    req.statement.assign(RSTRING_PTR(statement), static_cast<size_t>(RSTRING_LEN(statement)));
+    cb__extract_query_options(req, options);
+
+    auto completion = std::make_shared<cb_completion>(backend->completions);
+    backend->cluster->execute_http(req, [completion, statement = req.statement](couchbase::operations::query_response resp) mutable {
+        cb__completion_complete(completion, [statement = std::move(statement), resp = std::move(resp)](VALUE& exc) -> VALUE {
+            if (resp.ec) {
+                exc = cb__map_query_error(statement, resp);
+                return Qnil;
+            }
+            return cb__extract_query_result(resp);
+        });
+    });
+    return cb__future_new(completion);
+}
+
 static void
 cb__generate_bucket_settings(VALUE bucket, couchbase::operations::bucket_settings& entry, bool is_create)
 {
@@ -2224,11 +3423,11 @@ cb_Backend_bucket_create(VALUE self, VALUE bucket_settings, VALUE timeout)
         couchbase::operations::bucket_create_request req{};
         cb__extract_timeout(req, timeout);
         cb__generate_bucket_settings(bucket_settings, req.bucket, true);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::bucket_create_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::bucket_create_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::bucket_create_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(
               resp.ec, fmt::format("unable to create bucket \"{}\" on the cluster ({})", req.bucket.name, resp.error_message));
@@ -2257,11 +3456,11 @@ cb_Backend_bucket_update(VALUE self, VALUE bucket_settings, VALUE timeout)
         couchbase::operations::bucket_update_request req{};
         cb__extract_timeout(req, timeout);
         cb__generate_bucket_settings(bucket_settings, req.bucket, false);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::bucket_update_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::bucket_update_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::bucket_update_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(
               resp.ec, fmt::format("unable to update bucket \"{}\" on the cluster ({})", req.bucket.name, resp.error_message));
@@ -2290,11 +3489,11 @@ cb_Backend_bucket_drop(VALUE self, VALUE bucket_name, VALUE timeout)
         couchbase::operations::bucket_drop_request req{};
         cb__extract_timeout(req, timeout);
         req.name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::bucket_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::bucket_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::bucket_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to remove bucket \"{}\" on the cluster", req.name));
             break;
@@ -2322,11 +3521,11 @@ cb_Backend_bucket_flush(VALUE self, VALUE bucket_name, VALUE timeout)
         couchbase::operations::bucket_flush_request req{};
         cb__extract_timeout(req, timeout);
         req.name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::bucket_flush_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::bucket_flush_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::bucket_flush_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to remove bucket \"{}\" on the cluster", req.name));
             break;
@@ -2428,11 +3627,11 @@ cb_Backend_bucket_get_all(VALUE self, VALUE timeout)
     do {
         couchbase::operations::bucket_get_all_request req{};
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::bucket_get_all_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::bucket_get_all_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::bucket_get_all_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, "unable to get list of the buckets of the cluster");
             break;
@@ -2468,11 +3667,11 @@ cb_Backend_bucket_get(VALUE self, VALUE bucket_name, VALUE timeout)
         couchbase::operations::bucket_get_request req{};
         cb__extract_timeout(req, timeout);
         req.name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::bucket_get_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::bucket_get_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::bucket_get_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to locate bucket \"{}\" on the cluster", req.name));
             break;
@@ -2500,11 +3699,11 @@ cb_Backend_cluster_enable_developer_preview(VALUE self)
     VALUE exc = Qnil;
     do {
         couchbase::operations::cluster_developer_preview_enable_request req{};
-        auto barrier = std::make_shared<std::promise<couchbase::operations::cluster_developer_preview_enable_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::cluster_developer_preview_enable_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::cluster_developer_preview_enable_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to enable developer preview for this cluster"));
             break;
@@ -2535,11 +3734,11 @@ cb_Backend_scope_get_all(VALUE self, VALUE bucket_name, VALUE timeout)
         couchbase::operations::scope_get_all_request req{};
         cb__extract_timeout(req, timeout);
         req.bucket_name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::scope_get_all_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::scope_get_all_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::scope_get_all_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to get list of the scopes of the bucket \"{}\"", req.bucket_name));
             break;
@@ -2589,11 +3788,11 @@ cb_Backend_scope_create(VALUE self, VALUE bucket_name, VALUE scope_name, VALUE t
         cb__extract_timeout(req, timeout);
         req.bucket_name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
         req.scope_name.assign(RSTRING_PTR(scope_name), static_cast<size_t>(RSTRING_LEN(scope_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::scope_create_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::scope_create_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::scope_create_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to create the scope on the bucket \"{}\"", req.bucket_name));
             break;
@@ -2623,11 +3822,11 @@ cb_Backend_scope_drop(VALUE self, VALUE bucket_name, VALUE scope_name, VALUE tim
         cb__extract_timeout(req, timeout);
         req.bucket_name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
         req.scope_name.assign(RSTRING_PTR(scope_name), static_cast<size_t>(RSTRING_LEN(scope_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::scope_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::scope_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::scope_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec,
                                      fmt::format("unable to drop the scope \"{}\" on the bucket \"{}\"", req.scope_name, req.bucket_name));
@@ -2665,11 +3864,11 @@ cb_Backend_collection_create(VALUE self, VALUE bucket_name, VALUE scope_name, VA
             Check_Type(max_expiry, T_FIXNUM);
             req.max_expiry = FIX2UINT(max_expiry);
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::collection_create_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::collection_create_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::collection_create_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(
               resp.ec,
@@ -2705,11 +3904,11 @@ cb_Backend_collection_drop(VALUE self, VALUE bucket_name, VALUE scope_name, VALU
         req.scope_name.assign(RSTRING_PTR(scope_name), static_cast<size_t>(RSTRING_LEN(scope_name)));
         req.collection_name.assign(RSTRING_PTR(collection_name), static_cast<size_t>(RSTRING_LEN(collection_name)));
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::collection_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::collection_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::collection_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(
               resp.ec,
@@ -2740,11 +3939,11 @@ cb_Backend_query_index_get_all(VALUE self, VALUE bucket_name, VALUE timeout)
         couchbase::operations::query_index_get_all_request req{};
         cb__extract_timeout(req, timeout);
         req.bucket_name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::query_index_get_all_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::query_index_get_all_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::query_index_get_all_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to get list of the indexes of the bucket \"{}\"", req.bucket_name));
             break;
@@ -2837,11 +4036,11 @@ cb_Backend_query_index_create(VALUE self, VALUE bucket_name, VALUE index_name, V
             } /* else use backend default */
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::query_index_create_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::query_index_create_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::query_index_create_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (!resp.errors.empty()) {
                 const auto& first_error = resp.errors.front();
@@ -2904,11 +4103,11 @@ cb_Backend_query_index_drop(VALUE self, VALUE bucket_name, VALUE index_name, VAL
             } /* else use backend default */
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::query_index_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::query_index_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::query_index_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (!resp.errors.empty()) {
                 const auto& first_error = resp.errors.front();
@@ -2987,11 +4186,11 @@ cb_Backend_query_index_create_primary(VALUE self, VALUE bucket_name, VALUE optio
             } /* else use backend default */
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::query_index_create_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::query_index_create_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::query_index_create_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (!resp.errors.empty()) {
                 const auto& first_error = resp.errors.front();
@@ -3058,11 +4257,11 @@ cb_Backend_query_index_drop_primary(VALUE self, VALUE bucket_name, VALUE options
             }
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::query_index_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::query_index_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::query_index_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (!resp.errors.empty()) {
                 const auto& first_error = resp.errors.front();
@@ -3110,11 +4309,11 @@ cb_Backend_query_index_build_deferred(VALUE self, VALUE bucket_name, VALUE timeo
         couchbase::operations::query_index_build_deferred_request req{};
         cb__extract_timeout(req, timeout);
         req.bucket_name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::query_index_build_deferred_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::query_index_build_deferred_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::query_index_build_deferred_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (!resp.errors.empty()) {
                 const auto& first_error = resp.errors.front();
@@ -3200,11 +4399,11 @@ cb_Backend_search_index_get_all(VALUE self, VALUE timeout)
     do {
         couchbase::operations::search_index_get_all_request req{};
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_get_all_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_get_all_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_get_all_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, "unable to get list of the search indexes");
             break;
@@ -3242,11 +4441,11 @@ cb_Backend_search_index_get(VALUE self, VALUE index_name, VALUE timeout)
         couchbase::operations::search_index_get_request req{};
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_get_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_get_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_get_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to get search index \"{}\"", req.index_name));
@@ -3327,11 +4526,11 @@ cb_Backend_search_index_upsert(VALUE self, VALUE index_definition, VALUE timeout
             req.index.plan_params_json.assign(std::string(RSTRING_PTR(plan_params), static_cast<size_t>(RSTRING_LEN(plan_params))));
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_upsert_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_upsert_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_upsert_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to upsert the search index \"{}\"", req.index.name));
@@ -3364,11 +4563,11 @@ cb_Backend_search_index_drop(VALUE self, VALUE index_name, VALUE timeout)
         couchbase::operations::search_index_drop_request req{};
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to drop the search index \"{}\"", req.index_name));
@@ -3401,11 +4600,11 @@ cb_Backend_search_index_get_documents_count(VALUE self, VALUE index_name, VALUE
         couchbase::operations::search_index_get_documents_count_request req{};
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_get_documents_count_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_get_documents_count_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_get_documents_count_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(
@@ -3443,11 +4642,11 @@ cb_Backend_search_index_pause_ingest(VALUE self, VALUE index_name, VALUE timeout
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
         req.pause = true;
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_control_ingest_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_control_ingest_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_control_ingest_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to pause ingest for the search index \"{}\"", req.index_name));
@@ -3482,11 +4681,11 @@ cb_Backend_search_index_resume_ingest(VALUE self, VALUE index_name, VALUE timeou
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
         req.pause = false;
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_control_ingest_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_control_ingest_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_control_ingest_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to resume ingest for the search index \"{}\"", req.index_name));
@@ -3521,11 +4720,11 @@ cb_Backend_search_index_allow_querying(VALUE self, VALUE index_name, VALUE timeo
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
         req.allow = true;
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_control_query_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_control_query_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_control_query_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to allow querying for the search index \"{}\"", req.index_name));
@@ -3560,11 +4759,11 @@ cb_Backend_search_index_disallow_querying(VALUE self, VALUE index_name, VALUE ti
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
         req.allow = false;
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_control_query_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_control_query_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_control_query_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to disallow querying for the search index \"{}\"", req.index_name));
@@ -3599,11 +4798,11 @@ cb_Backend_search_index_freeze_plan(VALUE self, VALUE index_name, VALUE timeout)
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
         req.freeze = true;
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_control_plan_freeze_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_control_plan_freeze_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_control_plan_freeze_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to freeze for the search index \"{}\"", req.index_name));
@@ -3638,11 +4837,11 @@ cb_Backend_search_index_unfreeze_plan(VALUE self, VALUE index_name, VALUE timeou
         cb__extract_timeout(req, timeout);
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
         req.freeze = false;
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_control_plan_freeze_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_control_plan_freeze_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_control_plan_freeze_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to unfreeze plan for the search index \"{}\"", req.index_name));
@@ -3680,11 +4879,11 @@ cb_Backend_search_index_analyze_document(VALUE self, VALUE index_name, VALUE enc
         req.index_name.assign(RSTRING_PTR(index_name), static_cast<size_t>(RSTRING_LEN(index_name)));
         req.encoded_document.assign(RSTRING_PTR(encoded_document), static_cast<size_t>(RSTRING_LEN(encoded_document)));
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_index_analyze_document_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::search_index_analyze_document_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::search_index_analyze_document_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.error.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to analyze document using the search index \"{}\"", req.index_name));
@@ -3703,6 +4902,57 @@ cb_Backend_search_index_analyze_document(VALUE self, VALUE index_name, VALUE enc
     return Qnil;
 }
 
+static VALUE
+cb__extract_search_row(const couchbase::operations::search_response::search_row& entry)
+{
+    VALUE row = rb_hash_new();
+    rb_hash_aset(row, rb_id2sym(rb_intern("index")), rb_str_new(entry.index.data(), static_cast<long>(entry.index.size())));
+    rb_hash_aset(row, rb_id2sym(rb_intern("id")), rb_str_new(entry.id.data(), static_cast<long>(entry.id.size())));
+    rb_hash_aset(row, rb_id2sym(rb_intern("score")), DBL2NUM(entry.score));
+    if (!entry.locations.empty()) {
+        rb_hash_aset(
+          row, rb_id2sym(rb_intern("locations")), rb_str_new(entry.locations.data(), static_cast<long>(entry.locations.size())));
+    }
+    if (!entry.fragments.empty()) {
+        VALUE fragments = rb_hash_new();
+        for (const auto& field_fragments : entry.fragments) {
+            VALUE fragments_list = rb_ary_new_capa(static_cast<long>(field_fragments.second.size()));
+            for (const auto& fragment : field_fragments.second) {
+                rb_ary_push(fragments_list, rb_str_new(fragment.data(), static_cast<long>(fragment.size())));
+            }
+            rb_hash_aset(
+              fragments, rb_str_new(field_fragments.first.data(), static_cast<long>(field_fragments.first.size())), fragments_list);
+        }
+        rb_hash_aset(row, rb_id2sym(rb_intern("fragments")), fragments);
+    }
+    if (!entry.fields.empty()) {
+        rb_hash_aset(row, rb_id2sym(rb_intern("fields")), rb_str_new(entry.fields.data(), static_cast<long>(entry.fields.size())));
+    }
+    if (!entry.explanation.empty()) {
+        rb_hash_aset(
+          row, rb_id2sym(rb_intern("explanation")), rb_str_new(entry.explanation.data(), static_cast<long>(entry.explanation.size())));
+    }
+    return row;
+}
+
+/**
+ * Converts the hit, that has been received by the streaming search.
+ *
+ * @return Qundef if the hit cannot be parsed, such hits are skipped
+ */
+static VALUE
+cb__search_row_from_json(const std::string& json)
+{
+    couchbase::operations::search_response::search_row entry{};
+    try {
+        entry = couchbase::operations::make_search_row(tao::json::from_string(json));
+    } catch (const std::exception& e) {
+        spdlog::warn("unable to parse search hit: {}", e.what());
+        return Qundef;
+    }
+    return cb__extract_search_row(entry);
+}
+
 static VALUE
 cb_Backend_document_search(VALUE self, VALUE index_name, VALUE query, VALUE options)
 {
@@ -3718,6 +4968,7 @@ cb_Backend_document_search(VALUE self, VALUE index_name, VALUE query, VALUE opti
     Check_Type(options, T_HASH);
 
     VALUE exc = Qnil;
+    int jump_tag = 0;
     do {
         couchbase::operations::search_request req;
         VALUE client_context_id = rb_hash_aref(options, rb_id2sym(rb_intern("client_context_id")));
@@ -3858,10 +5109,19 @@ cb_Backend_document_search(VALUE self, VALUE index_name, VALUE query, VALUE opti
             rb_hash_foreach(raw_params, INT_FUNC(cb__for_each_named_param), reinterpret_cast<VALUE>(&req));
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::search_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute_http(req, [barrier](couchbase::operations::search_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        couchbase::operations::search_response resp{};
+        if (rb_block_given_p()) {
+            resp = cb__execute_streaming_query(*backend->cluster, req, jump_tag, cb__search_row_from_json);
+            if (jump_tag != 0) {
+                break;
+            }
+        } else {
+            auto barrier = std::make_shared<cb_promise<couchbase::operations::search_response>>();
+            auto f = barrier->get_future();
+            backend->cluster->execute_http(req,
+                                           [barrier](couchbase::operations::search_response resp) mutable { barrier->set_value(resp); });
+            resp = cb__wait_for_future(f);
+        }
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, fmt::format("unable to perform search query for index \"{}\"", req.index_name));
             break;
@@ -3897,49 +5157,7 @@ cb_Backend_document_search(VALUE self, VALUE index_name, VALUE query, VALUE opti
 
         VALUE rows = rb_ary_new_capa(static_cast<long>(resp.rows.size()));
         for (const auto& entry : resp.rows) {
-            VALUE row = rb_hash_new();
-            rb_hash_aset(row, rb_id2sym(rb_intern("index")), rb_str_new(entry.index.data(), static_cast<long>(entry.index.size())));
-            rb_hash_aset(row, rb_id2sym(rb_intern("id")), rb_str_new(entry.id.data(), static_cast<long>(entry.id.size())));
-            rb_hash_aset(row, rb_id2sym(rb_intern("score")), DBL2NUM(entry.score));
-            VALUE locations = rb_ary_new_capa(static_cast<long>(entry.locations.size()));
-            for (const auto& loc : entry.locations) {
-                VALUE location = rb_hash_new();
-                rb_hash_aset(row, rb_id2sym(rb_intern("field")), rb_str_new(loc.field.data(), static_cast<long>(loc.field.size())));
-                rb_hash_aset(row, rb_id2sym(rb_intern("term")), rb_str_new(loc.term.data(), static_cast<long>(loc.term.size())));
-                rb_hash_aset(row, rb_id2sym(rb_intern("pos")), ULL2NUM(loc.position));
-                rb_hash_aset(row, rb_id2sym(rb_intern("start_offset")), ULL2NUM(loc.start_offset));
-                rb_hash_aset(row, rb_id2sym(rb_intern("end_offset")), ULL2NUM(loc.end_offset));
-                if (loc.array_positions) {
-                    VALUE ap = rb_ary_new_capa(static_cast<long>(loc.array_positions->size()));
-                    for (const auto& pos : *loc.array_positions) {
-                        rb_ary_push(ap, ULL2NUM(pos));
-                    }
-                    rb_hash_aset(row, rb_id2sym(rb_intern("array_positions")), ap);
-                }
-                rb_ary_push(locations, location);
-            }
-            rb_hash_aset(row, rb_id2sym(rb_intern("locations")), locations);
-            if (!entry.fragments.empty()) {
-                VALUE fragments = rb_hash_new();
-                for (const auto& field_fragments : entry.fragments) {
-                    VALUE fragments_list = rb_ary_new_capa(static_cast<long>(field_fragments.second.size()));
-                    for (const auto& fragment : field_fragments.second) {
-                        rb_ary_push(fragments_list, rb_str_new(fragment.data(), static_cast<long>(fragment.size())));
-                    }
-                    rb_hash_aset(
-                      fragments, rb_str_new(field_fragments.first.data(), static_cast<long>(field_fragments.first.size())), fragments_list);
-                }
-                rb_hash_aset(row, rb_id2sym(rb_intern("fragments")), fragments);
-            }
-            if (!entry.fields.empty()) {
-                rb_hash_aset(row, rb_id2sym(rb_intern("fields")), rb_str_new(entry.fields.data(), static_cast<long>(entry.fields.size())));
-            }
-            if (!entry.explanation.empty()) {
-                rb_hash_aset(row,
-                             rb_id2sym(rb_intern("explanation")),
-                             rb_str_new(entry.explanation.data(), static_cast<long>(entry.explanation.size())));
-            }
-            rb_ary_push(rows, row);
+            rb_ary_push(rows, cb__extract_search_row(entry));
         }
         rb_hash_aset(res, rb_id2sym(rb_intern("rows")), rows);
 
@@ -4010,6 +5228,9 @@ cb_Backend_document_search(VALUE self, VALUE index_name, VALUE query, VALUE opti
 
         return res;
     } while (false);
+    if (jump_tag != 0) {
+        rb_jump_tag(jump_tag);
+    }
     rb_exc_raise(exc);
     return Qnil;
 }
@@ -4080,11 +5301,11 @@ cb_Backend_analytics_get_pending_mutations(VALUE self, VALUE timeout)
     do {
         couchbase::operations::analytics_get_pending_mutations_request req{};
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_get_pending_mutations_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_get_pending_mutations_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_get_pending_mutations_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, "unable to get pending mutations for the analytics service");
@@ -4120,11 +5341,11 @@ cb_Backend_analytics_dataset_get_all(VALUE self, VALUE timeout)
     do {
         couchbase::operations::analytics_dataset_get_all_request req{};
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_dataset_get_all_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_dataset_get_all_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_dataset_get_all_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, "unable to fetch all datasets");
@@ -4180,11 +5401,11 @@ cb_Backend_analytics_dataset_drop(VALUE self, VALUE dataset_name, VALUE datavers
         if (!NIL_P(ignore_if_does_not_exist)) {
             req.ignore_if_does_not_exist = RTEST(ignore_if_does_not_exist);
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_dataset_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_dataset_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_dataset_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to drop dataset `{}`.`{}`", req.dataverse_name, req.dataset_name));
@@ -4245,11 +5466,11 @@ cb_Backend_analytics_dataset_create(VALUE self,
         if (!NIL_P(ignore_if_exists)) {
             req.ignore_if_exists = RTEST(ignore_if_exists);
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_dataset_create_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_dataset_create_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_dataset_create_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to create dataset `{}`.`{}`", req.dataverse_name, req.dataset_name));
@@ -4290,11 +5511,11 @@ cb_Backend_analytics_dataverse_drop(VALUE self, VALUE dataverse_name, VALUE igno
         if (!NIL_P(ignore_if_does_not_exist)) {
             req.ignore_if_does_not_exist = RTEST(ignore_if_does_not_exist);
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_dataverse_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_dataverse_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_dataverse_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to drop dataverse `{}`", req.dataverse_name));
@@ -4335,11 +5556,11 @@ cb_Backend_analytics_dataverse_create(VALUE self, VALUE dataverse_name, VALUE ig
         if (!NIL_P(ignore_if_exists)) {
             req.ignore_if_exists = RTEST(ignore_if_exists);
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_dataverse_create_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_dataverse_create_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_dataverse_create_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to create dataverse `{}`", req.dataverse_name));
@@ -4371,11 +5592,11 @@ cb_Backend_analytics_index_get_all(VALUE self, VALUE timeout)
     do {
         couchbase::operations::analytics_index_get_all_request req{};
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_index_get_all_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_index_get_all_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_index_get_all_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, "unable to fetch all indexes");
@@ -4450,11 +5671,11 @@ cb_Backend_analytics_index_create(VALUE self,
         if (!NIL_P(ignore_if_exists)) {
             req.ignore_if_exists = RTEST(ignore_if_exists);
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_index_create_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_index_create_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_index_create_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(
@@ -4510,11 +5731,11 @@ cb_Backend_analytics_index_drop(VALUE self,
         if (!NIL_P(ignore_if_does_not_exist)) {
             req.ignore_if_does_not_exist = RTEST(ignore_if_does_not_exist);
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_index_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_index_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_index_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(
@@ -4563,11 +5784,11 @@ cb_Backend_analytics_link_connect(VALUE self, VALUE link_name, VALUE force, VALU
         if (!NIL_P(force)) {
             req.force = RTEST(force);
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_link_connect_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_link_connect_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_link_connect_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to connect link `{}` on `{}`", req.link_name, req.dataverse_name));
@@ -4611,11 +5832,11 @@ cb_Backend_analytics_link_disconnect(VALUE self, VALUE link_name, VALUE datavers
         if (!NIL_P(dataverse_name)) {
             req.dataverse_name.assign(RSTRING_PTR(dataverse_name), static_cast<size_t>(RSTRING_LEN(dataverse_name)));
         }
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_link_disconnect_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_link_disconnect_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::analytics_link_disconnect_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             if (resp.errors.empty()) {
                 exc = cb__map_error_code(resp.ec, fmt::format("unable to disconnect link `{}` on `{}`", req.link_name, req.dataverse_name));
@@ -4662,6 +5883,7 @@ cb_Backend_document_analytics(VALUE self, VALUE statement, VALUE options)
     Check_Type(options, T_HASH);
 
     VALUE exc = Qnil;
+    int jump_tag = 0;
     do {
         couchbase::operations::analytics_request req;
         req.statement.assign(RSTRING_PTR(statement), static_cast<size_t>(RSTRING_LEN(statement)));
@@ -4717,11 +5939,19 @@ cb_Backend_document_analytics(VALUE self, VALUE statement, VALUE options)
             rb_hash_foreach(raw_params, INT_FUNC(cb__for_each_named_param__analytics), reinterpret_cast<VALUE>(&req));
         }
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::analytics_response>>();
-        auto f = barrier->get_future();
-        backend->cluster->execute_http(req,
-                                       [barrier](couchbase::operations::analytics_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        couchbase::operations::analytics_response resp{};
+        if (rb_block_given_p()) {
+            resp = cb__execute_streaming_query(*backend->cluster, req, jump_tag);
+            if (jump_tag != 0) {
+                break;
+            }
+        } else {
+            auto barrier = std::make_shared<cb_promise<couchbase::operations::analytics_response>>();
+            auto f = barrier->get_future();
+            backend->cluster->execute_http(
+              req, [barrier](couchbase::operations::analytics_response resp) mutable { barrier->set_value(resp); });
+            resp = cb__wait_for_future(f);
+        }
         if (resp.ec) {
             if (resp.payload.meta_data.errors && !resp.payload.meta_data.errors->empty()) {
                 const auto& first_error = resp.payload.meta_data.errors->front();
@@ -4794,6 +6024,9 @@ cb_Backend_document_analytics(VALUE self, VALUE statement, VALUE options)
 
         return res;
     } while (false);
+    if (jump_tag != 0) {
+        rb_jump_tag(jump_tag);
+    }
     rb_exc_raise(exc);
     return Qnil;
 }
@@ -4906,11 +6139,11 @@ cb_Backend_view_index_get_all(VALUE self, VALUE bucket_name, VALUE name_space, V
         req.bucket_name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
         req.name_space = ns;
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::view_index_get_all_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::view_index_get_all_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::view_index_get_all_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(resp.ec, "unable to get list of the design documents");
             break;
@@ -4985,11 +6218,11 @@ cb_Backend_view_index_get(VALUE self, VALUE bucket_name, VALUE document_name, VA
         req.document_name.assign(RSTRING_PTR(document_name), static_cast<size_t>(RSTRING_LEN(document_name)));
         req.name_space = ns;
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::view_index_get_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::view_index_get_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::view_index_get_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(
               resp.ec,
@@ -5063,11 +6296,11 @@ cb_Backend_view_index_drop(VALUE self, VALUE bucket_name, VALUE document_name, V
         req.document_name.assign(RSTRING_PTR(document_name), static_cast<size_t>(RSTRING_LEN(document_name)));
         req.name_space = ns;
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::view_index_drop_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::view_index_drop_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::view_index_drop_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(
               resp.ec,
@@ -5139,11 +6372,11 @@ cb_Backend_view_index_upsert(VALUE self, VALUE bucket_name, VALUE document, VALU
         }
 
         cb__extract_timeout(req, timeout);
-        auto barrier = std::make_shared<std::promise<couchbase::operations::view_index_upsert_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::view_index_upsert_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(
           req, [barrier](couchbase::operations::view_index_upsert_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
             exc = cb__map_error_code(
               resp.ec,
@@ -5157,6 +6390,156 @@ cb_Backend_view_index_upsert(VALUE self, VALUE bucket_name, VALUE document, VALU
     return Qnil;
 }
 
+static void
+cb__extract_view_options(couchbase::operations::document_view_request& req, VALUE options)
+{
+    if (NIL_P(options)) {
+        return;
+    }
+    cb__extract_timeout(req, rb_hash_aref(options, rb_id2sym(rb_intern("timeout"))));
+    VALUE debug = rb_hash_aref(options, rb_id2sym(rb_intern("debug")));
+    if (!NIL_P(debug)) {
+        req.debug = RTEST(debug);
+    }
+    VALUE limit = rb_hash_aref(options, rb_id2sym(rb_intern("limit")));
+    if (!NIL_P(limit)) {
+        Check_Type(limit, T_FIXNUM);
+        req.limit = FIX2ULONG(limit);
+    }
+    VALUE skip = rb_hash_aref(options, rb_id2sym(rb_intern("skip")));
+    if (!NIL_P(skip)) {
+        Check_Type(skip, T_FIXNUM);
+        req.skip = FIX2ULONG(skip);
+    }
+    VALUE scan_consistency = rb_hash_aref(options, rb_id2sym(rb_intern("scan_consistency")));
+    if (!NIL_P(scan_consistency)) {
+        Check_Type(scan_consistency, T_SYMBOL);
+        ID consistency = rb_sym2id(scan_consistency);
+        if (consistency == rb_intern("request_plus")) {
+            req.consistency = couchbase::operations::document_view_request::scan_consistency::request_plus;
+        } else if (consistency == rb_intern("update_after")) {
+            req.consistency = couchbase::operations::document_view_request::scan_consistency::update_after;
+        } else if (consistency == rb_intern("not_bounded")) {
+            req.consistency = couchbase::operations::document_view_request::scan_consistency::not_bounded;
+        }
+    }
+    VALUE key = rb_hash_aref(options, rb_id2sym(rb_intern("key")));
+    if (!NIL_P(key)) {
+        Check_Type(key, T_STRING);
+        req.key.emplace(RSTRING_PTR(key), static_cast<size_t>(RSTRING_LEN(key)));
+    }
+    VALUE start_key = rb_hash_aref(options, rb_id2sym(rb_intern("start_key")));
+    if (!NIL_P(start_key)) {
+        Check_Type(start_key, T_STRING);
+        req.start_key.emplace(RSTRING_PTR(start_key), static_cast<size_t>(RSTRING_LEN(start_key)));
+    }
+    VALUE end_key = rb_hash_aref(options, rb_id2sym(rb_intern("end_key")));
+    if (!NIL_P(end_key)) {
+        Check_Type(end_key, T_STRING);
+        req.end_key.emplace(RSTRING_PTR(end_key), static_cast<size_t>(RSTRING_LEN(end_key)));
+    }
+    VALUE start_key_doc_id = rb_hash_aref(options, rb_id2sym(rb_intern("start_key_doc_id")));
+    if (!NIL_P(start_key_doc_id)) {
+        Check_Type(start_key_doc_id, T_STRING);
+        req.start_key_doc_id.emplace(RSTRING_PTR(start_key_doc_id), static_cast<size_t>(RSTRING_LEN(start_key_doc_id)));
+    }
+    VALUE end_key_doc_id = rb_hash_aref(options, rb_id2sym(rb_intern("end_key_doc_id")));
+    if (!NIL_P(end_key_doc_id)) {
+        Check_Type(end_key_doc_id, T_STRING);
+        req.end_key_doc_id.emplace(RSTRING_PTR(end_key_doc_id), static_cast<size_t>(RSTRING_LEN(end_key_doc_id)));
+    }
+    VALUE inclusive_end = rb_hash_aref(options, rb_id2sym(rb_intern("inclusive_end")));
+    if (!NIL_P(inclusive_end)) {
+        req.inclusive_end = RTEST(inclusive_end);
+    }
+    VALUE reduce = rb_hash_aref(options, rb_id2sym(rb_intern("reduce")));
+    if (!NIL_P(reduce)) {
+        req.reduce = RTEST(reduce);
+    }
+    VALUE group = rb_hash_aref(options, rb_id2sym(rb_intern("group")));
+    if (!NIL_P(group)) {
+        req.group = RTEST(group);
+    }
+    VALUE group_level = rb_hash_aref(options, rb_id2sym(rb_intern("group_level")));
+    if (!NIL_P(group_level)) {
+        Check_Type(group_level, T_FIXNUM);
+        req.group_level = FIX2ULONG(group_level);
+    }
+    VALUE sort_order = rb_hash_aref(options, rb_id2sym(rb_intern("order")));
+    if (!NIL_P(sort_order)) {
+        Check_Type(sort_order, T_SYMBOL);
+        ID order = rb_sym2id(sort_order);
+        if (order == rb_intern("ascending")) {
+            req.order = couchbase::operations::document_view_request::sort_order::ascending;
+        } else if (order == rb_intern("descending")) {
+            req.order = couchbase::operations::document_view_request::sort_order::descending;
+        }
+    }
+    VALUE keys = rb_hash_aref(options, rb_id2sym(rb_intern("keys")));
+    if (!NIL_P(keys)) {
+        Check_Type(keys, T_ARRAY);
+        auto entries_num = static_cast<size_t>(RARRAY_LEN(keys));
+        req.keys.reserve(entries_num);
+        for (size_t i = 0; i < entries_num; ++i) {
+            VALUE entry = rb_ary_entry(keys, static_cast<long>(i));
+            Check_Type(entry, T_STRING);
+            req.keys.emplace_back(std::string(RSTRING_PTR(entry), static_cast<std::size_t>(RSTRING_LEN(entry))));
+        }
+    }
+}
+
+static VALUE
+cb__map_view_error(const couchbase::operations::document_view_request& req, const couchbase::operations::document_view_response& resp)
+{
+    if (resp.error) {
+        return cb__map_error_code(
+          resp.ec,
+          fmt::format(R"(unable to execute query for view "{}" of design document "{}" ({}) on bucket "{}": {} ({}))",
+                      req.view_name,
+                      req.document_name,
+                      req.name_space,
+                      req.bucket_name,
+                      resp.error->code,
+                      resp.error->message));
+    }
+    return cb__map_error_code(resp.ec,
+                              fmt::format(R"(unable to execute query for view "{}" of design document "{}" ({}) on bucket "{}")",
+                                          req.view_name,
+                                          req.document_name,
+                                          req.name_space,
+                                          req.bucket_name));
+}
+
+static VALUE
+cb__extract_view_result(const couchbase::operations::document_view_response& resp)
+{
+    VALUE res = rb_hash_new();
+
+    VALUE meta = rb_hash_new();
+    if (resp.meta_data.total_rows) {
+        rb_hash_aset(meta, rb_id2sym(rb_intern("total_rows")), ULL2NUM(*resp.meta_data.total_rows));
+    }
+    if (resp.meta_data.debug_info) {
+        rb_hash_aset(meta,
+                     rb_id2sym(rb_intern("debug_info")),
+                     rb_str_new(resp.meta_data.debug_info->data(), static_cast<long>(resp.meta_data.debug_info->size())));
+    }
+    rb_hash_aset(res, rb_id2sym(rb_intern("meta")), meta);
+
+    VALUE rows = rb_ary_new_capa(static_cast<long>(resp.rows.size()));
+    for (const auto& entry : resp.rows) {
+        VALUE row = rb_hash_new();
+        if (entry.id) {
+            rb_hash_aset(row, rb_id2sym(rb_intern("id")), rb_str_new(entry.id->data(), static_cast<long>(entry.id->size())));
+        }
+        rb_hash_aset(row, rb_id2sym(rb_intern("key")), rb_str_new(entry.key.data(), static_cast<long>(entry.key.size())));
+        rb_hash_aset(row, rb_id2sym(rb_intern("value")), rb_str_new(entry.value.data(), static_cast<long>(entry.value.size())));
+        rb_ary_push(rows, row);
+    }
+    rb_hash_aset(res, rb_id2sym(rb_intern("rows")), rows);
+    return res;
+}
+
 static VALUE
 cb_Backend_document_view(VALUE self, VALUE bucket_name, VALUE design_document_name, VALUE view_name, VALUE name_space, VALUE options)
 {
@@ -5191,152 +6574,159 @@ cb_Backend_document_view(VALUE self, VALUE bucket_name, VALUE design_document_na
         req.document_name.assign(RSTRING_PTR(design_document_name), static_cast<size_t>(RSTRING_LEN(design_document_name)));
         req.view_name.assign(RSTRING_PTR(view_name), static_cast<size_t>(RSTRING_LEN(view_name)));
         req.name_space = ns;
-        if (!NIL_P(options)) {
-            cb__extract_timeout(req, rb_hash_aref(options, rb_id2sym(rb_intern("timeout"))));
-            VALUE debug = rb_hash_aref(options, rb_id2sym(rb_intern("debug")));
-            if (!NIL_P(debug)) {
-                req.debug = RTEST(debug);
-            }
-            VALUE limit = rb_hash_aref(options, rb_id2sym(rb_intern("limit")));
-            if (!NIL_P(limit)) {
-                Check_Type(limit, T_FIXNUM);
-                req.limit = FIX2ULONG(limit);
-            }
-            VALUE skip = rb_hash_aref(options, rb_id2sym(rb_intern("skip")));
-            if (!NIL_P(skip)) {
-                Check_Type(skip, T_FIXNUM);
-                req.skip = FIX2ULONG(skip);
-            }
-            VALUE scan_consistency = rb_hash_aref(options, rb_id2sym(rb_intern("scan_consistency")));
-            if (!NIL_P(scan_consistency)) {
-                Check_Type(scan_consistency, T_SYMBOL);
-                ID consistency = rb_sym2id(scan_consistency);
-                if (consistency == rb_intern("request_plus")) {
-                    req.consistency = couchbase::operations::document_view_request::scan_consistency::request_plus;
-                } else if (consistency == rb_intern("update_after")) {
-                    req.consistency = couchbase::operations::document_view_request::scan_consistency::update_after;
-                } else if (consistency == rb_intern("not_bounded")) {
-                    req.consistency = couchbase::operations::document_view_request::scan_consistency::not_bounded;
-                }
-            }
-            VALUE key = rb_hash_aref(options, rb_id2sym(rb_intern("key")));
-            if (!NIL_P(key)) {
-                Check_Type(key, T_STRING);
-                req.key.emplace(RSTRING_PTR(key), static_cast<size_t>(RSTRING_LEN(key)));
-            }
-            VALUE start_key = rb_hash_aref(options, rb_id2sym(rb_intern("start_key")));
-            if (!NIL_P(start_key)) {
-                Check_Type(start_key, T_STRING);
-                req.start_key.emplace(RSTRING_PTR(start_key), static_cast<size_t>(RSTRING_LEN(start_key)));
-            }
-            VALUE end_key = rb_hash_aref(options, rb_id2sym(rb_intern("end_key")));
-            if (!NIL_P(end_key)) {
-                Check_Type(end_key, T_STRING);
-                req.end_key.emplace(RSTRING_PTR(end_key), static_cast<size_t>(RSTRING_LEN(end_key)));
-            }
-            VALUE start_key_doc_id = rb_hash_aref(options, rb_id2sym(rb_intern("start_key_doc_id")));
-            if (!NIL_P(start_key_doc_id)) {
-                Check_Type(start_key_doc_id, T_STRING);
-                req.start_key_doc_id.emplace(RSTRING_PTR(start_key_doc_id), static_cast<size_t>(RSTRING_LEN(start_key_doc_id)));
-            }
-            VALUE end_key_doc_id = rb_hash_aref(options, rb_id2sym(rb_intern("end_key_doc_id")));
-            if (!NIL_P(end_key_doc_id)) {
-                Check_Type(end_key_doc_id, T_STRING);
-                req.end_key_doc_id.emplace(RSTRING_PTR(end_key_doc_id), static_cast<size_t>(RSTRING_LEN(end_key_doc_id)));
-            }
-            VALUE inclusive_end = rb_hash_aref(options, rb_id2sym(rb_intern("inclusive_end")));
-            if (!NIL_P(inclusive_end)) {
-                req.inclusive_end = RTEST(inclusive_end);
-            }
-            VALUE reduce = rb_hash_aref(options, rb_id2sym(rb_intern("reduce")));
-            if (!NIL_P(reduce)) {
-                req.reduce = RTEST(reduce);
-            }
-            VALUE group = rb_hash_aref(options, rb_id2sym(rb_intern("group")));
-            if (!NIL_P(group)) {
-                req.group = RTEST(group);
-            }
-            VALUE group_level = rb_hash_aref(options, rb_id2sym(rb_intern("group_level")));
-            if (!NIL_P(group_level)) {
-                Check_Type(group_level, T_FIXNUM);
-                req.group_level = FIX2ULONG(group_level);
-            }
-            VALUE sort_order = rb_hash_aref(options, rb_id2sym(rb_intern("order")));
-            if (!NIL_P(sort_order)) {
-                Check_Type(sort_order, T_SYMBOL);
-                ID order = rb_sym2id(sort_order);
-                if (order == rb_intern("ascending")) {
-                    req.order = couchbase::operations::document_view_request::sort_order::ascending;
-                } else if (order == rb_intern("descending")) {
-                    req.order = couchbase::operations::document_view_request::sort_order::descending;
-                }
-            }
-            VALUE keys = rb_hash_aref(options, rb_id2sym(rb_intern("keys")));
-            if (!NIL_P(keys)) {
-                Check_Type(keys, T_ARRAY);
-                auto entries_num = static_cast<size_t>(RARRAY_LEN(keys));
-                req.keys.reserve(entries_num);
-                for (size_t i = 0; i < entries_num; ++i) {
-                    VALUE entry = rb_ary_entry(keys, static_cast<long>(i));
-                    Check_Type(entry, T_STRING);
-                    req.keys.emplace_back(std::string(RSTRING_PTR(entry), static_cast<std::size_t>(RSTRING_LEN(entry))));
-                }
-            }
-        }
+        cb__extract_view_options(req, options);
 
-        auto barrier = std::make_shared<std::promise<couchbase::operations::document_view_response>>();
+        auto barrier = std::make_shared<cb_promise<couchbase::operations::document_view_response>>();
         auto f = barrier->get_future();
         backend->cluster->execute_http(req,
                                        [barrier](couchbase::operations::document_view_response resp) mutable { barrier->set_value(resp); });
-        auto resp = f.get();
+        auto resp = cb__wait_for_future(f);
         if (resp.ec) {
-            if (resp.error) {
-                exc = cb__map_error_code(
-                  resp.ec,
-                  fmt::format(R"(unable to execute query for view "{}" of design document "{}" ({}) on bucket "{}": {} ({}))",
-                              req.view_name,
-                              req.document_name,
-                              req.name_space,
-                              req.bucket_name,
-                              resp.error->code,
-                              resp.error->message));
-            } else {
-                exc = cb__map_error_code(resp.ec,
-                                         fmt::format(R"(unable to execute query for view "{}" of design document "{}" ({}) on bucket "{}")",
-                                                     req.view_name,
-                                                     req.document_name,
-                                                     req.name_space,
-                                                     req.bucket_name));
-            }
+            exc = cb__map_view_error(req, resp);
             break;
         }
-        VALUE res = rb_hash_new();
+        return cb__extract_view_result(resp);
+    } while (false);
+    rb_exc_raise(exc);
+    return Qnil;
+}
 
-        VALUE meta = rb_hash_new();
-        if (resp.meta_data.total_rows) {
-            rb_hash_aset(meta, rb_id2sym(rb_intern("total_rows")), ULL2NUM(*resp.meta_data.total_rows));
+static VALUE
+cb__yield_view_rows(VALUE rows)
+{
+    for (long i = 0; i < RARRAY_LEN(rows); ++i) {
+        rb_yield(rb_ary_entry(rows, i));
+    }
+    return Qnil;
+}
+
+static cb_future<couchbase::operations::document_view_response>
+cb__fetch_view_page(couchbase::cluster& cluster, couchbase::operations::document_view_request req)
+{
+    auto barrier = std::make_shared<cb_promise<couchbase::operations::document_view_response>>();
+    auto f = barrier->get_future();
+    cluster.execute_http(req, [barrier](couchbase::operations::document_view_response resp) mutable { barrier->set_value(resp); });
+    return f;
+}
+
+/**
+ * Yields all rows of the view, fetching them with pages of fixed size.
+ *
+ * Every next page starts at the key and document ID of the last row of the previous one (keyset pagination), so the
+ * view engine does not have to walk over the rows, that have been already returned, as it does for "skip". The next
+ * page is requested before the rows of the current page are yielded, so at most two pages are kept in memory.
+ *
+ * Only options, that do not contradict the pagination are accepted: "skip" is ignored, "limit" restricts the total
+ * number of rows, and the rows are never reduced.
+ *
+ * @return metadata of the last page
+ */
+static VALUE
+cb_Backend_document_view_scan(VALUE self, VALUE bucket_name, VALUE design_document_name, VALUE view_name, VALUE name_space, VALUE options)
+{
+    cb_backend_data* backend = nullptr;
+    TypedData_Get_Struct(self, cb_backend_data, &cb_backend_type, backend);
+
+    if (!backend->cluster) {
+        rb_raise(rb_eArgError, "Cluster has been closed already");
+    }
+
+    Check_Type(bucket_name, T_STRING);
+    Check_Type(design_document_name, T_STRING);
+    Check_Type(view_name, T_STRING);
+    Check_Type(name_space, T_SYMBOL);
+    couchbase::operations::design_document::name_space ns;
+    ID type = rb_sym2id(name_space);
+    if (type == rb_intern("development")) {
+        ns = couchbase::operations::design_document::name_space::development;
+    } else if (type == rb_intern("production")) {
+        ns = couchbase::operations::design_document::name_space::production;
+    } else {
+        rb_raise(rb_eArgError, "Unknown design document namespace: %+" PRIsVALUE, type);
+    }
+    if (!NIL_P(options)) {
+        Check_Type(options, T_HASH);
+    }
+
+    if (!rb_block_given_p()) {
+        rb_raise(rb_eArgError, "block required to receive rows");
+    }
+    std::uint64_t page_size = 1000;
+    if (!NIL_P(options)) {
+        VALUE page_size_val = rb_hash_aref(options, rb_id2sym(rb_intern("page_size")));
+        if (!NIL_P(page_size_val)) {
+            Check_Type(page_size_val, T_FIXNUM);
+            if (FIX2LONG(page_size_val) <= 0) {
+                rb_raise(rb_eArgError, "page_size must be positive");
+            }
+            page_size = FIX2ULONG(page_size_val);
         }
-        if (resp.meta_data.debug_info) {
-            rb_hash_aset(meta,
-                         rb_id2sym(rb_intern("debug_info")),
-                         rb_str_new(resp.meta_data.debug_info->data(), static_cast<long>(resp.meta_data.debug_info->size())));
+    }
+
+    VALUE exc = Qnil;
+    int jump_tag = 0;
+    do {
+        couchbase::operations::document_view_request req{};
+        req.bucket_name.assign(RSTRING_PTR(bucket_name), static_cast<size_t>(RSTRING_LEN(bucket_name)));
+        req.document_name.assign(RSTRING_PTR(design_document_name), static_cast<size_t>(RSTRING_LEN(design_document_name)));
+        req.view_name.assign(RSTRING_PTR(view_name), static_cast<size_t>(RSTRING_LEN(view_name)));
+        req.name_space = ns;
+        cb__extract_view_options(req, options);
+        if (req.key || !req.keys.empty()) {
+            exc = rb_exc_new_cstr(rb_eArgError, "view scan does not support key and keys options");
+            break;
         }
-        rb_hash_aset(res, rb_id2sym(rb_intern("meta")), meta);
 
-        VALUE rows = rb_ary_new_capa(static_cast<long>(resp.rows.size()));
-        for (const auto& entry : resp.rows) {
-            VALUE row = rb_hash_new();
-            if (entry.id) {
-                rb_hash_aset(row, rb_id2sym(rb_intern("id")), rb_str_new(entry.id->data(), static_cast<long>(entry.id->size())));
+        std::optional<std::uint64_t> remaining = req.limit;
+        req.reduce = false;
+        req.skip.reset();
+        req.limit = remaining ? std::min(page_size, *remaining) : page_size;
+        auto current = cb__fetch_view_page(*backend->cluster, req);
+        bool continuation = false;
+        VALUE meta = Qnil;
+        while (true) {
+            auto resp = cb__wait_for_future(current);
+            if (resp.ec) {
+                exc = cb__map_view_error(req, resp);
+                break;
+            }
+            bool has_next = resp.rows.size() == req.limit && resp.rows.back().id.has_value();
+            if (continuation && !resp.rows.empty() && resp.rows.front().key == req.start_key &&
+                resp.rows.front().id == req.start_key_doc_id) {
+                // the page starts with the last row of the previous page, unless it has been removed in the meantime
+                resp.rows.erase(resp.rows.begin());
+            }
+            if (remaining) {
+                if (resp.rows.size() > *remaining) {
+                    resp.rows.resize(*remaining);
+                }
+                *remaining -= resp.rows.size();
+                has_next = has_next && *remaining > 0;
+            }
+            if (has_next) {
+                // prefetch the next page while the application consumes current one
+                const auto& last = resp.rows.back();
+                req.start_key = last.key;
+                req.start_key_doc_id = last.id;
+                req.limit = (remaining ? std::min(page_size, *remaining) : page_size) + 1;
+                current = cb__fetch_view_page(*backend->cluster, req);
+                continuation = true;
+            }
+            VALUE res = cb__extract_view_result(resp);
+            meta = rb_hash_aref(res, rb_id2sym(rb_intern("meta")));
+            rb_protect(cb__yield_view_rows, rb_hash_aref(res, rb_id2sym(rb_intern("rows"))), &jump_tag);
+            if (jump_tag != 0 || !has_next) {
+                break;
             }
-            rb_hash_aset(row, rb_id2sym(rb_intern("key")), rb_str_new(entry.key.data(), static_cast<long>(entry.key.size())));
-            rb_hash_aset(row, rb_id2sym(rb_intern("value")), rb_str_new(entry.value.data(), static_cast<long>(entry.value.size())));
-            rb_ary_push(rows, row);
         }
-        rb_hash_aset(res, rb_id2sym(rb_intern("rows")), rows);
-
-        return res;
+        if (!NIL_P(exc) || jump_tag != 0) {
+            break;
+        }
+        return meta;
     } while (false);
+    if (jump_tag != 0) {
+        rb_jump_tag(jump_tag);
+    }
     rb_exc_raise(exc);
     return Qnil;
 }
@@ -5349,15 +6739,20 @@ init_backend(VALUE mCouchbase)
     rb_define_method(cBackend, "open", VALUE_FUNC(cb_Backend_open), 3);
     rb_define_method(cBackend, "close", VALUE_FUNC(cb_Backend_close), 0);
     rb_define_method(cBackend, "open_bucket", VALUE_FUNC(cb_Backend_open_bucket), 2);
+    rb_define_method(cBackend, "metrics", VALUE_FUNC(cb_Backend_metrics), 1);
 
     rb_define_method(cBackend, "document_get", VALUE_FUNC(cb_Backend_document_get), 4);
+    rb_define_method(cBackend, "document_get_multi", VALUE_FUNC(cb_Backend_document_get_multi), 4);
     rb_define_method(cBackend, "document_get_projected", VALUE_FUNC(cb_Backend_document_get_projected), 7);
     rb_define_method(cBackend, "document_get_and_lock", VALUE_FUNC(cb_Backend_document_get_and_lock), 5);
     rb_define_method(cBackend, "document_get_and_touch", VALUE_FUNC(cb_Backend_document_get_and_touch), 5);
+    rb_define_method(cBackend, "document_get_any_replica", VALUE_FUNC(cb_Backend_document_get_any_replica), 4);
+    rb_define_method(cBackend, "document_get_all_replicas", VALUE_FUNC(cb_Backend_document_get_all_replicas), 4);
     rb_define_method(cBackend, "document_insert", VALUE_FUNC(cb_Backend_document_insert), 7);
     rb_define_method(cBackend, "document_replace", VALUE_FUNC(cb_Backend_document_replace), 7);
     rb_define_method(cBackend, "document_upsert", VALUE_FUNC(cb_Backend_document_upsert), 7);
     rb_define_method(cBackend, "document_remove", VALUE_FUNC(cb_Backend_document_remove), 5);
+    rb_define_method(cBackend, "document_mutate_multi", VALUE_FUNC(cb_Backend_document_mutate_multi), 4);
     rb_define_method(cBackend, "document_lookup_in", VALUE_FUNC(cb_Backend_document_lookup_in), 6);
     rb_define_method(cBackend, "document_mutate_in", VALUE_FUNC(cb_Backend_document_mutate_in), 6);
     rb_define_method(cBackend, "document_query", VALUE_FUNC(cb_Backend_document_query), 2);
@@ -5369,6 +6764,20 @@ init_backend(VALUE mCouchbase)
     rb_define_method(cBackend, "document_search", VALUE_FUNC(cb_Backend_document_search), 3);
     rb_define_method(cBackend, "document_analytics", VALUE_FUNC(cb_Backend_document_analytics), 2);
     rb_define_method(cBackend, "document_view", VALUE_FUNC(cb_Backend_document_view), 5);
+    rb_define_method(cBackend, "document_view_scan", VALUE_FUNC(cb_Backend_document_view_scan), 5);
+
+    init_future(cBackend);
+    rb_define_method(cBackend, "document_get_async", VALUE_FUNC(cb_Backend_document_get_async), 4);
+    rb_define_method(cBackend, "document_insert_async", VALUE_FUNC(cb_Backend_document_insert_async), 7);
+    rb_define_method(cBackend, "document_replace_async", VALUE_FUNC(cb_Backend_document_replace_async), 7);
+    rb_define_method(cBackend, "document_upsert_async", VALUE_FUNC(cb_Backend_document_upsert_async), 7);
+    rb_define_method(cBackend, "document_remove_async", VALUE_FUNC(cb_Backend_document_remove_async), 5);
+    rb_define_method(cBackend, "document_get_and_lock_async", VALUE_FUNC(cb_Backend_document_get_and_lock_async), 5);
+    rb_define_method(cBackend, "document_get_and_touch_async", VALUE_FUNC(cb_Backend_document_get_and_touch_async), 5);
+    rb_define_method(cBackend, "document_touch_async", VALUE_FUNC(cb_Backend_document_touch_async), 5);
+    rb_define_method(cBackend, "document_exists_async", VALUE_FUNC(cb_Backend_document_exists_async), 4);
+    rb_define_method(cBackend, "document_unlock_async", VALUE_FUNC(cb_Backend_document_unlock_async), 5);
+    rb_define_method(cBackend, "document_query_async", VALUE_FUNC(cb_Backend_document_query_async), 2);
 
     rb_define_method(cBackend, "bucket_create", VALUE_FUNC(cb_Backend_bucket_create), 2);
     rb_define_method(cBackend, "bucket_update", VALUE_FUNC(cb_Backend_bucket_update), 2);
@@ -20,11 +20,28 @@
 namespace couchbase
 {
 struct error_map {
+    /**
+     * Retry specification, that the server attaches to the retriable errors (error map version 2)
+     */
+    struct retry_specification {
+        enum class strategy { constant, linear, exponential };
+        strategy backoff{ strategy::constant };
+        std::chrono::milliseconds interval{ 0 };     // base interval of the strategy
+        std::chrono::milliseconds after{ 0 };        // delay before the first retry
+        std::chrono::milliseconds ceil{ 0 };         // maximum delay between retries, zero means no limit
+        std::chrono::milliseconds max_duration{ 0 }; // maximum time since the first attempt, zero means no limit
+    };
     struct error_info {
         std::uint16_t code;
         std::string name;
         std::string description;
         std::set<std::string> attributes;
+        std::optional<retry_specification> retry{};
+
+        [[nodiscard]] bool has_attribute(const std::string& attribute) const
+        {
+            return attributes.find(attribute) != attributes.end();
+        }
     };
     uuid::uuid_t id;
     uint16_t version;
@@ -42,7 +59,7 @@ struct traits<couchbase::error_map> {
     {
         couchbase::error_map result;
         result.id = couchbase::uuid::random();
-        result.version = v.at("revision").template as<std::uint16_t>();
+        result.version = v.at("version").template as<std::uint16_t>();
         result.revision = v.at("revision").template as<std::uint16_t>();
         for (const auto& j : v.at("errors").get_object()) {
             couchbase::error_map::error_info ei;
@@ -53,6 +70,20 @@ struct traits<couchbase::error_map> {
             for (const auto& a : info.at("attrs").get_array()) {
                 ei.attributes.insert(a.get_string());
             }
+            if (const auto r = info.find("retry"); r != info.end() && r->second.is_object()) {
+                couchbase::error_map::retry_specification spec{};
+                auto strategy = r->second.template optional<std::string>("strategy").value_or("constant");
+                if (strategy == "linear") {
+                    spec.backoff = couchbase::error_map::retry_specification::strategy::linear;
+                } else if (strategy == "exponential") {
+                    spec.backoff = couchbase::error_map::retry_specification::strategy::exponential;
+                }
+                spec.interval = std::chrono::milliseconds(r->second.template optional<std::uint32_t>("interval").value_or(0));
+                spec.after = std::chrono::milliseconds(r->second.template optional<std::uint32_t>("after").value_or(0));
+                spec.ceil = std::chrono::milliseconds(r->second.template optional<std::uint32_t>("ceil").value_or(0));
+                spec.max_duration = std::chrono::milliseconds(r->second.template optional<std::uint32_t>("max-duration").value_or(0));
+                ei.retry.emplace(spec);
+            }
             result.errors.emplace(ei.code, ei);
         }
         return result;
@@ -299,6 +299,9 @@ enum class network_errc {
 
     /// Unexpected protocol state or input
     protocol_error,
+
+    /// The node does not own the partition of the key, and the configuration has to be refreshed
+    configuration_not_available,
 };
 
 namespace detail
@@ -590,6 +593,8 @@ struct network_error_category : std::error_category {
                 return "handshake_failure";
             case network_errc::protocol_error:
                 return "protocol_error";
+            case network_errc::configuration_not_available:
+                return "configuration_not_available";
         }
         return "FIXME: unknown error code in network category (recompile with newer library)";
     }
@@ -17,7 +17,10 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <io/http_session.hxx>
+#include <io/timer_wheel.hxx>
 
 namespace couchbase::operations
 {
@@ -26,14 +29,15 @@ template<typename Request>
 struct http_command : public std::enable_shared_from_this<http_command<Request>> {
     using encoded_request_type = typename Request::encoded_request_type;
     using encoded_response_type = typename Request::encoded_response_type;
-    asio::steady_timer deadline;
-    asio::steady_timer retry_backoff;
+    std::shared_ptr<io::timer_wheel> timers_;
+    std::atomic<io::timer_wheel::timer_id> deadline_timer_{ 0 };
+    std::atomic_bool completed_{ false };
     Request request;
     encoded_request_type encoded;
+    std::atomic<std::uint64_t> session_request_id{ 0 }; // identifier of the request in the session, used for cancellation
 
-    http_command(asio::io_context& ctx, Request req)
-      : deadline(ctx)
-      , retry_backoff(ctx)
+    http_command(std::shared_ptr<io::timer_wheel> timers, Request req)
+      : timers_(std::move(timers))
       , request(req)
     {
     }
@@ -60,31 +64,35 @@ struct http_command : public std::enable_shared_from_this<http_command<Request>>
                      request.client_context_id,
                      request.timeout.count(),
                      spdlog::to_hex(encoded.body));
-        session->write_and_subscribe(encoded,
-                                     [self = this->shared_from_this(), log_prefix, handler = std::forward<Handler>(handler)](
-                                       std::error_code ec, io::http_response&& msg) mutable {
-                                         self->deadline.cancel();
-                                         encoded_response_type resp(msg);
-                                         spdlog::debug("{} HTTP response: {}, client_context_id={}, status={}",
-                                                       log_prefix,
-                                                       self->request.type,
-                                                       self->request.client_context_id,
-                                                       resp.status_code);
-                                         SPDLOG_TRACE("{} HTTP response: {}, client_context_id={}, status={}{:a}",
-                                                      log_prefix,
-                                                      self->request.type,
-                                                      self->request.client_context_id,
-                                                      resp.status_code,
-                                                      spdlog::to_hex(resp.body));
-                                         handler(make_response(ec, self->request, resp));
-                                     });
-        deadline.expires_after(request.timeout);
-        deadline.async_wait([session](std::error_code ec) {
-            if (ec == asio::error::operation_aborted) {
-                return;
-            }
-            session->stop();
+        session_request_id = session->write_and_subscribe(
+          encoded,
+          [self = this->shared_from_this(), log_prefix, handler = std::forward<Handler>(handler)](
+            std::error_code ec, io::http_response&& msg) mutable {
+              self->completed_ = true;
+              self->timers_->cancel(self->deadline_timer_.exchange(0));
+              encoded_response_type resp(msg);
+              spdlog::debug("{} HTTP response: {}, client_context_id={}, status={}",
+                            log_prefix,
+                            self->request.type,
+                            self->request.client_context_id,
+                            resp.status_code);
+              SPDLOG_TRACE("{} HTTP response: {}, client_context_id={}, status={}{:a}",
+                           log_prefix,
+                           self->request.type,
+                           self->request.client_context_id,
+                           resp.status_code,
+                           spdlog::to_hex(resp.body));
+              handler(make_response(ec, self->request, resp));
+          });
+        // the deadline is armed after the request got its identifier, otherwise the timer might cancel nothing
+        deadline_timer_ = timers_->schedule_after(request.timeout, [self = this->shared_from_this(), session](std::error_code ec) {
+            // the session might have been reused by another request, so only this request has to be cancelled
+            session->cancel(self->session_request_id, ec ? ec : std::make_error_code(error::common_errc::ambiguous_timeout));
         });
+        if (completed_) {
+            // the response has been handled on another thread before the timer was armed
+            timers_->cancel(deadline_timer_.exchange(0));
+        }
     }
 };
 
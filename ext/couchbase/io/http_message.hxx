@@ -17,16 +17,116 @@
 
 #pragma once
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
 #include <service_type.hxx>
 
 namespace couchbase::io
 {
+/**
+ * Flow control of the streamed rows, shared by the consumer of the rows and the session.
+ *
+ * The consumer pauses the stream when it cannot keep up with the rows, and the session does not read from the socket
+ * until the stream is resumed. The consumer also cancels the request, when it is not interested in the rest of the rows.
+ */
+class http_streaming_control
+{
+  public:
+    void pause()
+    {
+        std::scoped_lock lock(mutex_);
+        paused_ = true;
+    }
+
+    void resume()
+    {
+        std::function<void()> handler{};
+        {
+            std::scoped_lock lock(mutex_);
+            paused_ = false;
+            std::swap(handler, resume_handler_);
+        }
+        if (handler) {
+            handler();
+        }
+    }
+
+    void cancel()
+    {
+        std::function<void()> handler{};
+        {
+            std::scoped_lock lock(mutex_);
+            cancelled_ = true;
+            paused_ = false;
+            resume_handler_ = nullptr;
+            std::swap(handler, cancel_handler_);
+        }
+        if (handler) {
+            handler();
+        }
+    }
+
+    /**
+     * Called by the session after the received data has been parsed.
+     *
+     * @return true if the stream is paused, the handler will be invoked when it is resumed
+     */
+    bool pause_reading(std::function<void()>&& resume_handler)
+    {
+        std::scoped_lock lock(mutex_);
+        if (!paused_) {
+            return false;
+        }
+        resume_handler_ = std::move(resume_handler);
+        return true;
+    }
+
+    /**
+     * Called by the session when the request has been written. The handler is invoked immediately, if the consumer has
+     * already cancelled the request.
+     */
+    void on_cancel(std::function<void()>&& handler)
+    {
+        {
+            std::scoped_lock lock(mutex_);
+            if (!cancelled_) {
+                cancel_handler_ = std::move(handler);
+                return;
+            }
+        }
+        handler();
+    }
+
+  private:
+    std::mutex mutex_{};
+    bool paused_{ false };
+    bool cancelled_{ false };
+    std::function<void()> resume_handler_{};
+    std::function<void()> cancel_handler_{};
+};
+
+/**
+ * Delivers elements of the top-level array of the response body (e.g. "results" of the query) as soon as they arrive.
+ * The body of the response keeps the rest of the document, with the array left empty.
+ */
+struct http_streaming {
+    std::string rows_key;
+    std::function<void(std::string&&)> row_handler;
+    std::shared_ptr<http_streaming_control> control{}; // optional
+};
+
 struct http_request {
     service_type type;
     std::string method;
     std::string path;
     std::map<std::string, std::string> headers;
     std::string body;
+    std::optional<http_streaming> streaming{};
 };
 
 struct http_response {
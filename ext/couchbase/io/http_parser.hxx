@@ -17,8 +17,11 @@
 
 #pragma once
 
+#include <optional>
+
 #include <http_parser.h>
 #include <io/http_message.hxx>
+#include <utils/json_row_streamer.hxx>
 
 namespace couchbase::io
 {
@@ -31,6 +34,8 @@ struct http_parser {
     http_response response;
     std::string header_field;
     bool complete{ false };
+    bool keep_alive{ false };
+    std::optional<utils::json_row_streamer> streamer{};
 
     http_parser()
     {
@@ -51,8 +56,10 @@ struct http_parser {
     void reset()
     {
         complete = false;
+        keep_alive = false;
         response = {};
         header_field = {};
+        streamer.reset();
         ::http_parser_init(&parser_, HTTP_RESPONSE);
     }
 
@@ -65,6 +72,14 @@ struct http_parser {
         return status::ok;
     }
 
+    /**
+     * Makes the parser hand the rows of the next response to the handler, instead of accumulating them in the body.
+     */
+    void stream_rows(const http_streaming& streaming)
+    {
+        streamer.emplace(streaming.rows_key, streaming.row_handler);
+    }
+
     int on_headers_complete()
     {
         return 0;
@@ -88,6 +103,10 @@ struct http_parser {
     int on_message_complete()
     {
         complete = true;
+        if (streamer) {
+            response.body = streamer->metadata();
+        }
+        keep_alive = ::http_should_keep_alive(&parser_) != 0;
         return 0;
     }
 
@@ -117,6 +136,10 @@ struct http_parser {
 
     int on_body(const char* at, std::size_t length)
     {
+        if (streamer) {
+            streamer->feed(std::string_view(at, length));
+            return 0;
+        }
         response.body.append(at, length);
         return 0;
     }
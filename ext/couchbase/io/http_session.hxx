@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <utility>
 #include <memory>
 
@@ -28,10 +29,12 @@
 #include <platform/uuid.h>
 
 #include <errors.hxx>
+#include <metrics_registry.hxx>
 #include <version.hxx>
 
 #include <io/http_parser.hxx>
 #include <io/http_message.hxx>
+#include <io/streams.hxx>
 #include <platform/base64.h>
 #include <timeout_defaults.hxx>
 
@@ -50,10 +53,40 @@ class http_session : public std::enable_shared_from_this<http_session>
       : client_id_(client_id)
       , id_(uuid::to_string(uuid::random()))
       , ctx_(ctx)
-      , resolver_(ctx_)
       , strand_(asio::make_strand(ctx_))
-      , socket_(strand_)
-      , deadline_timer_(ctx_)
+      , resolver_(strand_)
+      , stream_(std::make_unique<plain_stream_impl>(strand_))
+      , deadline_timer_(strand_)
+      , username_(username)
+      , password_(password)
+      , hostname_(hostname)
+      , service_(service)
+      , user_agent_(fmt::format("ruby/{}.{}.{}/{}; client/{}; session/{}; {}",
+                                BACKEND_VERSION_MAJOR,
+                                BACKEND_VERSION_MINOR,
+                                BACKEND_VERSION_PATCH,
+                                BACKEND_GIT_REVISION,
+                                client_id_,
+                                id_,
+                                BACKEND_SYSTEM))
+    {
+        log_prefix_ = fmt::format("[{}/{}]", client_id_, id_);
+    }
+
+    http_session(const std::string& client_id,
+                 asio::io_context& ctx,
+                 asio::ssl::context& tls,
+                 const std::string& username,
+                 const std::string& password,
+                 const std::string& hostname,
+                 const std::string& service)
+      : client_id_(client_id)
+      , id_(uuid::to_string(uuid::random()))
+      , ctx_(ctx)
+      , strand_(asio::make_strand(ctx_))
+      , resolver_(strand_)
+      , stream_(std::make_unique<tls_stream_impl>(strand_, tls))
+      , deadline_timer_(strand_)
       , username_(username)
       , password_(password)
       , hostname_(hostname)
@@ -72,11 +105,15 @@ class http_session : public std::enable_shared_from_this<http_session>
 
     ~http_session()
     {
-        stop();
+        // nothing else holds the session at this point, so it is safe to tear it down on the current thread
+        if (!stopped_.exchange(true)) {
+            do_stop();
+        }
     }
 
     void start()
     {
+        stream_->server_name(hostname_);
         resolver_.async_resolve(
           hostname_, service_, std::bind(&http_session::on_resolve, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
     }
@@ -96,30 +133,58 @@ class http_session : public std::enable_shared_from_this<http_session>
         return endpoint_;
     }
 
+    [[nodiscard]] const std::string& hostname() const
+    {
+        return hostname_;
+    }
+
+    [[nodiscard]] const std::string& service() const
+    {
+        return service_;
+    }
+
+    [[nodiscard]] asio::strand<asio::io_context::executor_type>& strand()
+    {
+        return strand_;
+    }
+
     void on_stop(std::function<void()> handler)
     {
         on_stop_handler_ = std::move(handler);
     }
 
-    void stop()
+    /**
+     * Sets the metrics of the node, so that the completion of every request does not have to look them up.
+     *
+     * Must be called before the session is used.
+     */
+    void collect_metrics_to(std::shared_ptr<node_metrics> metrics)
     {
-        stopped_ = true;
-        if (socket_.is_open()) {
-            socket_.close();
-        }
-        deadline_timer_.cancel();
+        metrics_ = std::move(metrics);
+    }
 
-        for (auto& handler : command_handlers_) {
-            handler(std::make_error_code(error::common_errc::ambiguous_timeout), {});
-        }
-        command_handlers_.clear();
+    /**
+     * @return metrics of the node, or nullptr if the metrics are not collected
+     */
+    [[nodiscard]] const std::shared_ptr<node_metrics>& metrics() const
+    {
+        return metrics_;
+    }
 
-        if (on_stop_handler_) {
-            on_stop_handler_();
-            on_stop_handler_ = nullptr;
+    /**
+     * Might be called from any thread, the teardown is posted to the strand of the session.
+     */
+    void stop()
+    {
+        if (stopped_.exchange(true)) {
+            return;
         }
+        asio::post(strand_, [self = shared_from_this()]() { self->do_stop(); });
     }
 
+    /**
+     * @return true if the server allows to send the next request over the same connection
+     */
     bool keep_alive()
     {
         return keep_alive_;
@@ -157,32 +222,114 @@ class http_session : public std::enable_shared_from_this<http_session>
         do_write();
     }
 
-    void write_and_subscribe(io::http_request& request, std::function<void(std::error_code, io::http_response&&)> handler)
+    /**
+     * @return identifier of the request, that can be used to cancel it
+     */
+    std::uint64_t write_and_subscribe(io::http_request& request, std::function<void(std::error_code, io::http_response&&)> handler)
     {
         if (stopped_) {
-            return;
+            handler(std::make_error_code(error::common_errc::request_canceled), {});
+            return 0;
         }
+        std::uint64_t request_id = ++last_request_id_;
         request.headers["user-agent"] = user_agent_;
         request.headers["authorization"] = fmt::format("Basic {}", base64::encode(fmt::format("{}:{}", username_, password_)));
-        write(fmt::format("{} {} HTTP/1.1\r\nhost: {}:{}\r\n", request.method, request.path, hostname_, service_));
         if (!request.body.empty()) {
             request.headers["content-length"] = std::to_string(request.body.size());
         }
-        for (auto& header : request.headers) {
-            write(fmt::format("{}: {}\r\n", header.first, header.second));
-        }
-        write("\r\n");
-        write(request.body);
-        command_handlers_.push_back(std::move(handler));
-        flush();
+        // the request might be submitted from the application thread, so all socket and buffer manipulations
+        // have to be serialized on the session's strand
+        asio::post(strand_, [self = shared_from_this(), request_id, request, handler = std::move(handler)]() mutable {
+            if (self->stopped_) {
+                return handler(std::make_error_code(error::common_errc::request_canceled), {});
+            }
+            self->write(fmt::format("{} {} HTTP/1.1\r\nhost: {}:{}\r\n", request.method, request.path, self->hostname_, self->service_));
+            for (auto& header : request.headers) {
+                self->write(fmt::format("{}: {}\r\n", header.first, header.second));
+            }
+            self->write("\r\n");
+            self->write(request.body);
+            if (request.streaming && request.streaming->control) {
+                request.streaming->control->on_cancel([session = std::weak_ptr<http_session>(self), request_id]() {
+                    if (auto s = session.lock(); s) {
+                        s->cancel(request_id, std::make_error_code(error::common_errc::request_canceled));
+                    }
+                });
+            }
+            self->command_handlers_.push_back({ request_id, std::move(request.streaming), std::move(handler) });
+            if (self->command_handlers_.size() == 1) {
+                self->prepare_parser();
+            }
+            self->flush();
+        });
+        return request_id;
+    }
+
+    /**
+     * Cancels the request, if it is still waiting for the response.
+     *
+     * The response cannot be skipped on HTTP/1.1 connection, so the session is closed in this case. When the request has
+     * been already completed, the session is left intact, as it might be serving another request at this point.
+     */
+    void cancel(std::uint64_t request_id, std::error_code ec)
+    {
+        asio::post(strand_, [self = shared_from_this(), request_id, ec]() {
+            auto it = std::find_if(self->command_handlers_.begin(), self->command_handlers_.end(), [request_id](const auto& entry) {
+                return entry.request_id == request_id;
+            });
+            if (it == self->command_handlers_.end()) {
+                return;
+            }
+            auto handler = std::move(it->handler);
+            self->command_handlers_.erase(it);
+            spdlog::debug("{} cancel HTTP request, request_id={}, ec={}", self->log_prefix_, request_id, ec.message());
+            self->keep_alive_ = false;
+            handler(ec, {});
+            self->stop();
+        });
     }
 
   private:
+    void do_stop()
+    {
+        if (stream_->is_open()) {
+            stream_->close();
+        }
+        deadline_timer_.cancel();
+
+        for (auto& pending : command_handlers_) {
+            pending.handler(std::make_error_code(error::common_errc::ambiguous_timeout), {});
+        }
+        command_handlers_.clear();
+
+        if (on_stop_handler_) {
+            on_stop_handler_();
+            on_stop_handler_ = nullptr;
+        }
+    }
+
+    struct pending_request {
+        std::uint64_t request_id;
+        std::optional<http_streaming> streaming;
+        std::function<void(std::error_code, io::http_response&&)> handler;
+    };
+
+    /**
+     * Responses arrive in the order of requests, so the parser is configured for the request at the head of the queue.
+     */
+    void prepare_parser()
+    {
+        if (!command_handlers_.empty() && command_handlers_.front().streaming) {
+            parser_.stream_rows(*command_handlers_.front().streaming);
+        }
+    }
+
     void on_resolve(std::error_code ec, const asio::ip::tcp::resolver::results_type& endpoints)
     {
         if (ec) {
             spdlog::error("{} error on resolve: {}", log_prefix_, ec.message());
-            return;
+            // release the slot in the pool, so that the waiters do not hang until their timeout
+            return stop();
         }
         endpoints_ = endpoints;
         do_connect(endpoints_.begin());
@@ -194,7 +341,7 @@ class http_session : public std::enable_shared_from_this<http_session>
         if (it != endpoints_.end()) {
             spdlog::debug("{} connecting to {}:{}", log_prefix_, it->endpoint().address().to_string(), it->endpoint().port());
             deadline_timer_.expires_after(timeout_defaults::connect_timeout);
-            socket_.async_connect(it->endpoint(), std::bind(&http_session::on_connect, shared_from_this(), std::placeholders::_1, it));
+            stream_->async_connect(it->endpoint(), std::bind(&http_session::on_connect, shared_from_this(), std::placeholders::_1, it));
         } else {
             spdlog::error("{} no more endpoints left to connect", log_prefix_);
             stop();
@@ -206,7 +353,7 @@ class http_session : public std::enable_shared_from_this<http_session>
         if (stopped_) {
             return;
         }
-        if (!socket_.is_open() || ec) {
+        if (!stream_->is_open() || ec) {
             spdlog::warn(
               "{} unable to connect to {}:{}: {}", log_prefix_, it->endpoint().address().to_string(), it->endpoint().port(), ec.message());
             do_connect(++it);
@@ -230,22 +377,59 @@ class http_session : public std::enable_shared_from_this<http_session>
             return;
         }
         if (deadline_timer_.expiry() <= asio::steady_timer::clock_type::now()) {
-            socket_.close();
+            stream_->close();
             deadline_timer_.expires_at(asio::steady_timer::time_point::max());
         }
         deadline_timer_.async_wait(std::bind(&http_session::check_deadline, shared_from_this(), std::placeholders::_1));
     }
 
+    /**
+     * Stops reading from the socket, if the consumer of the streamed rows has paused the current request.
+     *
+     * @return true if the reading has been paused
+     */
+    bool pause_reading()
+    {
+        if (command_handlers_.empty() || !command_handlers_.front().streaming) {
+            return false;
+        }
+        const auto& control = command_handlers_.front().streaming->control;
+        if (!control) {
+            return false;
+        }
+        // the session is referenced weakly, so that the paused stream does not keep the session alive
+        read_paused_ = control->pause_reading([session = weak_from_this()]() {
+            if (auto self = session.lock(); self) {
+                asio::post(self->strand_, [self]() {
+                    self->read_paused_ = false;
+                    self->do_read();
+                });
+            }
+        });
+        return read_paused_;
+    }
+
     void do_read()
     {
         if (stopped_) {
             return;
         }
-        socket_.async_read_some(
+        if (reading_ || read_paused_) {
+            return;
+        }
+        reading_ = true;
+        // the read stays outstanding while the session is idle, so that the connection closed by the server is noticed
+        // and removed from the pool
+        stream_->async_read_some(
           asio::buffer(input_buffer_), [self = shared_from_this()](std::error_code ec, std::size_t bytes_transferred) {
+              self->reading_ = false;
               if (ec == asio::error::operation_aborted || self->stopped_) {
                   return;
               }
+              if (ec == asio::error::eof && self->command_handlers_.empty()) {
+                  spdlog::debug("{} idle HTTP connection has been closed by the server", self->log_prefix_);
+                  return self->stop();
+              }
               if (ec) {
                   spdlog::error("{} IO error while reading from the socket: {}", self->log_prefix_, ec.message());
                   return self->stop();
@@ -254,13 +438,22 @@ class http_session : public std::enable_shared_from_this<http_session>
               switch (self->parser_.feed(reinterpret_cast<const char*>(self->input_buffer_.data()), bytes_transferred)) {
                   case http_parser::status::ok:
                       if (self->parser_.complete) {
+                          // keep_alive_ has to be updated before the handler, because the handler returns session to the pool
+                          self->keep_alive_ = self->parser_.keep_alive;
+                          io::http_response response = std::move(self->parser_.response);
+                          self->parser_.reset();
                           if (!self->command_handlers_.empty()) {
-                              auto handler = self->command_handlers_.front();
+                              auto handler = std::move(self->command_handlers_.front().handler);
                               self->command_handlers_.pop_front();
-                              handler({}, std::move(self->parser_.response));
+                              self->prepare_parser();
+                              handler({}, std::move(response));
+                          }
+                          if (!self->keep_alive_) {
+                              return self->stop();
                           }
-                          self->parser_.reset();
-                          return self->stop();
+                      }
+                      if (self->pause_reading()) {
+                          return;
                       }
                       return self->do_read();
                   case http_parser::status::failure:
@@ -284,7 +477,7 @@ class http_session : public std::enable_shared_from_this<http_session>
         for (auto& buf : writing_buffer_) {
             buffers.emplace_back(asio::buffer(buf));
         }
-        asio::async_write(socket_, buffers, [self = shared_from_this()](std::error_code ec, std::size_t /* bytes_transferred */) {
+        stream_->async_write(buffers, [self = shared_from_this()](std::error_code ec, std::size_t /* bytes_transferred */) {
             if (ec == asio::error::operation_aborted || self->stopped_) {
                 return;
             }
@@ -303,9 +496,11 @@ class http_session : public std::enable_shared_from_this<http_session>
     std::string client_id_;
     std::string id_;
     asio::io_context& ctx_;
-    asio::ip::tcp::resolver resolver_;
+    // all IO objects of the session share the strand, and stop() posts the teardown to it, so the socket and the pending
+    // requests are not accessed concurrently even when the context is being run by several threads
     asio::strand<asio::io_context::executor_type> strand_;
-    asio::ip::tcp::socket socket_;
+    asio::ip::tcp::resolver resolver_;
+    std::unique_ptr<stream_impl> stream_;
     asio::steady_timer deadline_timer_;
 
     std::string username_;
@@ -314,13 +509,17 @@ class http_session : public std::enable_shared_from_this<http_session>
     std::string service_;
     std::string user_agent_;
 
-    bool stopped_{ false };
-    bool connected_{ false };
-    bool keep_alive_{ false };
+    std::atomic_bool stopped_{ false };
+    std::atomic_bool connected_{ false };
+    std::atomic_bool keep_alive_{ false };
+    bool reading_{ false };
+    bool read_paused_{ false }; // the consumer of the streamed rows cannot accept more
+    std::atomic<std::uint64_t> last_request_id_{ 0 };
 
     std::function<void()> on_stop_handler_{ nullptr };
+    std::shared_ptr<node_metrics> metrics_{};
 
-    std::list<std::function<void(std::error_code, io::http_response&&)>> command_handlers_{};
+    std::list<pending_request> command_handlers_{};
     http_parser parser_{};
     std::array<std::uint8_t, 16384> input_buffer_{};
     std::vector<std::vector<std::uint8_t>> output_buffer_{};
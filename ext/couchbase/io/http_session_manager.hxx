@@ -18,74 +18,386 @@
 #pragma once
 
 #include <io/http_session.hxx>
+#include <cluster_options.hxx>
+#include <metrics_registry.hxx>
+#include <origin.hxx>
 #include <service_type.hxx>
+#include <utils/movable_function.hxx>
 
+#include <algorithm>
+#include <chrono>
 #include <random>
 
 namespace couchbase::io
 {
 
+/**
+ * Pools of HTTP sessions, one pool per node and service.
+ *
+ * The size of each pool might be limited by max_http_connections, and requests, that cannot get connection, wait in
+ * the queue of the service until some session is returned or the deadline expires. Idle sessions are closed after
+ * idle_http_connection_timeout, except the http_pool_prewarm sessions, which are opened as soon as the configuration
+ * is known.
+ */
 class http_session_manager : public std::enable_shared_from_this<http_session_manager>
 {
   public:
-    http_session_manager(const std::string& client_id, asio::io_context& ctx)
+    using check_out_handler = utils::movable_function<void(std::error_code, std::shared_ptr<http_session>)>;
+
+    http_session_manager(const std::string& client_id, asio::io_context& ctx, asio::ssl::context& tls)
       : client_id_(client_id)
       , ctx_(ctx)
+      , tls_(tls)
+      , eviction_timer_(ctx_)
     {
     }
 
-    void set_configuration(const configuration& config)
+    /**
+     * Sets the registry, that every new session takes the metrics of its node from.
+     *
+     * Must be called before set_configuration.
+     */
+    void collect_metrics_to(std::shared_ptr<metrics_registry> registry)
     {
-        config_ = config;
-        next_index_ = 0;
-        if (config_.nodes.size() > 1) {
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<std::size_t> dis(0, config_.nodes.size() - 1);
-            next_index_ = dis(gen);
+        metrics_registry_ = std::move(registry);
+    }
+
+    void set_configuration(const configuration& config, const couchbase::origin& origin)
+    {
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            config_ = config;
+            options_ = origin.options();
+            username_ = origin.get_username();
+            password_ = origin.get_password();
+            next_index_ = 0;
+            if (config_.nodes.size() > 1) {
+                std::random_device rd;
+                std::mt19937 gen(rd());
+                std::uniform_int_distribution<std::size_t> dis(0, config_.nodes.size() - 1);
+                next_index_ = dis(gen);
+            }
+            prewarm();
         }
+        schedule_eviction();
     }
 
-    std::shared_ptr<http_session> check_out(service_type type, const std::string& username, const std::string& password)
+    /**
+     * Picks idle session, or opens new one if the pool of some node has free capacity, otherwise waits for the session
+     * until the timeout.
+     */
+    void check_out(service_type type, std::chrono::milliseconds timeout, check_out_handler&& handler)
     {
-        std::scoped_lock lock(sessions_mutex_);
-        if (idle_sessions_[type].empty()) {
-            std::string hostname;
-            std::uint16_t port = 0;
-            std::tie(hostname, port) = next_node(type);
-            if (port == 0) {
-                return nullptr;
-            }
-            config_.nodes.size();
-            auto session = std::make_shared<http_session>(client_id_, ctx_, username, password, hostname, std::to_string(port));
-            session->start();
-            session->on_stop([type, id = session->id(), self = this->shared_from_this()]() {
-                std::scoped_lock inner_lock(self->sessions_mutex_);
-                self->busy_sessions_[type].remove_if([id](const auto& s) -> bool { return s->id() == id; });
-                self->idle_sessions_[type].remove_if([id](const auto& s) -> bool { return s->id() == id; });
-            });
-            busy_sessions_[type].push_back(session);
-            return session;
-        }
-        auto session = idle_sessions_[type].front();
-        idle_sessions_[type].pop_front();
-        busy_sessions_[type].push_back(session);
-        return session;
+        std::shared_ptr<http_session> session{};
+        std::error_code ec{};
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            if (closed_) {
+                ec = std::make_error_code(error::common_errc::request_canceled);
+            } else {
+                session = take_idle_session(type);
+            }
+            if (!ec && !session) {
+                std::string hostname;
+                std::uint16_t port = 0;
+                std::tie(hostname, port) = next_node(type);
+                if (port != 0) {
+                    session = open_session(type, hostname, port);
+                    pools_[type][session_key(*session)].busy.push_back(session);
+                } else if (has_service(type)) {
+                    enqueue_waiter(type, timeout, std::move(handler));
+                    return;
+                } else {
+                    ec = std::make_error_code(error::common_errc::service_not_available);
+                }
+            }
+        }
+        handler(ec, session);
     }
 
     void check_in(service_type type, std::shared_ptr<http_session> session)
     {
         if (!session->keep_alive()) {
+            // the pool and the waiters will be updated by the on_stop hook
+            return session->stop();
+        }
+        if (session->is_stopped()) {
+            return;
+        }
+        std::shared_ptr<waiter> next{};
+        bool closed = false;
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            closed = closed_;
+            if (!closed) {
+                if (auto& queue = waiters_[type]; !queue.empty()) {
+                    // hand the session over directly, it stays in the busy list
+                    next = queue.front();
+                    queue.pop_front();
+                } else {
+                    auto& pool = pools_[type][session_key(*session)];
+                    pool.busy.remove(session);
+                    spdlog::debug("{} put HTTP session back to idle connections", session->log_prefix());
+                    pool.idle.push_back({ session, std::chrono::steady_clock::now() });
+                }
+            }
+        }
+        if (closed) {
+            // stopped outside of the lock, because on_stop hook acquires it too
             return session->stop();
         }
-        if (!session->is_stopped()) {
+        if (next) {
+            next->deadline.cancel();
+            next->handler({}, session);
+        }
+    }
+
+    void close()
+    {
+        std::vector<std::shared_ptr<http_session>> sessions{};
+        std::vector<std::shared_ptr<waiter>> waiters{};
+        {
             std::scoped_lock lock(sessions_mutex_);
-            spdlog::debug("{} put HTTP session back to idle connections", session->log_prefix());
-            idle_sessions_[type].push_back(session);
+            closed_ = true;
+            eviction_timer_.cancel();
+            for (auto& [type, nodes] : pools_) {
+                for (auto& [key, pool] : nodes) {
+                    for (auto& entry : pool.idle) {
+                        sessions.emplace_back(entry.session);
+                    }
+                    sessions.insert(sessions.end(), pool.busy.begin(), pool.busy.end());
+                }
+            }
+            pools_.clear();
+            for (auto& [type, queue] : waiters_) {
+                waiters.insert(waiters.end(), queue.begin(), queue.end());
+            }
+            waiters_.clear();
+        }
+        for (auto& w : waiters) {
+            w->deadline.cancel();
+            w->handler(std::make_error_code(error::common_errc::request_canceled), nullptr);
+        }
+        for (auto& session : sessions) {
+            session->stop();
         }
     }
 
   private:
+    static constexpr std::chrono::milliseconds min_eviction_interval{ 100 };
+
+    struct idle_session {
+        std::shared_ptr<http_session> session;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    struct pool {
+        std::list<idle_session> idle{};
+        std::list<std::shared_ptr<http_session>> busy{};
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return idle.size() + busy.size();
+        }
+    };
+
+    struct waiter {
+        asio::steady_timer deadline;
+        check_out_handler handler;
+    };
+
+    static std::string session_key(const http_session& session)
+    {
+        return fmt::format("{}:{}", session.hostname(), session.service());
+    }
+
+    std::shared_ptr<http_session> open_session(service_type type, const std::string& hostname, std::uint16_t port)
+    {
+        std::shared_ptr<http_session> session;
+        if (options_.enable_tls) {
+            session = std::make_shared<http_session>(client_id_, ctx_, tls_, username_, password_, hostname, std::to_string(port));
+        } else {
+            session = std::make_shared<http_session>(client_id_, ctx_, username_, password_, hostname, std::to_string(port));
+        }
+        if (metrics_registry_) {
+            session->collect_metrics_to(metrics_registry_->node(session_key(*session)));
+        }
+        // the handler has to be installed before the start, because resolve or connect might fail on another IO thread
+        session->on_stop([type, key = session_key(*session), id = session->id(), self = this->shared_from_this()]() {
+            self->on_session_stop(type, key, id);
+        });
+        session->start();
+        return session;
+    }
+
+    void on_session_stop(service_type type, const std::string& key, const std::string& id)
+    {
+        std::shared_ptr<waiter> next{};
+        std::shared_ptr<http_session> session{};
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            auto& pool = pools_[type][key];
+            pool.busy.remove_if([&id](const auto& s) -> bool { return s->id() == id; });
+            pool.idle.remove_if([&id](const auto& entry) -> bool { return entry.session->id() == id; });
+            if (closed_) {
+                return;
+            }
+            // the capacity has been released, so the first waiter might get new connection
+            if (auto& queue = waiters_[type]; !queue.empty()) {
+                std::string hostname;
+                std::uint16_t port = 0;
+                std::tie(hostname, port) = next_node(type);
+                if (port != 0) {
+                    next = queue.front();
+                    queue.pop_front();
+                    session = open_session(type, hostname, port);
+                    pools_[type][session_key(*session)].busy.push_back(session);
+                }
+            }
+        }
+        if (next) {
+            next->deadline.cancel();
+            next->handler({}, session);
+        }
+    }
+
+    std::shared_ptr<http_session> take_idle_session(service_type type)
+    {
+        for (auto& [key, pool] : pools_[type]) {
+            while (!pool.idle.empty()) {
+                auto session = pool.idle.front().session;
+                pool.idle.pop_front();
+                if (!session->is_stopped()) {
+                    pool.busy.push_back(session);
+                    return session;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    void enqueue_waiter(service_type type, std::chrono::milliseconds timeout, check_out_handler&& handler)
+    {
+        auto w = std::make_shared<waiter>(waiter{ asio::steady_timer(ctx_), std::move(handler) });
+        waiters_[type].push_back(w);
+        w->deadline.expires_after(timeout);
+        w->deadline.async_wait([self = this->shared_from_this(), type, w](std::error_code ec) {
+            if (ec == asio::error::operation_aborted) {
+                return;
+            }
+            {
+                std::scoped_lock lock(self->sessions_mutex_);
+                auto& queue = self->waiters_[type];
+                auto it = std::find(queue.begin(), queue.end(), w);
+                if (it == queue.end()) {
+                    // already got the session
+                    return;
+                }
+                queue.erase(it);
+            }
+            w->handler(std::make_error_code(error::common_errc::unambiguous_timeout), nullptr);
+        });
+    }
+
+    /**
+     * Opens sessions, so that every pool has at least http_pool_prewarm of them.
+     */
+    void prewarm()
+    {
+        if (options_.http_pool_prewarm == 0 || closed_) {
+            return;
+        }
+        for (auto type : { service_type::query, service_type::analytics, service_type::search, service_type::views }) {
+            for (const auto& node : config_.nodes) {
+                auto port = service_port(node, type, options_.enable_tls);
+                if (port == 0) {
+                    continue;
+                }
+                auto& pool = pools_[type][fmt::format("{}:{}", node.hostname, port)];
+                while (pool.size() < options_.http_pool_prewarm &&
+                       (options_.max_http_connections == 0 || pool.size() < options_.max_http_connections)) {
+                    pool.idle.push_back({ open_session(type, node.hostname, port), std::chrono::steady_clock::now() });
+                }
+            }
+        }
+    }
+
+    void schedule_eviction()
+    {
+        std::scoped_lock lock(sessions_mutex_);
+        if (eviction_scheduled_ || closed_) {
+            return;
+        }
+        eviction_scheduled_ = true;
+        // very small timeouts would make the timer spin, the idle sessions are allowed to outlive them a little
+        eviction_timer_.expires_after(std::max(options_.idle_http_connection_timeout / 2, min_eviction_interval));
+        eviction_timer_.async_wait([self = this->shared_from_this()](std::error_code ec) {
+            if (ec == asio::error::operation_aborted) {
+                return;
+            }
+            self->evict_idle_sessions();
+        });
+    }
+
+    void evict_idle_sessions()
+    {
+        std::vector<std::shared_ptr<http_session>> expired{};
+        {
+            std::scoped_lock lock(sessions_mutex_);
+            eviction_scheduled_ = false;
+            auto threshold = std::chrono::steady_clock::now() - options_.idle_http_connection_timeout;
+            for (auto& [type, nodes] : pools_) {
+                for (auto& [key, pool] : nodes) {
+                    // the oldest sessions are at the front of the idle list
+                    while (pool.size() > options_.http_pool_prewarm && !pool.idle.empty() && pool.idle.front().since < threshold) {
+                        expired.emplace_back(pool.idle.front().session);
+                        pool.idle.pop_front();
+                    }
+                }
+            }
+        }
+        for (auto& session : expired) {
+            spdlog::debug("{} close idle HTTP session", session->log_prefix());
+            session->stop();
+        }
+        schedule_eviction();
+    }
+
+    static std::uint16_t service_port(const configuration::node& node, service_type type, bool tls = false)
+    {
+        const auto& services = tls ? node.services_tls : node.services_plain;
+        switch (type) {
+            case service_type::query:
+                return services.query.value_or(0);
+
+            case service_type::analytics:
+                return services.analytics.value_or(0);
+
+            case service_type::search:
+                return services.search.value_or(0);
+
+            case service_type::views:
+                return services.views.value_or(0);
+
+            case service_type::management:
+                return services.management.value_or(0);
+
+            case service_type::kv:
+                return services.key_value.value_or(0);
+        }
+        return 0;
+    }
+
+    [[nodiscard]] bool has_service(service_type type) const
+    {
+        return std::any_of(config_.nodes.begin(), config_.nodes.end(), [this, type](const auto& node) {
+            return service_port(node, type, options_.enable_tls) != 0;
+        });
+    }
+
+    /**
+     * @return next node (round-robin), that runs the service and has free capacity in its pool
+     */
     std::pair<std::string, std::uint16_t> next_node(service_type type)
     {
         auto candidates = config_.nodes.size();
@@ -93,46 +405,37 @@ class http_session_manager : public std::enable_shared_from_this<http_session_ma
             --candidates;
             auto& node = config_.nodes[next_index_];
             next_index_ = (next_index_ + 1) % config_.nodes.size();
-            std::uint16_t port = 0;
-            switch (type) {
-                case service_type::query:
-                    port = node.services_plain.query.value_or(0);
-                    break;
-
-                case service_type::analytics:
-                    port = node.services_plain.analytics.value_or(0);
-                    break;
-
-                case service_type::search:
-                    port = node.services_plain.search.value_or(0);
-                    break;
-
-                case service_type::views:
-                    port = node.services_plain.views.value_or(0);
-                    break;
-
-                case service_type::management:
-                    port = node.services_plain.management.value_or(0);
-                    break;
-
-                case service_type::kv:
-                    port = node.services_plain.key_value.value_or(0);
-                    break;
+            std::uint16_t port = service_port(node, type, options_.enable_tls);
+            if (port == 0) {
+                continue;
             }
-            if (port != 0) {
-                return { node.hostname, port };
+            if (options_.max_http_connections > 0) {
+                const auto& nodes = pools_[type];
+                if (auto it = nodes.find(fmt::format("{}:{}", node.hostname, port));
+                    it != nodes.end() && it->second.size() >= options_.max_http_connections) {
+                    continue;
+                }
             }
+            return { node.hostname, port };
         }
         return { "", 0 };
     }
 
     std::string client_id_;
     asio::io_context& ctx_;
+    asio::ssl::context& tls_;
+    std::shared_ptr<metrics_registry> metrics_registry_{};
 
     configuration config_{};
-    std::map<service_type, std::list<std::shared_ptr<http_session>>> busy_sessions_{};
-    std::map<service_type, std::list<std::shared_ptr<http_session>>> idle_sessions_{};
+    cluster_options options_{};
+    std::string username_{};
+    std::string password_{};
+    std::map<service_type, std::map<std::string, pool>> pools_{}; // service -> "hostname:port" -> pool
+    std::map<service_type, std::list<std::shared_ptr<waiter>>> waiters_{};
     std::size_t next_index_{ 0 };
+    asio::steady_timer eviction_timer_;
+    bool eviction_scheduled_{ false };
+    bool closed_{ false };
     std::mutex sessions_mutex_{};
 };
 } // namespace couchbase::io
@@ -18,8 +18,14 @@
 #pragma once
 
 #include <io/mcbp_session.hxx>
+#include <io/retry_orchestrator.hxx>
+#include <io/timer_wheel.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_get_collection_id.hxx>
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <mutex>
 #include <utility>
 
 namespace couchbase::operations
@@ -31,47 +37,72 @@ template<typename Request>
 struct mcbp_command : public std::enable_shared_from_this<mcbp_command<Request>> {
     using encoded_request_type = typename Request::encoded_request_type;
     using encoded_response_type = typename Request::encoded_response_type;
-    asio::steady_timer deadline;
-    asio::steady_timer retry_backoff;
+    std::shared_ptr<io::timer_wheel> timers_;
+    std::chrono::steady_clock::time_point deadline{};
+    std::atomic<io::timer_wheel::timer_id> deadline_timer_{ 0 };
+    std::atomic<io::timer_wheel::timer_id> retry_timer_{ 0 };
     Request request;
     encoded_request_type encoded;
     std::optional<std::uint32_t> opaque_{};
     std::shared_ptr<io::mcbp_session> session_{};
     mcbp_command_handler handler_{};
+    // maps the command to the session using the most recent configuration of the bucket, used to retry "not my vbucket"
+    std::function<void(std::shared_ptr<mcbp_command<Request>>)> router_{};
+    std::uint32_t retries_{ 0 };
+    operation_timings timings{};
+    std::atomic<std::chrono::steady_clock::rep> written_at_{ 0 }; // updated by the session, when the frame is written
+    // the deadline might fire on the other IO thread, while the response is being dispatched by the session's strand
+    std::mutex handler_mutex_{};
 
-    mcbp_command(asio::io_context& ctx, Request req)
-      : deadline(ctx)
-      , retry_backoff(ctx)
-      , request(req)
+    mcbp_command(std::shared_ptr<io::timer_wheel> timers, Request req)
+      : timers_(std::move(timers))
+      , request(std::move(req))
     {
     }
 
     void start(mcbp_command_handler&& handler)
     {
-        handler_ = handler;
-        deadline.expires_after(request.timeout);
-        deadline.async_wait([self = this->shared_from_this()](std::error_code ec) {
-            if (ec == asio::error::operation_aborted) {
-                return;
-            }
-            self->cancel();
+        {
+            std::scoped_lock lock(handler_mutex_);
+            handler_ = handler;
+        }
+        timings.queued = std::chrono::steady_clock::now();
+        deadline = timings.queued + request.timeout;
+        deadline_timer_ = timers_->schedule_after(request.timeout, [self = this->shared_from_this()](std::error_code ec) {
+            // the wheel reports request_canceled, when it is stopped before the deadline
+            self->cancel(ec ? ec : std::make_error_code(error::common_errc::unambiguous_timeout));
         });
     }
 
-    void cancel()
+    void cancel(std::error_code reason)
     {
-        if (opaque_ && session_) {
-            session_->cancel(opaque_.value(), asio::error::operation_aborted);
+        std::optional<std::uint32_t> opaque{};
+        std::shared_ptr<io::mcbp_session> session{};
+        {
+            std::scoped_lock lock(handler_mutex_);
+            opaque = opaque_;
+            session = session_;
         }
-        handler_ = nullptr;
+        if (opaque && session) {
+            session->cancel(opaque.value(), asio::error::operation_aborted);
+        }
+        // if the session has not found the operation, the command has not been sent yet or it waits for the retry, so it
+        // has not been executed by the server
+        timers_->cancel(retry_timer_.exchange(0));
+        invoke_handler(reason);
     }
 
     void invoke_handler(std::error_code ec, std::optional<io::mcbp_message> msg = {})
     {
-        if (handler_) {
-            handler_(ec, std::move(msg));
+        mcbp_command_handler handler{};
+        {
+            std::scoped_lock lock(handler_mutex_);
+            std::swap(handler, handler_);
+        }
+        if (handler) {
+            timers_->cancel(deadline_timer_.exchange(0));
+            handler(ec, std::move(msg));
         }
-        handler_ = nullptr;
     }
 
     void request_collection_id()
@@ -80,7 +111,7 @@ struct mcbp_command : public std::enable_shared_from_this<mcbp_command<Request>>
         req.opaque(session_->next_opaque());
         req.body().collection_path(request.id.collection);
         session_->write_and_subscribe(req.opaque(),
-                                      req.data(session_->supports_feature(protocol::hello_feature::snappy)),
+                                      std::move(req.data(session_->supports_feature(protocol::hello_feature::snappy))),
                                       [self = this->shared_from_this()](std::error_code ec, io::mcbp_message&& msg) mutable {
                                           if (ec == asio::error::operation_aborted) {
                                               return self->invoke_handler(std::make_error_code(error::common_errc::ambiguous_timeout));
@@ -104,7 +135,7 @@ struct mcbp_command : public std::enable_shared_from_this<mcbp_command<Request>>
     void handle_unknown_collection()
     {
         auto backoff = std::chrono::milliseconds(500);
-        auto time_left = deadline.expiry() - std::chrono::steady_clock::now();
+        auto time_left = deadline - std::chrono::steady_clock::now();
         spdlog::debug("{} unknown collection response for \"{}/{}/{}\", time_left={}ms",
                       session_->log_prefix(),
                       request.id.bucket,
@@ -114,18 +145,95 @@ struct mcbp_command : public std::enable_shared_from_this<mcbp_command<Request>>
         if (time_left < backoff) {
             return invoke_handler(std::make_error_code(error::common_errc::ambiguous_timeout));
         }
-        retry_backoff.expires_after(backoff);
-        retry_backoff.async_wait([self = this->shared_from_this()](std::error_code ec) mutable {
-            if (ec == asio::error::operation_aborted) {
-                return;
+        retry_timer_ = timers_->schedule_after(backoff, [self = this->shared_from_this()](std::error_code ec) {
+            if (ec) {
+                return self->invoke_handler(ec);
             }
             self->request_collection_id();
         });
     }
 
+    void handle_not_my_vbucket()
+    {
+        // the server has rejected the command without executing it, so it is safe to send it to the new owner of the partition
+        auto backoff = std::min(std::chrono::milliseconds(1U << std::min(retries_, 9U)), std::chrono::milliseconds(500));
+        ++retries_;
+        if (const auto& metrics = session_->metrics(); metrics) {
+            ++metrics->not_my_vbucket;
+        }
+        auto time_left = deadline - std::chrono::steady_clock::now();
+        spdlog::debug("{} not my vbucket response for \"{}/{}/{}\", partition={}, retries={}, time_left={}ms",
+                      session_->log_prefix(),
+                      request.id.bucket,
+                      request.id.collection,
+                      request.id.key,
+                      request.partition,
+                      retries_,
+                      std::chrono::duration_cast<std::chrono::milliseconds>(time_left).count());
+        if (!router_) {
+            return invoke_handler(std::make_error_code(error::network_errc::configuration_not_available));
+        }
+        if (time_left < backoff) {
+            return invoke_handler(std::make_error_code(error::common_errc::unambiguous_timeout));
+        }
+        retry_after(backoff);
+    }
+
+    /**
+     * Schedules another attempt, if the error map or the retry orchestrator consider the status as transient, and the
+     * backoff fits into the deadline. Otherwise the caller reports the error.
+     */
+    bool maybe_retry(std::uint16_t status)
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - timings.queued);
+        auto backoff = io::retry_orchestrator::should_retry(status, session_->decode_error_code(status), retries_, elapsed);
+        if (!backoff || deadline - now < backoff.value()) {
+            return false;
+        }
+        ++retries_;
+        spdlog::debug("{} retry \"{}/{}/{}\" after status={:x}, retries={}, backoff={}ms",
+                      session_->log_prefix(),
+                      request.id.bucket,
+                      request.id.collection,
+                      request.id.key,
+                      status,
+                      retries_,
+                      backoff->count());
+        retry_after(backoff.value());
+        return true;
+    }
+
+    void retry_after(std::chrono::milliseconds backoff)
+    {
+        if (const auto& metrics = session_->metrics(); metrics) {
+            ++metrics->retries;
+        }
+        retry_timer_ = timers_->schedule_after(backoff, [self = this->shared_from_this()](std::error_code ec) {
+            if (ec) {
+                return self->invoke_handler(ec);
+            }
+            if (self->router_) {
+                return self->router_(self);
+            }
+            self->send();
+        });
+    }
+
+    void record_response_timings(const io::mcbp_message& msg)
+    {
+        if (auto written_at = written_at_.load(); written_at != 0) {
+            timings.written = operation_timings::clock::time_point(operation_timings::clock::duration(written_at));
+        }
+        timings.received = msg.received_at;
+    }
+
     void send()
     {
-        opaque_ = session_->next_opaque();
+        {
+            std::scoped_lock lock(handler_mutex_);
+            opaque_ = session_->next_opaque();
+        }
         request.opaque = *opaque_;
         if (!request.id.collection_uid) {
             if (session_->supports_feature(protocol::hello_feature::collections)) {
@@ -148,11 +256,20 @@ struct mcbp_command : public std::enable_shared_from_this<mcbp_command<Request>>
             }
         }
         request.encode_to(encoded);
+        timings.encoded = std::chrono::steady_clock::now();
+        written_at_ = 0;
 
+        // large values are written directly from the request, so the command has to stay alive until the frame is sent
+        encoded.reuse_buffer(session_->payload_buffer());
+        auto& payload = encoded.data_with_detached_value(session_->supports_feature(protocol::hello_feature::snappy));
         session_->write_and_subscribe(request.opaque,
-                                      encoded.data(session_->supports_feature(protocol::hello_feature::snappy)),
+                                      std::move(payload),
+                                      encoded.detached_value(),
+                                      this->shared_from_this(),
+                                      &written_at_,
                                       [self = this->shared_from_this()](std::error_code ec, io::mcbp_message&& msg) mutable {
-                                          self->retry_backoff.cancel();
+                                          self->timers_->cancel(self->retry_timer_.exchange(0));
+                                          self->record_response_timings(msg);
                                           if (ec == asio::error::operation_aborted) {
                                               return self->invoke_handler(std::make_error_code(error::common_errc::ambiguous_timeout));
                                           }
@@ -162,17 +279,26 @@ struct mcbp_command : public std::enable_shared_from_this<mcbp_command<Request>>
                                           if (msg.header.status() == static_cast<std::uint16_t>(protocol::status::unknown_collection)) {
                                               return self->handle_unknown_collection();
                                           }
-                                          self->deadline.cancel();
+                                          if (msg.header.status() == static_cast<std::uint16_t>(protocol::status::not_my_vbucket)) {
+                                              self->session_->handle_not_my_vbucket(msg);
+                                              return self->handle_not_my_vbucket();
+                                          }
+                                          if (ec && self->maybe_retry(msg.header.status())) {
+                                              return;
+                                          }
                                           self->invoke_handler(ec, msg);
                                       });
     }
 
     void send_to(std::shared_ptr<io::mcbp_session> session)
     {
-        if (!handler_) {
-            return;
+        {
+            std::scoped_lock lock(handler_mutex_);
+            if (!handler_) {
+                return;
+            }
+            session_ = std::move(session);
         }
-        session_ = std::move(session);
         send();
     }
 };
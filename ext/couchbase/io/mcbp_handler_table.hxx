@@ -0,0 +1,140 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <io/mcbp_message.hxx>
+#include <utils/movable_function.hxx>
+
+namespace couchbase::io
+{
+using mcbp_command_handler = utils::movable_function<void(std::error_code, io::mcbp_message&&)>;
+
+/**
+ * Handlers of the in-flight operations of the session, indexed by opaque.
+ *
+ * The session allocates opaques sequentially, so the lower bits of the opaque are used directly as index of the slot,
+ * and the slot keeps the full opaque, which works as generation counter and rejects stale responses. Lookup and removal
+ * are O(1) and do not allocate.
+ *
+ * When the slot is still occupied by an older operation, the table is doubled (entries, that did not collide in the
+ * smaller table, never collide in the larger one). Once the table reaches its maximum size, colliding handlers are
+ * kept in the overflow map.
+ */
+class mcbp_handler_table
+{
+  public:
+    static constexpr std::size_t initial_capacity = 512;
+    static constexpr std::size_t max_capacity = 65536;
+
+    mcbp_handler_table()
+      : slots_(initial_capacity)
+    {
+    }
+
+    /**
+     * @return false if the handler for the same opaque is already registered, the handler is left untouched in this case
+     */
+    bool insert(std::uint32_t opaque, mcbp_command_handler&& handler)
+    {
+        while (true) {
+            auto& entry = slots_[opaque & mask()];
+            if (!entry.handler) {
+                entry.opaque = opaque;
+                entry.handler = std::move(handler);
+                return true;
+            }
+            if (entry.opaque == opaque) {
+                return false;
+            }
+            if (slots_.size() >= max_capacity) {
+                return overflow_.try_emplace(opaque, std::move(handler)).second;
+            }
+            grow();
+        }
+    }
+
+    /**
+     * @return handler for the opaque, or empty handler if there is no such operation
+     */
+    mcbp_command_handler extract(std::uint32_t opaque)
+    {
+        auto& entry = slots_[opaque & mask()];
+        if (entry.handler && entry.opaque == opaque) {
+            return std::move(entry.handler);
+        }
+        if (!overflow_.empty()) {
+            if (auto it = overflow_.find(opaque); it != overflow_.end()) {
+                auto handler = std::move(it->second);
+                overflow_.erase(it);
+                return handler;
+            }
+        }
+        return {};
+    }
+
+    /**
+     * Removes all handlers from the table.
+     */
+    std::vector<std::pair<std::uint32_t, mcbp_command_handler>> extract_all()
+    {
+        std::vector<std::pair<std::uint32_t, mcbp_command_handler>> handlers{};
+        for (auto& entry : slots_) {
+            if (entry.handler) {
+                handlers.emplace_back(entry.opaque, std::move(entry.handler));
+            }
+        }
+        for (auto& [opaque, handler] : overflow_) {
+            handlers.emplace_back(opaque, std::move(handler));
+        }
+        overflow_.clear();
+        return handlers;
+    }
+
+  private:
+    struct slot {
+        std::uint32_t opaque{ 0 };
+        mcbp_command_handler handler{};
+    };
+
+    [[nodiscard]] std::uint32_t mask() const
+    {
+        return static_cast<std::uint32_t>(slots_.size() - 1);
+    }
+
+    void grow()
+    {
+        std::vector<slot> slots(slots_.size() * 2);
+        std::uint32_t new_mask = static_cast<std::uint32_t>(slots.size() - 1);
+        for (auto& entry : slots_) {
+            if (entry.handler) {
+                slots[entry.opaque & new_mask] = std::move(entry);
+            }
+        }
+        std::swap(slots_, slots);
+    }
+
+    std::vector<slot> slots_;
+    std::map<std::uint32_t, mcbp_command_handler> overflow_{};
+};
+} // namespace couchbase::io
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <vector>
 #include <array>
@@ -51,8 +52,9 @@ struct binary_header {
 struct mcbp_message {
     binary_header header;
     std::vector<std::uint8_t> body;
+    std::chrono::steady_clock::time_point received_at{}; // when the bytes of the message have been read from the socket
 
-    protocol::header_buffer header_data()
+    [[nodiscard]] protocol::header_buffer header_data() const
     {
         protocol::header_buffer buf;
         std::memcpy(buf.data(), &header, sizeof(header));
@@ -0,0 +1,263 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace couchbase::io
+{
+
+/**
+ * Encoded request waiting to be written to the socket.
+ *
+ * Large values are not copied into the payload, but referenced from the request, and sent by the same gather write
+ * right after the payload.
+ */
+struct mcbp_output_frame {
+    std::vector<std::uint8_t> payload{};
+    std::string_view value{};
+    std::shared_ptr<void> value_owner{}; // keeps the value alive until the frame has been written
+    // receives the time when the frame has been written to the socket, owned by value_owner
+    std::atomic<std::chrono::steady_clock::rep>* written_at{ nullptr };
+};
+
+/**
+ * Lock-free multi-producer single-consumer queue of the frames waiting to be written by the session.
+ *
+ * Producers push nodes onto the atomic stack, and the consumer (session's strand) detaches the whole stack with single
+ * exchange and reverses it to restore submission order. The consumer never removes individual nodes, so the queue is not
+ * affected by ABA problem.
+ *
+ * The nodes are taken from the fixed pool and returned there after being written, so steady-state submissions do not
+ * allocate nodes. The free list of the pool is the stack of indexes tagged with version counter, that protects it from
+ * ABA. When the pool is exhausted, the nodes are allocated on the heap.
+ *
+ * The payload buffers of the written frames are kept in the separate pool of spare buffers, and handed out by
+ * take_buffer() to encode the next requests, so that steady-state submissions do not allocate payloads either. Only
+ * buffers up to max_retained_capacity are kept, so the idle pool does not hold the memory of the large frames.
+ */
+class mcbp_output_queue
+{
+  public:
+    static constexpr std::uint32_t invalid_index = 0xffff'ffffU;
+    static constexpr std::uint32_t spare_buffer_count = 64;
+    static constexpr std::size_t max_retained_capacity = 8192; // values smaller than 4096 bytes are copied into the payload
+
+    struct node {
+        mcbp_output_frame frame{};
+        node* next{ nullptr };                                   // link in the submission queue
+        std::atomic<std::uint32_t> next_free{ invalid_index }; // link in the free list of the pool
+        std::uint32_t index{ invalid_index };                  // position in the pool, or invalid_index for heap nodes
+    };
+
+    explicit mcbp_output_queue(std::uint32_t pool_size = 256)
+      : pool_size_(pool_size)
+      , pool_(std::make_unique<node[]>(pool_size))
+    {
+        for (std::uint32_t i = 0; i < pool_size_; ++i) {
+            pool_[i].index = i;
+            pool_[i].next_free.store(i + 1 < pool_size_ ? i + 1 : invalid_index, std::memory_order_relaxed);
+        }
+        free_head_.store(pool_size_ > 0 ? 0 : invalid_index, std::memory_order_relaxed);
+        for (std::uint32_t i = 0; i < spare_buffer_count; ++i) {
+            spare_buffers_[i].next.store(i + 1 < spare_buffer_count ? i + 1 : invalid_index, std::memory_order_relaxed);
+        }
+        empty_spares_head_.store(0, std::memory_order_relaxed);
+    }
+
+    mcbp_output_queue(const mcbp_output_queue&) = delete;
+    mcbp_output_queue& operator=(const mcbp_output_queue&) = delete;
+
+    ~mcbp_output_queue()
+    {
+        node* item = queue_.exchange(nullptr, std::memory_order_acquire);
+        while (item != nullptr) {
+            node* next = item->next;
+            release(item);
+            item = next;
+        }
+    }
+
+    /**
+     * Takes node from the pool. The node has to be passed either to push() or to release().
+     */
+    node* acquire()
+    {
+        auto index = pop(free_head_, node_links{ pool_.get() });
+        if (index == invalid_index) {
+            return new node{};
+        }
+        return &pool_[index];
+    }
+
+    /**
+     * Returns node to the pool, and its payload buffer to the spare buffers.
+     */
+    void release(node* item)
+    {
+        recycle(std::exchange(item->frame.payload, {}));
+        item->frame.value = {};
+        item->frame.value_owner.reset();
+        item->frame.written_at = nullptr;
+        item->next = nullptr;
+        if (item->index == invalid_index) {
+            delete item;
+            return;
+        }
+        push(free_head_, item->index, node_links{ pool_.get() });
+    }
+
+    /**
+     * Called by producers to encode the next frame into the memory of the frames, that have been written already.
+     *
+     * @return empty buffer, that keeps its capacity, or buffer without capacity if there are no spare buffers
+     */
+    std::vector<std::uint8_t> take_buffer()
+    {
+        auto index = pop(filled_spares_head_, spare_links{ spare_buffers_.data() });
+        if (index == invalid_index) {
+            return {};
+        }
+        auto buffer = std::move(spare_buffers_[index].buffer);
+        push(empty_spares_head_, index, spare_links{ spare_buffers_.data() });
+        return buffer;
+    }
+
+    /**
+     * Called by producers.
+     */
+    void push(node* item)
+    {
+        node* head = queue_.load(std::memory_order_relaxed);
+        do {
+            item->next = head;
+        } while (!queue_.compare_exchange_weak(head, item, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     * Called by the consumer.
+     *
+     * @return list of all submitted nodes in submission order (linked by node::next), or nullptr
+     */
+    node* take_all()
+    {
+        node* item = queue_.exchange(nullptr, std::memory_order_acquire);
+        node* reversed = nullptr;
+        while (item != nullptr) {
+            node* next = item->next;
+            item->next = reversed;
+            reversed = item;
+            item = next;
+        }
+        return reversed;
+    }
+
+  private:
+    static constexpr std::uint64_t index_mask = 0xffff'ffffULL;
+
+    struct spare_buffer {
+        std::vector<std::uint8_t> buffer{};
+        std::atomic<std::uint32_t> next{ invalid_index }; // link in the stack of filled or empty spare buffers
+    };
+
+    static std::uint64_t next_tag(std::uint64_t head)
+    {
+        return ((head >> 32U) + 1) << 32U;
+    }
+
+    struct node_links {
+        node* nodes;
+
+        std::atomic<std::uint32_t>& operator()(std::uint32_t index) const
+        {
+            return nodes[index].next_free;
+        }
+    };
+
+    struct spare_links {
+        spare_buffer* spares;
+
+        std::atomic<std::uint32_t>& operator()(std::uint32_t index) const
+        {
+            return spares[index].next;
+        }
+    };
+
+    /**
+     * Pops index from the tagged stack, where the link of every index is returned by next_of.
+     */
+    template<typename NextOf>
+    static std::uint32_t pop(std::atomic<std::uint64_t>& stack, NextOf next_of)
+    {
+        std::uint64_t head = stack.load(std::memory_order_acquire);
+        for (;;) {
+            auto index = static_cast<std::uint32_t>(head & index_mask);
+            if (index == invalid_index) {
+                return invalid_index;
+            }
+            std::uint64_t next = next_tag(head) | next_of(index).load(std::memory_order_relaxed);
+            if (stack.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                return index;
+            }
+        }
+    }
+
+    template<typename NextOf>
+    static void push(std::atomic<std::uint64_t>& stack, std::uint32_t index, NextOf next_of)
+    {
+        std::uint64_t head = stack.load(std::memory_order_relaxed);
+        std::uint64_t next = 0;
+        do {
+            next_of(index).store(static_cast<std::uint32_t>(head & index_mask), std::memory_order_relaxed);
+            next = next_tag(head) | index;
+        } while (!stack.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     * Keeps the buffer for take_buffer(), unless it is too large or all spare slots are taken (then it is freed).
+     */
+    void recycle(std::vector<std::uint8_t> buffer)
+    {
+        if (buffer.capacity() == 0 || buffer.capacity() > max_retained_capacity) {
+            return;
+        }
+        auto index = pop(empty_spares_head_, spare_links{ spare_buffers_.data() });
+        if (index == invalid_index) {
+            return;
+        }
+        buffer.clear();
+        spare_buffers_[index].buffer = std::move(buffer);
+        push(filled_spares_head_, index, spare_links{ spare_buffers_.data() });
+    }
+
+    std::uint32_t pool_size_;
+    std::unique_ptr<node[]> pool_;
+    std::atomic<std::uint64_t> free_head_{ invalid_index };
+    std::atomic<node*> queue_{ nullptr };
+    std::array<spare_buffer, spare_buffer_count> spare_buffers_{};
+    std::atomic<std::uint64_t> filled_spares_head_{ invalid_index };
+    std::atomic<std::uint64_t> empty_spares_head_{ invalid_index };
+};
+} // namespace couchbase::io
@@ -19,83 +19,167 @@
 
 #include <snappy.h>
 
+#include <asio/buffer.hpp>
+
 #include <gsl/gsl_assert>
 #include <protocol/magic.hxx>
 #include <protocol/datatype.hxx>
+#include <io/mcbp_message.hxx>
 
 #include <spdlog/fmt/bin_to_hex.h>
 
 namespace couchbase::io
 {
+/**
+ * Accumulates bytes read from the socket and splits them into frames.
+ *
+ * The socket reads directly into the free tail of the parser's buffer (see prepare() and commit()), and the parsed frames
+ * are consumed by advancing the read offset, so that the unread bytes are moved to the front at most once per read
+ * instead of once per frame. Once the header of the frame is known, the buffer is grown to fit the whole frame, so that
+ * large values are read in place without intermediate copies. The buffer, that has grown beyond max_retained_size, is
+ * released once the large frame has been consumed, so that a single large value does not pin the memory for the lifetime
+ * of the session.
+ */
 struct mcbp_parser {
     enum result { ok, need_data, failure };
 
+    static constexpr size_t header_size = 24;
+    static constexpr size_t min_read_size = 16384;
+    static constexpr size_t max_retained_size = 4 * min_read_size;
+
     template<typename Iterator>
     void feed(Iterator begin, Iterator end)
     {
-        buf.reserve(buf.size() + static_cast<size_t>(std::distance(begin, end)));
-        std::copy(begin, end, std::back_inserter(buf));
+        auto size = static_cast<size_t>(std::distance(begin, end));
+        reserve(size);
+        std::copy(begin, end, buf.begin() + static_cast<std::ptrdiff_t>(end_));
+        commit(size);
+    }
+
+    /**
+     * @return free space at the end of the buffer, large enough to hold the rest of the current frame
+     */
+    asio::mutable_buffer prepare()
+    {
+        size_t available = end_ - begin_;
+        size_t wanted = min_read_size;
+        if (available >= header_size) {
+            std::uint32_t body_size = 0;
+            std::memcpy(&body_size, buf.data() + begin_ + offsetof(binary_header, bodylen), sizeof(body_size));
+            size_t frame_size = header_size + ntohl(body_size);
+            if (frame_size > available) {
+                wanted = std::max(wanted, frame_size - available);
+            }
+        }
+        reserve(wanted);
+        return asio::buffer(buf.data() + end_, buf.size() - end_);
+    }
+
+    /**
+     * Marks bytes written into the buffer returned by prepare() as available for parsing.
+     */
+    void commit(size_t size)
+    {
+        end_ += size;
     }
 
     void reset()
     {
-        buf.clear();
+        begin_ = 0;
+        end_ = 0;
+        if (buf.size() > max_retained_size) {
+            std::vector<std::uint8_t>{}.swap(buf);
+        }
     }
 
     result next(mcbp_message& msg)
     {
-        static const size_t header_size = 24;
-        if (buf.size() < header_size) {
+        size_t available = end_ - begin_;
+        if (available < header_size) {
             return need_data;
         }
-        std::memcpy(&msg.header, buf.data(), header_size);
+        const std::uint8_t* frame = buf.data() + begin_;
+        std::memcpy(&msg.header, frame, header_size);
         uint32_t body_size = ntohl(msg.header.bodylen);
-        if (body_size > 0 && buf.size() - header_size < body_size) {
+        if (body_size > 0 && available - header_size < body_size) {
             return need_data;
         }
         msg.body.clear();
-        msg.body.reserve(body_size);
         uint32_t key_size = ntohs(msg.header.keylen);
         uint32_t prefix_size = uint32_t(msg.header.extlen) + key_size;
         if (msg.header.magic == static_cast<uint8_t>(protocol::magic::alt_client_response)) {
-            uint8_t framing_extras_size = msg.header.keylen & 0xfU;
-            key_size = (msg.header.keylen & 0xf0U) >> 8U;
+            // alternative encoding splits the key length field into framing extras length and key length
+            uint8_t framing_extras_size = frame[2];
+            key_size = frame[3];
             prefix_size = uint32_t(framing_extras_size) + uint32_t(msg.header.extlen) + key_size;
         }
-        std::copy(buf.begin() + header_size, buf.begin() + header_size + prefix_size, std::back_inserter(msg.body));
+        const std::uint8_t* body = frame + header_size;
 
         bool is_compressed = (msg.header.datatype & static_cast<uint8_t>(protocol::datatype::snappy)) != 0;
         bool use_raw_value = true;
         if (is_compressed) {
-            std::string uncompressed;
-            size_t offset = header_size + prefix_size;
-            bool success = snappy::Uncompress(reinterpret_cast<const char*>(buf.data() + offset), body_size - prefix_size, &uncompressed);
-            if (success) {
-                std::copy(uncompressed.begin(), uncompressed.end(), std::back_inserter(msg.body));
-                use_raw_value = false;
-                // patch header with new body size
-                msg.header.bodylen = htonl(static_cast<std::uint32_t>(prefix_size + uncompressed.size()));
+            size_t uncompressed_size = 0;
+            const auto* compressed = reinterpret_cast<const char*>(body + prefix_size);
+            size_t compressed_size = body_size - prefix_size;
+            if (snappy::GetUncompressedLength(compressed, compressed_size, &uncompressed_size)) {
+                msg.body.resize(prefix_size + uncompressed_size);
+                if (snappy::RawUncompress(compressed, compressed_size, reinterpret_cast<char*>(msg.body.data() + prefix_size))) {
+                    std::copy(body, body + prefix_size, msg.body.begin());
+                    use_raw_value = false;
+                    // patch header with new body size
+                    msg.header.bodylen = htonl(static_cast<std::uint32_t>(prefix_size + uncompressed_size));
+                }
             }
         }
         if (use_raw_value) {
-            std::copy(buf.begin() + header_size + prefix_size, buf.begin() + header_size + body_size, std::back_inserter(msg.body));
+            msg.body.assign(body, body + body_size);
         }
-        buf.erase(buf.begin(), buf.begin() + header_size + body_size);
-        if (!protocol::is_valid_magic(buf[0])) {
+        begin_ += header_size + body_size;
+        if (begin_ == end_) {
+            reset();
+        } else if (!protocol::is_valid_magic(buf[begin_])) {
             spdlog::warn("parsed frame for magic={:x}, opcode={:x}, opaque={}, body_len={}. Invalid magic of the next frame: {:x}, {} "
                          "bytes to parse{}",
                          msg.header.magic,
                          msg.header.opcode,
                          msg.header.opaque,
                          body_size,
-                         buf[0],
-                         buf.size(),
-                         spdlog::to_hex(buf));
+                         buf[begin_],
+                         end_ - begin_,
+                         spdlog::to_hex(buf.begin() + static_cast<std::ptrdiff_t>(begin_),
+                                        buf.begin() + static_cast<std::ptrdiff_t>(end_)));
             reset();
         }
         return ok;
     }
 
-    std::vector<std::uint8_t> buf;
+  private:
+    /**
+     * Ensures that there are at least size bytes of free space after the unread data.
+     */
+    void reserve(size_t size)
+    {
+        if (begin_ > 0 && buf.size() - end_ < size) {
+            size_t unread = end_ - begin_;
+            if (buf.size() > max_retained_size && unread + size <= max_retained_size) {
+                // the large frame has been consumed, so move the unread part into the buffer of regular size
+                std::vector<std::uint8_t> smaller(std::max(unread + size, min_read_size));
+                std::memcpy(smaller.data(), buf.data() + begin_, unread);
+                buf.swap(smaller);
+            } else {
+                // shift the unread part of the frame to the front
+                std::memmove(buf.data(), buf.data() + begin_, unread);
+            }
+            end_ = unread;
+            begin_ = 0;
+        }
+        if (buf.size() - end_ < size) {
+            buf.resize(end_ + size);
+        }
+    }
+
+    std::vector<std::uint8_t> buf{};
+    size_t begin_{ 0 }; // offset of the first unread byte
+    size_t end_{ 0 };   // offset past the last byte received from the socket
 };
 } // namespace couchbase::io
@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <map>
+#include <queue>
+#include <string_view>
 #include <utility>
 
 #include <tao/json.hpp>
@@ -27,6 +30,9 @@
 
 #include <io/mcbp_message.hxx>
 #include <io/mcbp_parser.hxx>
+#include <io/mcbp_output_queue.hxx>
+#include <io/mcbp_handler_table.hxx>
+#include <io/streams.hxx>
 
 #include <timeout_defaults.hxx>
 
@@ -48,7 +54,9 @@
 
 #include <spdlog/fmt/bin_to_hex.h>
 
+#include <metrics_registry.hxx>
 #include <origin.hxx>
+#include <orphan_reporter.hxx>
 #include <errors.hxx>
 #include <version.hxx>
 
@@ -61,11 +69,13 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
     {
       private:
         std::map<std::string, std::uint32_t> cid_map_{ { "_default._default", 0 } };
+        std::mutex cid_map_mutex_{};
 
       public:
         [[nodiscard]] std::optional<std::uint32_t> get(const std::string& path)
         {
             Expects(!path.empty());
+            std::scoped_lock lock(cid_map_mutex_);
             auto ptr = cid_map_.find(path);
             if (ptr != cid_map_.end()) {
                 return ptr->second;
@@ -76,11 +86,13 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         void update(const std::string& path, std::uint32_t id)
         {
             Expects(!path.empty());
+            std::scoped_lock lock(cid_map_mutex_);
             cid_map_[path] = id;
         }
 
         void reset()
         {
+            std::scoped_lock lock(cid_map_mutex_);
             cid_map_.clear();
             cid_map_["_default._default"] = 0;
         }
@@ -136,11 +148,11 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
                           session_->log_prefix_,
                           hello_req.body().user_agent(),
                           fmt::join(hello_req.body().features(), ", "));
-            session_->write(hello_req.data());
+            session_->write(std::move(hello_req.data()));
 
             protocol::client_request<protocol::sasl_list_mechs_request_body> list_req;
             list_req.opaque(session_->next_opaque());
-            session_->write(list_req.data());
+            session_->write(std::move(list_req.data()));
 
             protocol::client_request<protocol::sasl_auth_request_body> auth_req;
             sasl::error sasl_code;
@@ -149,7 +161,7 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
             auth_req.opaque(session_->next_opaque());
             auth_req.body().mechanism(sasl_.get_name());
             auth_req.body().sasl_data(sasl_payload);
-            session_->write(auth_req.data());
+            session_->write(std::move(auth_req.data()));
 
             session_->flush();
         }
@@ -166,17 +178,17 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
             if (session_->supports_feature(protocol::hello_feature::xerror)) {
                 protocol::client_request<protocol::get_error_map_request_body> errmap_req;
                 errmap_req.opaque(session_->next_opaque());
-                session_->write(errmap_req.data());
+                session_->write(std::move(errmap_req.data()));
             }
             if (session_->bucket_name_) {
                 protocol::client_request<protocol::select_bucket_request_body> sb_req;
                 sb_req.opaque(session_->next_opaque());
                 sb_req.body().bucket_name(session_->bucket_name_.value());
-                session_->write(sb_req.data());
+                session_->write(std::move(sb_req.data()));
             }
             protocol::client_request<protocol::get_cluster_config_request_body> cfg_req;
             cfg_req.opaque(session_->next_opaque());
-            session_->write(cfg_req.data());
+            session_->write(std::move(cfg_req.data()));
             session_->flush();
         }
 
@@ -222,7 +234,7 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
                             req.opaque(session_->next_opaque());
                             req.body().mechanism(sasl_.get_name());
                             req.body().sasl_data(sasl_payload);
-                            session_->write_and_flush(req.data());
+                            session_->write_and_flush(std::move(req.data()));
                         } else {
                             spdlog::error("{} unable to authenticate: sasl_code={}", session_->log_prefix_, sasl_code);
                             return complete(std::make_error_code(error::common_errc::authentication_failure));
@@ -310,7 +322,7 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
 
         explicit normal_handler(std::shared_ptr<mcbp_session> session)
           : session_(session)
-          , heartbeat_timer_(session_->ctx_)
+          , heartbeat_timer_(session_->strand_)
         {
             if (session_->supports_gcccp_) {
                 fetch_config({});
@@ -350,6 +362,7 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
                         } break;
                         case protocol::client_opcode::get_collection_id:
                         case protocol::client_opcode::get:
+                        case protocol::client_opcode::get_replica:
                         case protocol::client_opcode::get_and_lock:
                         case protocol::client_opcode::get_and_touch:
                         case protocol::client_opcode::touch:
@@ -365,22 +378,21 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
                         case protocol::client_opcode::subdoc_multi_mutation: {
                             std::uint32_t opaque = msg.header.opaque;
                             std::uint16_t status = ntohs(msg.header.specific);
-                            auto handler = session_->command_handlers_.find(opaque);
-                            if (handler != session_->command_handlers_.end()) {
+                            auto fun = session_->extract_command_handler(opaque);
+                            if (fun) {
                                 auto ec = session_->map_status_code(opcode, status);
                                 spdlog::debug("{} MCBP invoke operation handler, opaque={}, status={}, ec={}",
                                               session_->log_prefix_,
                                               opaque,
                                               status,
                                               ec.message());
-                                auto fun = handler->second;
-                                session_->command_handlers_.erase(handler);
                                 fun(ec, std::move(msg));
                             } else {
                                 spdlog::debug("{} unexpected orphan response opcode={}, opaque={}",
                                               session_->log_prefix_,
                                               msg.header.opcode,
                                               msg.header.opaque);
+                                session_->report_orphan(opcode, msg);
                             }
                         } break;
                         default:
@@ -420,7 +432,7 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
             }
             protocol::client_request<protocol::get_cluster_config_request_body> req;
             req.opaque(session_->next_opaque());
-            session_->write_and_flush(req.data());
+            session_->write_and_flush(std::move(req.data()));
             heartbeat_timer_.expires_after(std::chrono::milliseconds(2500));
             heartbeat_timer_.async_wait(std::bind(&normal_handler::fetch_config, this, std::placeholders::_1));
         }
@@ -436,12 +448,34 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
       : client_id_(client_id)
       , id_(uuid::to_string(uuid::random()))
       , ctx_(ctx)
-      , resolver_(ctx_)
       , strand_(asio::make_strand(ctx_))
-      , socket_(strand_)
-      , bootstrap_deadline_(ctx_)
-      , connection_deadline_(ctx_)
-      , retry_backoff_(ctx_)
+      , resolver_(strand_)
+      , stream_(std::make_unique<plain_stream_impl>(strand_))
+      , bootstrap_deadline_(strand_)
+      , connection_deadline_(strand_)
+      , retry_backoff_(strand_)
+      , origin_(origin)
+      , bucket_name_(std::move(bucket_name))
+      , supported_features_(known_features)
+    {
+        log_prefix_ = fmt::format("[{}/{}/{}]", client_id_, id_, bucket_name_.value_or("-"));
+    }
+
+    mcbp_session(const std::string& client_id,
+                 asio::io_context& ctx,
+                 asio::ssl::context& tls,
+                 const couchbase::origin& origin,
+                 std::optional<std::string> bucket_name = {},
+                 std::vector<protocol::hello_feature> known_features = {})
+      : client_id_(client_id)
+      , id_(uuid::to_string(uuid::random()))
+      , ctx_(ctx)
+      , strand_(asio::make_strand(ctx_))
+      , resolver_(strand_)
+      , stream_(std::make_unique<tls_stream_impl>(strand_, tls))
+      , bootstrap_deadline_(strand_)
+      , connection_deadline_(strand_)
+      , retry_backoff_(strand_)
       , origin_(origin)
       , bucket_name_(std::move(bucket_name))
       , supported_features_(known_features)
@@ -451,7 +485,10 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
 
     ~mcbp_session()
     {
-        stop();
+        // nothing else holds the session at this point, so it is safe to tear it down on the current thread
+        if (!stopped_.exchange(true)) {
+            do_stop();
+        }
     }
 
     [[nodiscard]] const std::string& log_prefix() const
@@ -459,6 +496,11 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         return log_prefix_;
     }
 
+    [[nodiscard]] std::string remote_address() const
+    {
+        return fmt::format("{}:{}", endpoint_address_, endpoint_.port());
+    }
+
     void bootstrap(std::function<void(std::error_code, configuration)>&& handler)
     {
         bootstrap_handler_ = std::move(handler);
@@ -498,6 +540,7 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         std::tie(hostname, service) = origin_.next_address();
         log_prefix_ = fmt::format("[{}/{}/{}] <{}:{}>", client_id_, id_, bucket_name_.value_or("-"), hostname, service);
         spdlog::debug("{} attempt to establish MCBP connection", log_prefix_);
+        stream_->server_name(hostname);
         resolver_.async_resolve(
           hostname, service, std::bind(&mcbp_session::on_resolve, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
     }
@@ -507,45 +550,38 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         return id_;
     }
 
+    /**
+     * Might be called from any thread, the teardown is posted to the strand of the session.
+     */
     void stop()
     {
-        if (stopped_) {
+        if (stopped_.exchange(true)) {
             return;
         }
-        stopped_ = true;
-        bootstrap_deadline_.cancel();
-        connection_deadline_.cancel();
-        retry_backoff_.cancel();
-        resolver_.cancel();
-        if (socket_.is_open()) {
-            socket_.close();
-        }
-        auto ec = std::make_error_code(error::common_errc::request_canceled);
-        if (!bootstrapped_ && bootstrap_handler_) {
-            bootstrap_handler_(ec, {});
-            bootstrap_handler_ = nullptr;
-        }
-        if (handler_) {
-            handler_->stop();
-        }
-        for (auto& handler : command_handlers_) {
-            spdlog::debug("{} MCBP cancel operation during session close, opaque={}, ec={}", log_prefix_, handler.first, ec.message());
-            handler.second(ec, {});
-        }
-        command_handlers_.clear();
+        asio::post(strand_, [self = shared_from_this()]() { self->do_stop(); });
     }
 
-    void write(const std::vector<uint8_t>& buf)
+    /**
+     * The payload is moved into the frame, so the caller does not need it after the call.
+     */
+    void write(std::vector<uint8_t>&& payload,
+               std::string_view value = {},
+               std::shared_ptr<void> value_owner = {},
+               std::atomic<std::chrono::steady_clock::rep>* written_at = nullptr)
     {
         if (stopped_) {
             return;
         }
         std::uint32_t opaque{ 0 };
-        std::memcpy(&opaque, buf.data() + 12, sizeof(opaque));
-        spdlog::debug("{} MCBP send, opaque={}, {:n}", log_prefix_, opaque, spdlog::to_hex(buf.begin(), buf.begin() + 24));
-        SPDLOG_TRACE("{} MCBP send, opaque={}{:a}", log_prefix_, opaque, spdlog::to_hex(data));
-        std::scoped_lock lock(output_buffer_mutex_);
-        output_buffer_.push_back(buf);
+        std::memcpy(&opaque, payload.data() + 12, sizeof(opaque));
+        spdlog::debug("{} MCBP send, opaque={}, {:n}", log_prefix_, opaque, spdlog::to_hex(payload.begin(), payload.begin() + 24));
+        SPDLOG_TRACE("{} MCBP send, opaque={}{:a}", log_prefix_, opaque, spdlog::to_hex(payload));
+        auto* node = output_queue_.acquire();
+        node->frame.payload = std::move(payload);
+        node->frame.value = value;
+        node->frame.value_owner = std::move(value_owner);
+        node->frame.written_at = written_at;
+        output_queue_.push(node);
     }
 
     void flush()
@@ -553,34 +589,70 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         if (stopped_) {
             return;
         }
-        do_write();
+        // one scheduled write picks up everything submitted before it starts, so there is no need to post more
+        if (!flush_scheduled_.exchange(true)) {
+            asio::post(strand_, [self = shared_from_this()]() { self->do_write(); });
+        }
+    }
+
+    /**
+     * @return empty buffer, that keeps the capacity of the frame written earlier, so that the next frame can be encoded
+     * without allocation. The frame encoded into it has to be passed to write() or write_and_subscribe().
+     */
+    std::vector<std::uint8_t> payload_buffer()
+    {
+        return output_queue_.take_buffer();
     }
 
-    void write_and_flush(const std::vector<uint8_t>& buf)
+    void write_and_flush(std::vector<uint8_t>&& buf)
     {
         if (stopped_) {
             return;
         }
-        write(buf);
+        write(std::move(buf));
         flush();
     }
 
+    void write_and_subscribe(uint32_t opaque, std::vector<std::uint8_t>&& data, mcbp_command_handler&& handler)
+    {
+        write_and_subscribe(opaque, std::move(data), {}, {}, nullptr, std::move(handler));
+    }
+
     void write_and_subscribe(uint32_t opaque,
-                             std::vector<std::uint8_t>& data,
-                             std::function<void(std::error_code, io::mcbp_message&&)> handler)
+                             std::vector<std::uint8_t>&& payload,
+                             std::string_view value,
+                             std::shared_ptr<void> value_owner,
+                             std::atomic<std::chrono::steady_clock::rep>* written_at,
+                             mcbp_command_handler&& handler)
     {
         if (stopped_) {
             spdlog::warn("{} MCBP cancel operation, while trying to write to closed session opaque={}", log_prefix_, opaque);
             handler(std::make_error_code(error::common_errc::request_canceled), {});
             return;
         }
-        command_handlers_.emplace(opaque, std::move(handler));
-        if (bootstrapped_ && socket_.is_open()) {
-            write_and_flush(data);
-        } else {
+        bool inserted = false;
+        {
+            std::scoped_lock lock(command_handlers_mutex_);
+            inserted = command_handlers_.insert(opaque, std::move(handler));
+            if (inserted) {
+                ++in_flight_;
+            }
+        }
+        if (!inserted) {
+            spdlog::warn("{} MCBP cancel operation, another operation with the same opaque is in flight, opaque={}", log_prefix_, opaque);
+            handler(std::make_error_code(error::common_errc::request_canceled), {});
+            return;
+        }
+        if (!bootstrapped_) {
             std::scoped_lock lock(pending_buffer_mutex_);
-            pending_buffer_.push_back(data);
+            // check again, because pending buffer might have been already flushed by the bootstrap
+            if (!bootstrapped_ || !stream_->is_open()) {
+                pending_buffer_.emplace_back(mcbp_output_frame{ std::move(payload), value, std::move(value_owner), written_at });
+                return;
+            }
         }
+        write(std::move(payload), value, std::move(value_owner), written_at);
+        flush();
     }
 
     void cancel(uint32_t opaque, std::error_code ec)
@@ -588,11 +660,19 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         if (stopped_) {
             return;
         }
-        auto handler = command_handlers_.find(opaque);
-        if (handler != command_handlers_.end()) {
+        auto handler = extract_command_handler(opaque);
+        if (handler) {
             spdlog::debug("{} MCBP cancel operation, opaque={}, ec={}", log_prefix_, opaque, ec.message());
-            handler->second(ec, {});
-            command_handlers_.erase(handler);
+            if (orphan_reporter_) {
+                std::scoped_lock lock(command_handlers_mutex_);
+                cancelled_at_.emplace(opaque, std::chrono::steady_clock::now());
+                cancelled_order_.push(opaque);
+                while (cancelled_order_.size() > max_cancelled_tracked) {
+                    cancelled_at_.erase(cancelled_order_.front());
+                    cancelled_order_.pop();
+                }
+            }
+            handler(ec, {});
         }
     }
 
@@ -627,6 +707,30 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         return config_->index_for_this_node();
     }
 
+    /**
+     * @return number of operations, that has been written to the session, but not yet completed
+     */
+    [[nodiscard]] std::size_t outstanding_operations() const
+    {
+        return in_flight_;
+    }
+
+    /**
+     * @return true if the session has been stopped (explicitly, or because of the failed bootstrap or IO error)
+     */
+    [[nodiscard]] bool is_stopped() const
+    {
+        return stopped_;
+    }
+
+    /**
+     * @return true if the session has completed the handshake, and does not buffer the commands anymore
+     */
+    [[nodiscard]] bool is_bootstrapped() const
+    {
+        return bootstrapped_;
+    }
+
     [[nodiscard]] uint32_t next_opaque()
     {
         return ++opaque_;
@@ -753,8 +857,10 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
             case protocol::status::subdoc_xattr_cannot_modify_vattr:
                 return std::make_error_code(error::key_value_errc::xattr_cannot_modify_virtual_attribute);
 
-            case protocol::status::subdoc_invalid_xattr_order:
             case protocol::status::not_my_vbucket:
+                return std::make_error_code(error::network_errc::configuration_not_available);
+
+            case protocol::status::subdoc_invalid_xattr_order:
             case protocol::status::auth_continue:
             case protocol::status::range_error:
             case protocol::status::rollback:
@@ -765,8 +871,21 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
             case protocol::status::dcp_stream_id_invalid:
                 break;
         }
-        // FIXME: use error map here
-        spdlog::warn("{} unknown status code: {} (opcode={})", log_prefix_, status, opcode);
+        if (auto info = decode_error_code(status); info) {
+            spdlog::warn(
+              "{} status code {:x} (opcode={}) from error map: {} ({})", log_prefix_, status, opcode, info->name, info->description);
+            if (info->has_attribute("item-locked")) {
+                return std::make_error_code(error::key_value_errc::document_locked);
+            }
+            if (info->has_attribute("auth")) {
+                return std::make_error_code(error::common_errc::authentication_failure);
+            }
+            if (info->has_attribute("temp") || info->has_attribute("retry-now") || info->has_attribute("retry-later")) {
+                return std::make_error_code(error::common_errc::temporary_failure);
+            }
+        } else {
+            spdlog::warn("{} unknown status code: {} (opcode={})", log_prefix_, status, opcode);
+        }
         return std::make_error_code(error::network_errc::protocol_error);
     }
 
@@ -783,7 +902,113 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
             }
             config_.emplace(config);
             spdlog::debug("{} received new configuration: {}", log_prefix_, config_.value());
+            if (config_listener_) {
+                config_listener_(config_.value());
+            }
+        }
+    }
+
+    /**
+     * Registers listener, that will be notified about every newer configuration received by the session (bootstrap,
+     * polling, server notifications and bodies of "not my vbucket" responses).
+     *
+     * Must be called before bootstrap.
+     */
+    void on_configuration_update(std::function<void(const configuration&)>&& listener)
+    {
+        config_listener_ = std::move(listener);
+    }
+
+    /**
+     * Sets the reporter for the responses, that arrived after their operations had been cancelled.
+     *
+     * Must be called before bootstrap.
+     */
+    void report_orphans_to(std::shared_ptr<couchbase::orphan_reporter> reporter)
+    {
+        orphan_reporter_ = std::move(reporter);
+    }
+
+    /**
+     * Sets the registry for the metrics of the node, that will be used once the session is connected.
+     *
+     * Must be called before bootstrap.
+     */
+    void collect_metrics_to(std::shared_ptr<metrics_registry> registry)
+    {
+        metrics_registry_ = std::move(registry);
+    }
+
+    /**
+     * @return metrics of the connected node, or nullptr if the metrics are not collected
+     */
+    [[nodiscard]] const std::shared_ptr<node_metrics>& metrics() const
+    {
+        return metrics_;
+    }
+
+    void report_orphan(protocol::client_opcode opcode, const io::mcbp_message& msg)
+    {
+        if (!orphan_reporter_) {
+            return;
+        }
+        couchbase::orphan_reporter::orphan orphan{ fmt::format("{}", opcode), msg.header.opaque, remote_address() };
+        if (msg.header.magic == static_cast<std::uint8_t>(protocol::magic::alt_client_response)) {
+            auto framing_extras_size = std::min(std::size_t(msg.header_data()[2]), msg.body.size());
+            if (auto duration = protocol::parse_server_duration_us(msg.body.data(), framing_extras_size); duration > 0) {
+                orphan.server_duration = std::chrono::microseconds(static_cast<std::int64_t>(duration));
+            }
+        }
+        {
+            std::scoped_lock lock(command_handlers_mutex_);
+            if (auto cancelled = cancelled_at_.find(msg.header.opaque); cancelled != cancelled_at_.end()) {
+                orphan.late_by = std::chrono::duration_cast<std::chrono::microseconds>(msg.received_at - cancelled->second);
+                cancelled_at_.erase(cancelled);
+            }
         }
+        orphan_reporter_->report(std::move(orphan));
+    }
+
+    /**
+     * Extracts configuration from the body of the "not my vbucket" response, the server might send it to help the client
+     * to re-route the command without waiting for the next poll.
+     */
+    void handle_not_my_vbucket(const io::mcbp_message& msg)
+    {
+        if (stopped_) {
+            return;
+        }
+        auto header = msg.header_data();
+        std::size_t prefix_size = msg.header.extlen;
+        if (msg.header.magic == static_cast<std::uint8_t>(protocol::magic::alt_client_response)) {
+            prefix_size += std::size_t(header[2]) + std::size_t(header[3]);
+        } else {
+            prefix_size += (std::size_t(header[2]) << 8U) + std::size_t(header[3]);
+        }
+        if (msg.body.size() <= prefix_size || msg.body[prefix_size] != '{') {
+            return;
+        }
+        try {
+            std::string payload(msg.body.begin() + static_cast<std::ptrdiff_t>(prefix_size), msg.body.end());
+            auto config = tao::json::from_string<protocol::deduplicate_keys>(payload).as<configuration>();
+            spdlog::debug("{} received configuration with \"not my vbucket\" response, rev={}", log_prefix_, config.rev);
+            update_configuration(std::move(config));
+        } catch (const std::exception& e) {
+            spdlog::debug("{} unable to parse configuration from \"not my vbucket\" response: {}", log_prefix_, e.what());
+        }
+    }
+
+    /**
+     * @return description of the status code from the error map of the node, if the node has sent it
+     */
+    [[nodiscard]] std::optional<error_map::error_info> decode_error_code(std::uint16_t code) const
+    {
+        if (errmap_) {
+            if (auto it = errmap_->errors.find(code); it != errmap_->errors.end()) {
+                return it->second;
+            }
+        }
+        return {};
     }
 
     std::optional<std::uint32_t> get_collection_uid(const std::string& collection_path)
@@ -800,6 +1025,51 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
     }
 
   private:
+    void do_stop()
+    {
+        bootstrap_deadline_.cancel();
+        connection_deadline_.cancel();
+        retry_backoff_.cancel();
+        resolver_.cancel();
+        if (stream_->is_open()) {
+            stream_->close();
+        }
+        // drop frames that will never be written, they keep references to the commands
+        for (auto* node = output_queue_.take_all(); node != nullptr;) {
+            auto* next = node->next;
+            output_queue_.release(node);
+            node = next;
+        }
+        auto ec = std::make_error_code(error::common_errc::request_canceled);
+        if (!bootstrapped_ && bootstrap_handler_) {
+            bootstrap_handler_(ec, {});
+            bootstrap_handler_ = nullptr;
+        }
+        if (handler_) {
+            handler_->stop();
+        }
+        std::vector<std::pair<std::uint32_t, mcbp_command_handler>> handlers{};
+        {
+            std::scoped_lock lock(command_handlers_mutex_);
+            handlers = command_handlers_.extract_all();
+            in_flight_ = 0;
+        }
+        for (auto& handler : handlers) {
+            spdlog::debug("{} MCBP cancel operation during session close, opaque={}, ec={}", log_prefix_, handler.first, ec.message());
+            handler.second(ec, {});
+        }
+    }
+
+    mcbp_command_handler extract_command_handler(uint32_t opaque)
+    {
+        std::scoped_lock lock(command_handlers_mutex_);
+        auto handler = command_handlers_.extract(opaque);
+        if (handler) {
+            --in_flight_;
+        }
+        return handler;
+    }
+
     void invoke_bootstrap_handler(std::error_code ec)
     {
         if (!bootstrapped_ && bootstrap_handler_) {
@@ -814,8 +1084,8 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         handler_ = std::make_unique<normal_handler>(shared_from_this());
         std::scoped_lock lock(pending_buffer_mutex_);
         if (!pending_buffer_.empty()) {
-            for (const auto& buf : pending_buffer_) {
-                write(buf);
+            for (auto& frame : pending_buffer_) {
+                write(std::move(frame.payload), frame.value, std::move(frame.value_owner), frame.written_at);
             }
             pending_buffer_.clear();
             flush();
@@ -845,7 +1115,7 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         if (it != endpoints_.end()) {
             spdlog::debug("{} connecting to {}:{}", log_prefix_, it->endpoint().address().to_string(), it->endpoint().port());
             connection_deadline_.expires_after(timeout_defaults::connect_timeout);
-            socket_.async_connect(it->endpoint(), std::bind(&mcbp_session::on_connect, shared_from_this(), std::placeholders::_1, it));
+            stream_->async_connect(it->endpoint(), std::bind(&mcbp_session::on_connect, shared_from_this(), std::placeholders::_1, it));
         } else {
             spdlog::error("{} no more endpoints left to connect, will try another address", log_prefix_);
             return initiate_bootstrap();
@@ -857,18 +1127,21 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
         if (stopped_) {
             return;
         }
-        if (!socket_.is_open() || ec) {
+        if (!stream_->is_open() || ec) {
             spdlog::warn(
               "{} unable to connect to {}:{}: {}", log_prefix_, it->endpoint().address().to_string(), it->endpoint().port(), ec.message());
             do_connect(++it);
         } else {
-            socket_.set_option(asio::ip::tcp::no_delay{ true });
-            socket_.set_option(asio::socket_base::keep_alive{ true });
+            stream_->set_options();
             endpoint_ = it->endpoint();
             endpoint_address_ = endpoint_.address().to_string();
             spdlog::debug("{} connected to {}:{}", log_prefix_, endpoint_address_, it->endpoint().port());
             log_prefix_ =
               fmt::format("[{}/{}/{}] <{}:{}>", client_id_, id_, bucket_name_.value_or("-"), endpoint_address_, endpoint_.port());
+            if (metrics_registry_) {
+                metrics_ = metrics_registry_->node(remote_address());
+                ++metrics_->connects;
+            }
             handler_ = std::make_unique<bootstrap_handler>(shared_from_this());
             connection_deadline_.expires_at(asio::steady_timer::time_point::max());
             connection_deadline_.cancel();
@@ -881,7 +1154,7 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
             return;
         }
         if (connection_deadline_.expiry() <= asio::steady_timer::clock_type::now()) {
-            socket_.close();
+            stream_->close();
             connection_deadline_.expires_at(asio::steady_timer::time_point::max());
         }
         connection_deadline_.async_wait(std::bind(&mcbp_session::check_deadline, shared_from_this(), std::placeholders::_1));
@@ -896,8 +1169,8 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
             return;
         }
         reading_ = true;
-        socket_.async_read_some(
-          asio::buffer(input_buffer_), [self = shared_from_this()](std::error_code ec, std::size_t bytes_transferred) {
+        stream_->async_read_some(
+          parser_.prepare(), [self = shared_from_this()](std::error_code ec, std::size_t bytes_transferred) {
               if (ec == asio::error::operation_aborted || self->stopped_) {
                   return;
               }
@@ -905,12 +1178,17 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
                   spdlog::error("{} IO error while reading from the socket: {}", self->log_prefix_, ec.message());
                   return self->stop();
               }
-              self->parser_.feed(self->input_buffer_.data(), self->input_buffer_.data() + ssize_t(bytes_transferred));
+              self->parser_.commit(bytes_transferred);
+              if (self->metrics_) {
+                  self->metrics_->bytes_in += bytes_transferred;
+              }
+              auto received_at = std::chrono::steady_clock::now();
 
               for (;;) {
                   mcbp_message msg{};
                   switch (self->parser_.next(msg)) {
                       case mcbp_parser::ok:
+                          msg.received_at = received_at;
                           spdlog::debug(
                             "{} MCBP recv, opaque={}, {:n}", self->log_prefix_, msg.header.opaque, spdlog::to_hex(msg.header_data()));
                           SPDLOG_TRACE("{} MCBP recv, opaque={}{:a}{:a}",
@@ -936,22 +1214,57 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
           });
     }
 
+    /**
+     * Returns written frames to the pool. Must be invoked on the strand.
+     */
+    void release_writing_buffer()
+    {
+        for (auto* node : writing_buffer_) {
+            output_queue_.release(node);
+        }
+        writing_buffer_.clear();
+    }
+
+    /**
+     * Must be invoked on the strand, as it is the only consumer of the output queue.
+     */
     void do_write()
     {
+        flush_scheduled_ = false;
         if (stopped_) {
             return;
         }
-        std::scoped_lock lock(writing_buffer_mutex_, output_buffer_mutex_);
-        if (!writing_buffer_.empty() || output_buffer_.empty()) {
+        if (!writing_buffer_.empty()) {
+            return;
+        }
+        for (auto* node = output_queue_.take_all(); node != nullptr; node = node->next) {
+            writing_buffer_.push_back(node);
+        }
+        if (writing_buffer_.empty()) {
             return;
         }
-        std::swap(writing_buffer_, output_buffer_);
         std::vector<asio::const_buffer> buffers;
-        buffers.reserve(writing_buffer_.size());
-        for (auto& buf : writing_buffer_) {
-            buffers.emplace_back(asio::buffer(buf));
+        buffers.reserve(2 * writing_buffer_.size());
+        for (const auto* node : writing_buffer_) {
+            buffers.emplace_back(asio::buffer(node->frame.payload));
+            if (!node->frame.value.empty()) {
+                buffers.emplace_back(asio::buffer(node->frame.value.data(), node->frame.value.size()));
+            }
         }
-        asio::async_write(socket_, buffers, [self = shared_from_this()](std::error_code ec, std::size_t /*unused*/) {
+        stream_->async_write(buffers, [self = shared_from_this()](std::error_code ec, std::size_t bytes_transferred) {
+            if (self->metrics_) {
+                self->metrics_->bytes_out += bytes_transferred;
+            }
+            if (!ec) {
+                auto written_at = std::chrono::steady_clock::now().time_since_epoch().count();
+                for (const auto* node : self->writing_buffer_) {
+                    if (node->frame.written_at != nullptr) {
+                        node->frame.written_at->store(written_at);
+                    }
+                }
+            }
+            // frames have to be released even if the session has been stopped, because they keep references to the commands
+            self->release_writing_buffer();
             if (ec == asio::error::operation_aborted || self->stopped_) {
                 return;
             }
@@ -959,10 +1272,6 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
                 spdlog::error("{} IO error while writing to the socket: {}", self->log_prefix_, ec.message());
                 return self->stop();
             }
-            {
-                std::scoped_lock inner_lock(self->writing_buffer_mutex_);
-                self->writing_buffer_.clear();
-            }
             self->do_write();
             self->do_read();
         });
@@ -971,9 +1280,11 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
     std::string client_id_;
     std::string id_;
     asio::io_context& ctx_;
-    asio::ip::tcp::resolver resolver_;
+    // all IO objects of the session share the strand, and stop() posts the teardown to it, so the socket, the queues and
+    // the handlers are not accessed concurrently even when the context is being run by several threads
     asio::strand<asio::io_context::executor_type> strand_;
-    asio::ip::tcp::socket socket_;
+    asio::ip::tcp::resolver resolver_;
+    std::unique_ptr<stream_impl> stream_;
     asio::steady_timer bootstrap_deadline_;
     asio::steady_timer connection_deadline_;
     asio::steady_timer retry_backoff_;
@@ -982,9 +1293,15 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
     mcbp_parser parser_;
     std::unique_ptr<message_handler> handler_;
     std::function<void(std::error_code, const configuration&)> bootstrap_handler_;
-    std::map<uint32_t, std::function<void(std::error_code, io::mcbp_message&&)>> command_handlers_{};
-
-    bool bootstrapped_{ false };
+    mcbp_handler_table command_handlers_{};
+    std::atomic<std::size_t> in_flight_{ 0 }; // number of handlers in command_handlers_, readable without the lock
+    std::mutex command_handlers_mutex_{}; // also protects cancelled_at_ and cancelled_order_
+    // time of cancellation of the recent operations, to tell how late their orphaned responses are
+    static constexpr std::size_t max_cancelled_tracked = 1024;
+    std::map<std::uint32_t, std::chrono::steady_clock::time_point> cancelled_at_{};
+    std::queue<std::uint32_t> cancelled_order_{};
+
+    std::atomic_bool bootstrapped_{ false };
     std::atomic_bool stopped_{ false };
     bool authenticated_{ false };
     bool bucket_selected_{ false };
@@ -992,18 +1309,20 @@ class mcbp_session : public std::enable_shared_from_this<mcbp_session>
 
     std::atomic<std::uint32_t> opaque_{ 0 };
 
-    std::array<std::uint8_t, 16384> input_buffer_{};
-    std::vector<std::vector<std::uint8_t>> output_buffer_{};
-    std::vector<std::vector<std::uint8_t>> pending_buffer_{};
-    std::vector<std::vector<std::uint8_t>> writing_buffer_{};
-    std::mutex output_buffer_mutex_{};
+    mcbp_output_queue output_queue_{};
+    std::atomic_bool flush_scheduled_{ false };
+    std::vector<mcbp_output_queue::node*> writing_buffer_{}; // accessed only on the strand
+    std::vector<mcbp_output_frame> pending_buffer_{};
     std::mutex pending_buffer_mutex_{};
-    std::mutex writing_buffer_mutex_{};
     asio::ip::tcp::endpoint endpoint_{}; // connected endpoint
     std::string endpoint_address_{};     // cached string with endpoint address
     asio::ip::tcp::resolver::results_type endpoints_;
     std::vector<protocol::hello_feature> supported_features_;
     std::optional<configuration> config_;
+    std::function<void(const configuration&)> config_listener_{};
+    std::shared_ptr<couchbase::orphan_reporter> orphan_reporter_{};
+    std::shared_ptr<metrics_registry> metrics_registry_{};
+    std::shared_ptr<node_metrics> metrics_{}; // assigned once the session is connected
     std::optional<error_map> errmap_;
     collection_cache collection_cache_;
 
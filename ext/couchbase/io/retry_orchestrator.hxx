@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+
+#include <error_map.hxx>
+#include <protocol/status.hxx>
+
+namespace couchbase::io::retry_orchestrator
+{
+namespace priv
+{
+/**
+ * Backoff for the errors without server-provided specification: starts almost immediately to hide momentary
+ * conditions, and quickly grows to avoid hammering the node that is under pressure.
+ */
+inline std::chrono::milliseconds
+controlled_backoff(std::uint32_t retry_attempts)
+{
+    switch (retry_attempts) {
+        case 0:
+            return std::chrono::milliseconds(1);
+        case 1:
+            return std::chrono::milliseconds(10);
+        case 2:
+            return std::chrono::milliseconds(50);
+        case 3:
+            return std::chrono::milliseconds(100);
+        case 4:
+            return std::chrono::milliseconds(500);
+        default:
+            return std::chrono::milliseconds(1000);
+    }
+}
+
+inline std::chrono::milliseconds
+specified_backoff(const error_map::retry_specification& spec, std::uint32_t retry_attempts)
+{
+    if (retry_attempts == 0) {
+        return spec.after;
+    }
+    std::chrono::milliseconds backoff = spec.interval;
+    switch (spec.backoff) {
+        case error_map::retry_specification::strategy::constant:
+            break;
+        case error_map::retry_specification::strategy::linear:
+            backoff = spec.interval * retry_attempts;
+            break;
+        case error_map::retry_specification::strategy::exponential: {
+            auto exponent = std::min(retry_attempts, 32U);
+            auto value = std::pow(static_cast<double>(spec.interval.count()), static_cast<double>(exponent));
+            backoff = std::chrono::milliseconds(static_cast<std::int64_t>(std::min(value, 3'600'000.0)));
+        } break;
+    }
+    if (spec.ceil.count() > 0) {
+        backoff = std::min(backoff, spec.ceil);
+    }
+    return backoff;
+}
+
+inline bool
+is_retriable_status(protocol::status status)
+{
+    switch (status) {
+        case protocol::status::temp_failure:
+        case protocol::status::busy:
+        case protocol::status::no_memory:
+        case protocol::status::sync_write_in_progress:
+        case protocol::status::sync_write_re_commit_in_progress:
+            return true;
+        default:
+            return false;
+    }
+}
+} // namespace priv
+
+/**
+ * Decides whether the command, that has been rejected by the server, has to be sent again.
+ *
+ * The server error map takes precedence: its retry specification defines the backoff, and its attributes mark the codes
+ * unknown to the client as retriable. Otherwise the well-known transient statuses are retried with controlled backoff.
+ * Locked documents are never retried, because the lock is held by the application, and the caller expects to see it.
+ *
+ * @param status raw status code of the response
+ * @param info description of the status in the error map of the node, if available
+ * @param retry_attempts number of retries performed for the command so far
+ * @param elapsed time since the first attempt
+ *
+ * @return time to wait before the next attempt, or empty value if the error has to be reported
+ */
+inline std::optional<std::chrono::milliseconds>
+should_retry(std::uint16_t status,
+             const std::optional<error_map::error_info>& info,
+             std::uint32_t retry_attempts,
+             std::chrono::milliseconds elapsed)
+{
+    if (static_cast<protocol::status>(status) == protocol::status::locked || (info && info->has_attribute("item-locked"))) {
+        return {};
+    }
+    if (info && info->retry) {
+        auto backoff = priv::specified_backoff(info->retry.value(), retry_attempts);
+        if (info->retry->max_duration.count() > 0 && elapsed + backoff > info->retry->max_duration) {
+            return {};
+        }
+        return backoff;
+    }
+    if ((protocol::is_valid_status(status) && priv::is_retriable_status(static_cast<protocol::status>(status))) ||
+        (info && (info->has_attribute("retry-now") || info->has_attribute("retry-later") || info->has_attribute("auto-retry")))) {
+        return priv::controlled_backoff(retry_attempts);
+    }
+    return {};
+}
+} // namespace couchbase::io::retry_orchestrator
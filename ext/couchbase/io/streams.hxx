@@ -0,0 +1,228 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+#include <io/tls_session_cache.hxx>
+#include <utils/movable_function.hxx>
+
+namespace couchbase::io
+{
+/**
+ * Transport of the session: plain TCP socket or TLS stream on top of it.
+ *
+ * All operations have to be invoked on the strand of the owning session, the only exception is is_open(), which might
+ * be called from the other threads.
+ */
+class stream_impl
+{
+  public:
+    using connect_handler = utils::movable_function<void(std::error_code)>;
+    using io_handler = utils::movable_function<void(std::error_code, std::size_t)>;
+
+    stream_impl(asio::strand<asio::io_context::executor_type>& strand, bool tls)
+      : strand_(strand)
+      , tls_(tls)
+    {
+    }
+
+    stream_impl(const stream_impl&) = delete;
+    stream_impl& operator=(const stream_impl&) = delete;
+    virtual ~stream_impl() = default;
+
+    [[nodiscard]] bool is_tls() const
+    {
+        return tls_;
+    }
+
+    [[nodiscard]] bool is_open() const
+    {
+        return open_;
+    }
+
+    /**
+     * Name of the server, used for certificate verification, SNI and as the key for TLS session resumption.
+     */
+    void server_name(const std::string& name)
+    {
+        server_name_ = name;
+    }
+
+    virtual void close() = 0;
+
+    virtual void set_options() = 0;
+
+    /**
+     * Connects to the endpoint, and for TLS also performs the handshake. The stream might be reconnected after failure.
+     */
+    virtual void async_connect(const asio::ip::tcp::endpoint& endpoint, connect_handler&& handler) = 0;
+
+    virtual void async_write(const std::vector<asio::const_buffer>& buffers, io_handler&& handler) = 0;
+
+    virtual void async_read_some(asio::mutable_buffer buffer, io_handler&& handler) = 0;
+
+  protected:
+    asio::strand<asio::io_context::executor_type>& strand_;
+    bool tls_;
+    std::atomic_bool open_{ false };
+    std::string server_name_{};
+};
+
+class plain_stream_impl : public stream_impl
+{
+  public:
+    explicit plain_stream_impl(asio::strand<asio::io_context::executor_type>& strand)
+      : stream_impl(strand, false)
+      , socket_(strand_)
+    {
+    }
+
+    void close() override
+    {
+        open_ = false;
+        std::error_code ec{};
+        socket_.close(ec);
+    }
+
+    void set_options() override
+    {
+        socket_.set_option(asio::ip::tcp::no_delay{ true });
+        socket_.set_option(asio::socket_base::keep_alive{ true });
+    }
+
+    void async_connect(const asio::ip::tcp::endpoint& endpoint, connect_handler&& handler) override
+    {
+        if (socket_.is_open()) {
+            // the socket of the failed attempt has to be closed, otherwise it will not be reopened automatically
+            std::error_code ec{};
+            socket_.close(ec);
+        }
+        socket_.async_connect(endpoint, [this, handler = std::move(handler)](std::error_code ec) mutable {
+            open_ = !ec && socket_.is_open();
+            handler(ec);
+        });
+    }
+
+    void async_write(const std::vector<asio::const_buffer>& buffers, io_handler&& handler) override
+    {
+        asio::async_write(socket_, buffers, std::move(handler));
+    }
+
+    void async_read_some(asio::mutable_buffer buffer, io_handler&& handler) override
+    {
+        socket_.async_read_some(buffer, std::move(handler));
+    }
+
+  private:
+    asio::ip::tcp::socket socket_;
+};
+
+class tls_stream_impl : public stream_impl
+{
+  public:
+    tls_stream_impl(asio::strand<asio::io_context::executor_type>& strand, asio::ssl::context& tls)
+      : stream_impl(strand, true)
+      , tls_context_(tls)
+      , stream_(std::make_unique<asio::ssl::stream<asio::ip::tcp::socket>>(asio::ip::tcp::socket(strand_), tls_context_))
+    {
+    }
+
+    void close() override
+    {
+        open_ = false;
+        std::error_code ec{};
+        stream_->lowest_layer().close(ec);
+    }
+
+    void set_options() override
+    {
+        stream_->lowest_layer().set_option(asio::ip::tcp::no_delay{ true });
+        stream_->lowest_layer().set_option(asio::socket_base::keep_alive{ true });
+    }
+
+    void async_connect(const asio::ip::tcp::endpoint& endpoint, connect_handler&& handler) override
+    {
+        // SSL object cannot be reused after failed or closed connection, so every attempt starts with new stream
+        stream_ = std::make_unique<asio::ssl::stream<asio::ip::tcp::socket>>(asio::ip::tcp::socket(strand_), tls_context_);
+        prepare(endpoint);
+        stream_->lowest_layer().async_connect(endpoint, [this, handler = std::move(handler)](std::error_code connect_ec) mutable {
+            if (connect_ec) {
+                return handler(connect_ec);
+            }
+            stream_->async_handshake(asio::ssl::stream_base::client,
+                                     [this, handler = std::move(handler)](std::error_code handshake_ec) mutable {
+                                         if (handshake_ec) {
+                                             tls_session_cache::forget(stream_->native_handle(), session_key_);
+                                         } else {
+                                             open_ = true;
+                                             spdlog::debug("TLS handshake with {} completed, session_reused={}",
+                                                           session_key_,
+                                                           SSL_session_reused(stream_->native_handle()) == 1);
+                                         }
+                                         handler(handshake_ec);
+                                     });
+        });
+    }
+
+    void async_write(const std::vector<asio::const_buffer>& buffers, io_handler&& handler) override
+    {
+        asio::async_write(*stream_, buffers, std::move(handler));
+    }
+
+    void async_read_some(asio::mutable_buffer buffer, io_handler&& handler) override
+    {
+        stream_->async_read_some(buffer, std::move(handler));
+    }
+
+  private:
+    void prepare(const asio::ip::tcp::endpoint& endpoint)
+    {
+        SSL* ssl = stream_->native_handle();
+        std::string host = server_name_.empty() ? endpoint.address().to_string() : server_name_;
+        session_key_ = fmt::format("{}:{}", host, endpoint.port());
+        tls_session_cache::prepare(ssl, &session_key_);
+
+        std::error_code ec{};
+        asio::ip::make_address(host, ec);
+        bool is_address = !ec;
+        if (!is_address) {
+            SSL_ctrl(ssl, SSL_CTRL_SET_TLSEXT_HOSTNAME, TLSEXT_NAMETYPE_host_name, const_cast<char*>(host.c_str()));
+        }
+        if ((SSL_CTX_get_verify_mode(tls_context_.native_handle()) & SSL_VERIFY_PEER) != 0) {
+            if (is_address) {
+                X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), host.c_str());
+            } else {
+                SSL_set1_host(ssl, host.c_str());
+            }
+        }
+    }
+
+    asio::ssl::context& tls_context_;
+    std::unique_ptr<asio::ssl::stream<asio::ip::tcp::socket>> stream_;
+    std::string session_key_{};
+};
+} // namespace couchbase::io
@@ -0,0 +1,321 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <asio.hpp>
+
+#include <errors.hxx>
+#include <utils/movable_function.hxx>
+
+namespace couchbase::io
+{
+/**
+ * Hashed timing wheel for the deadlines and backoffs of the operations.
+ *
+ * Every operation used to arm its own asio timer, so that each of them went through the timer queue of the reactor,
+ * even though almost all deadlines are cancelled when the response arrives. The wheel keeps the timers in slots, indexed
+ * by the expiry tick modulo number of slots, and a single asio timer per shard advances the wheel while there are pending
+ * timers. Scheduling and cancellation are O(1), and the expiry is rounded up to the tick duration.
+ *
+ * The timers are spread over the shards round-robin, so that the threads arming and cancelling timers do not contend on
+ * a single lock. Every shard keeps its entries in a vector, that is reused through the free list, and links the entries
+ * of the same slot into an intrusive list, so that arming the timer does not allocate once the shard has grown.
+ *
+ * Callbacks are invoked on the strand of the shard without holding the lock, so they are allowed to schedule and cancel
+ * timers. Cancelled callbacks are destroyed without being invoked. When the wheel is stopped, the pending callbacks and
+ * the callbacks scheduled after that are invoked with request_canceled, so that the operations waiting for them complete.
+ */
+class timer_wheel : public std::enable_shared_from_this<timer_wheel>
+{
+  public:
+    using clock = std::chrono::steady_clock;
+    using timer_id = std::uint64_t; // zero is never assigned, and can be used as "no timer"
+    using callback = utils::movable_function<void(std::error_code)>;
+
+    static constexpr std::chrono::milliseconds tick_duration{ 5 };
+    static constexpr std::size_t slot_count = 512;
+    static constexpr std::size_t shard_count = 8;
+
+    explicit timer_wheel(asio::io_context& ctx)
+      : start_(clock::now())
+    {
+        for (auto& s : shards_) {
+            s = std::make_unique<shard>(ctx);
+        }
+    }
+
+    /**
+     * @return identifier of the timer, or zero if the wheel has been stopped (the handler is invoked immediately then)
+     */
+    timer_id schedule_after(clock::duration delay, callback&& handler)
+    {
+        auto expiry = clock::now() + delay;
+        auto shard_index = static_cast<std::uint32_t>(next_shard_.fetch_add(1, std::memory_order_relaxed) % shard_count);
+        auto& s = *shards_[shard_index];
+        timer_id id = 0;
+        bool start_ticking = false;
+        {
+            std::scoped_lock lock(s.mutex);
+            if (!s.stopped) {
+                if (!s.ticking) {
+                    // the shard has been idle, so it does not have to replay the ticks, that have passed since then
+                    s.current_tick = std::max(s.current_tick, elapsed_ticks(clock::now()));
+                    s.ticking = start_ticking = true;
+                }
+                auto tick = std::max(elapsed_ticks(expiry) + 1, s.current_tick + 1);
+                auto index = s.allocate();
+                auto& e = s.entries[index];
+                e.tick = tick;
+                e.handler = std::move(handler);
+                s.link(index, static_cast<std::size_t>(tick % slot_count));
+                id = make_id(e.generation, index, shard_index);
+            }
+        }
+        if (id == 0) {
+            handler(std::make_error_code(error::common_errc::request_canceled));
+            return 0;
+        }
+        if (start_ticking) {
+            asio::post(s.strand, [self = shared_from_this(), shard_index]() { self->rearm(shard_index); });
+        }
+        return id;
+    }
+
+    /**
+     * @return true if the timer has been removed before expiry
+     */
+    bool cancel(timer_id id)
+    {
+        if (id == 0) {
+            return false;
+        }
+        auto& s = *shards_[static_cast<std::size_t>(id & 0xff)];
+        auto index = static_cast<std::uint32_t>((id >> 8) & 0xffffff);
+        callback handler{};
+        {
+            std::scoped_lock lock(s.mutex);
+            if (index >= s.entries.size() || s.entries[index].generation != static_cast<std::uint32_t>(id >> 32)) {
+                // the timer has already expired or has been cancelled
+                return false;
+            }
+            handler = std::move(s.entries[index].handler);
+            s.unlink(index, static_cast<std::size_t>(s.entries[index].tick % slot_count));
+            s.release(index);
+        }
+        // the callback might hold the last reference to the operation, so it is destroyed outside of the lock
+        return true;
+    }
+
+    /**
+     * Invokes all pending timers with request_canceled, the wheel does not accept new timers after that.
+     */
+    void stop()
+    {
+        for (std::uint32_t shard_index = 0; shard_index < shard_count; ++shard_index) {
+            auto& s = *shards_[shard_index];
+            std::vector<callback> pending{};
+            {
+                std::scoped_lock lock(s.mutex);
+                s.stopped = true;
+                for (std::size_t slot = 0; slot < slot_count; ++slot) {
+                    s.take_slot(slot, std::numeric_limits<std::uint64_t>::max(), pending);
+                }
+            }
+            asio::post(s.strand, [self = shared_from_this(), shard_index]() { self->shards_[shard_index]->ticker.cancel(); });
+            for (auto& handler : pending) {
+                handler(std::make_error_code(error::common_errc::request_canceled));
+            }
+        }
+    }
+
+  private:
+    static constexpr std::uint32_t npos = 0xffffffff;
+    static constexpr std::uint32_t max_entries = 1U << 24; // the index of the entry takes 24 bits of the timer_id
+
+    struct entry {
+        std::uint64_t tick{ 0 };
+        std::uint32_t generation{ 1 }; // incremented on every release, so that stale identifiers do not match
+        std::uint32_t prev{ npos };
+        std::uint32_t next{ npos }; // next entry in the slot, or in the free list
+        callback handler{};
+    };
+
+    struct shard {
+        explicit shard(asio::io_context& ctx)
+          : strand(asio::make_strand(ctx))
+          , ticker(strand)
+        {
+            heads.fill(npos);
+        }
+
+        std::uint32_t allocate()
+        {
+            std::uint32_t index = free_head;
+            if (index != npos) {
+                free_head = entries[index].next;
+            } else {
+                if (entries.size() >= max_entries) {
+                    throw std::length_error("too many pending timers");
+                }
+                index = static_cast<std::uint32_t>(entries.size());
+                entries.emplace_back();
+            }
+            ++pending;
+            return index;
+        }
+
+        void release(std::uint32_t index)
+        {
+            auto& e = entries[index];
+            if (++e.generation == 0) {
+                e.generation = 1;
+            }
+            e.next = free_head;
+            free_head = index;
+            --pending;
+        }
+
+        void link(std::uint32_t index, std::size_t slot)
+        {
+            auto& e = entries[index];
+            e.prev = npos;
+            e.next = heads[slot];
+            if (e.next != npos) {
+                entries[e.next].prev = index;
+            }
+            heads[slot] = index;
+        }
+
+        void unlink(std::uint32_t index, std::size_t slot)
+        {
+            auto& e = entries[index];
+            if (e.prev != npos) {
+                entries[e.prev].next = e.next;
+            } else {
+                heads[slot] = e.next;
+            }
+            if (e.next != npos) {
+                entries[e.next].prev = e.prev;
+            }
+        }
+
+        /**
+         * Moves out the handlers of the slot, that expire not later than the tick.
+         */
+        void take_slot(std::size_t slot, std::uint64_t tick, std::vector<callback>& expired)
+        {
+            for (auto index = heads[slot]; index != npos;) {
+                auto next = entries[index].next;
+                if (entries[index].tick <= tick) {
+                    expired.emplace_back(std::move(entries[index].handler));
+                    unlink(index, slot);
+                    release(index);
+                }
+                index = next;
+            }
+        }
+
+        asio::strand<asio::io_context::executor_type> strand;
+        asio::steady_timer ticker; // accessed only on the strand
+
+        std::mutex mutex{}; // protects all fields below
+        bool stopped{ false };
+        bool ticking{ false };
+        std::uint64_t current_tick{ 0 };
+        std::size_t pending{ 0 };
+        std::vector<entry> entries{};
+        std::uint32_t free_head{ npos };
+        std::array<std::uint32_t, slot_count> heads{};
+    };
+
+    static timer_id make_id(std::uint32_t generation, std::uint32_t index, std::uint32_t shard_index)
+    {
+        return (static_cast<timer_id>(generation) << 32) | (static_cast<timer_id>(index) << 8) | shard_index;
+    }
+
+    [[nodiscard]] std::uint64_t elapsed_ticks(clock::time_point time) const
+    {
+        if (time <= start_) {
+            return 0;
+        }
+        return static_cast<std::uint64_t>((time - start_) / tick_duration);
+    }
+
+    void rearm(std::uint32_t shard_index)
+    {
+        auto& s = *shards_[shard_index];
+        clock::time_point next_tick{};
+        {
+            std::scoped_lock lock(s.mutex);
+            if (s.stopped) {
+                return;
+            }
+            next_tick = start_ + tick_duration * (s.current_tick + 1);
+        }
+        s.ticker.expires_at(next_tick);
+        s.ticker.async_wait([self = shared_from_this(), shard_index](std::error_code ec) {
+            if (ec == asio::error::operation_aborted) {
+                return;
+            }
+            self->on_tick(shard_index);
+        });
+    }
+
+    void on_tick(std::uint32_t shard_index)
+    {
+        auto& s = *shards_[shard_index];
+        std::vector<callback> expired{};
+        bool has_pending = false;
+        {
+            std::scoped_lock lock(s.mutex);
+            if (s.stopped) {
+                return;
+            }
+            auto now_tick = elapsed_ticks(clock::now());
+            while (s.current_tick < now_tick) {
+                ++s.current_tick;
+                s.take_slot(static_cast<std::size_t>(s.current_tick % slot_count), s.current_tick, expired);
+            }
+            has_pending = s.pending > 0;
+            s.ticking = has_pending;
+        }
+        for (auto& handler : expired) {
+            handler({});
+        }
+        if (has_pending) {
+            rearm(shard_index);
+        }
+    }
+
+    const clock::time_point start_;
+    std::atomic<std::uint32_t> next_shard_{ 0 };
+    std::array<std::unique_ptr<shard>, shard_count> shards_{};
+};
+} // namespace couchbase::io
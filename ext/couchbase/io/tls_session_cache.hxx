@@ -0,0 +1,131 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <openssl/ssl.h>
+
+namespace couchbase::io
+{
+/**
+ * Client-side cache of TLS sessions, keyed by "host:port" of the server.
+ *
+ * The cache is attached to SSL context, and every connection, that has been created from this context, offers the last
+ * session received from the same server. When the server accepts it, the connection is established with abbreviated
+ * handshake, so that reconnecting the many KV and HTTP sessions of the cluster does not pay for full handshake each.
+ *
+ * The sessions are recorded by the new session callback of OpenSSL, because with TLS 1.3 the tickets arrive after the
+ * handshake has been completed.
+ */
+class tls_session_cache
+{
+  public:
+    tls_session_cache() = default;
+    tls_session_cache(const tls_session_cache&) = delete;
+    tls_session_cache& operator=(const tls_session_cache&) = delete;
+
+    ~tls_session_cache()
+    {
+        for (auto& [key, session] : sessions_) {
+            SSL_SESSION_free(session);
+        }
+    }
+
+    /**
+     * Makes the cache receive sessions of all connections created from the context.
+     */
+    void attach(SSL_CTX* ctx)
+    {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_set_ex_data(ctx, context_index(), this);
+        SSL_CTX_sess_set_new_cb(ctx, &tls_session_cache::on_new_session);
+    }
+
+    /**
+     * Associates the connection with the server key, and offers cached session (if any) for resumption.
+     *
+     * @param key must outlive the connection
+     */
+    static void prepare(SSL* ssl, const std::string* key)
+    {
+        SSL_set_ex_data(ssl, connection_index(), const_cast<std::string*>(key));
+        auto* cache = static_cast<tls_session_cache*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+        if (cache == nullptr) {
+            return;
+        }
+        std::scoped_lock lock(cache->mutex_);
+        if (auto it = cache->sessions_.find(*key); it != cache->sessions_.end()) {
+            SSL_set_session(ssl, it->second);
+        }
+    }
+
+    /**
+     * Drops the session of the server, for example when the handshake with it has failed.
+     */
+    static void forget(SSL* ssl, const std::string& key)
+    {
+        auto* cache = static_cast<tls_session_cache*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+        if (cache == nullptr) {
+            return;
+        }
+        std::scoped_lock lock(cache->mutex_);
+        if (auto it = cache->sessions_.find(key); it != cache->sessions_.end()) {
+            SSL_SESSION_free(it->second);
+            cache->sessions_.erase(it);
+        }
+    }
+
+  private:
+    static int context_index()
+    {
+        static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+
+    static int connection_index()
+    {
+        static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+
+    /**
+     * @return 1 when the cache took ownership of the session
+     */
+    static int on_new_session(SSL* ssl, SSL_SESSION* session)
+    {
+        auto* cache = static_cast<tls_session_cache*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+        const auto* key = static_cast<const std::string*>(SSL_get_ex_data(ssl, connection_index()));
+        if (cache == nullptr || key == nullptr) {
+            return 0;
+        }
+        std::scoped_lock lock(cache->mutex_);
+        auto& slot = cache->sessions_[*key];
+        if (slot != nullptr) {
+            SSL_SESSION_free(slot);
+        }
+        slot = session;
+        return 1;
+    }
+
+    std::mutex mutex_{};
+    std::map<std::string, SSL_SESSION*> sessions_{};
+};
+} // namespace couchbase::io
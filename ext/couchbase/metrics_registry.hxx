@@ -0,0 +1,156 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <protocol/client_opcode.hxx>
+#include <service_type.hxx>
+#include <utils/latency_histogram.hxx>
+
+namespace couchbase
+{
+/**
+ * Latencies and counters of the operations sent to a single node.
+ *
+ * The histograms are allocated when the opcode or the service is used for the first time, after that recording does not
+ * take any locks.
+ */
+class node_metrics
+{
+  public:
+    struct snapshot {
+        std::map<std::string, utils::latency_histogram::snapshot> key_value{}; // keyed by opcode name
+        std::map<std::string, utils::latency_histogram::snapshot> http{};      // keyed by service name
+        std::uint64_t bytes_in{ 0 };
+        std::uint64_t bytes_out{ 0 };
+        std::uint64_t retries{ 0 };
+        std::uint64_t timeouts{ 0 };
+        std::uint64_t not_my_vbucket{ 0 };
+        std::uint64_t connects{ 0 };
+    };
+
+    std::atomic<std::uint64_t> bytes_in{ 0 };
+    std::atomic<std::uint64_t> bytes_out{ 0 };
+    std::atomic<std::uint64_t> retries{ 0 };
+    std::atomic<std::uint64_t> timeouts{ 0 };
+    std::atomic<std::uint64_t> not_my_vbucket{ 0 };
+    std::atomic<std::uint64_t> connects{ 0 }; // the session does not reconnect, so every new connection is counted here
+
+    utils::latency_histogram& key_value(protocol::client_opcode opcode)
+    {
+        return histogram(key_value_[static_cast<std::uint8_t>(opcode)]);
+    }
+
+    utils::latency_histogram& http(service_type type)
+    {
+        return histogram(http_[static_cast<std::size_t>(type)]);
+    }
+
+    snapshot take_snapshot(bool reset)
+    {
+        snapshot res{};
+        for (std::size_t i = 0; i < key_value_.size(); ++i) {
+            if (auto* hist = key_value_[i].load(std::memory_order_acquire); hist != nullptr && hist->count() > 0) {
+                res.key_value[fmt::format("{}", static_cast<protocol::client_opcode>(i))] = hist->take_snapshot(reset);
+            }
+        }
+        for (std::size_t i = 0; i < http_.size(); ++i) {
+            if (auto* hist = http_[i].load(std::memory_order_acquire); hist != nullptr && hist->count() > 0) {
+                res.http[fmt::format("{}", static_cast<service_type>(i))] = hist->take_snapshot(reset);
+            }
+        }
+        res.bytes_in = read_counter(bytes_in, reset);
+        res.bytes_out = read_counter(bytes_out, reset);
+        res.retries = read_counter(retries, reset);
+        res.timeouts = read_counter(timeouts, reset);
+        res.not_my_vbucket = read_counter(not_my_vbucket, reset);
+        res.connects = read_counter(connects, reset);
+        return res;
+    }
+
+  private:
+    static std::uint64_t read_counter(std::atomic<std::uint64_t>& counter, bool reset)
+    {
+        return reset ? counter.exchange(0, std::memory_order_relaxed) : counter.load(std::memory_order_relaxed);
+    }
+
+    utils::latency_histogram& histogram(std::atomic<utils::latency_histogram*>& slot)
+    {
+        if (auto* hist = slot.load(std::memory_order_acquire); hist != nullptr) {
+            return *hist;
+        }
+        std::scoped_lock lock(histograms_mutex_);
+        if (auto* hist = slot.load(std::memory_order_acquire); hist != nullptr) {
+            return *hist;
+        }
+        auto* hist = histograms_.emplace_back(std::make_unique<utils::latency_histogram>()).get();
+        slot.store(hist, std::memory_order_release);
+        return *hist;
+    }
+
+    std::array<std::atomic<utils::latency_histogram*>, 256> key_value_{};
+    std::array<std::atomic<utils::latency_histogram*>, 6> http_{}; // indexed by service_type
+    std::mutex histograms_mutex_{};
+    std::vector<std::unique_ptr<utils::latency_histogram>> histograms_{};
+};
+
+/**
+ * Metrics of the cluster, grouped by the address of the node ("host:port").
+ */
+class metrics_registry
+{
+  public:
+    std::shared_ptr<node_metrics> node(const std::string& address)
+    {
+        std::scoped_lock lock(nodes_mutex_);
+        auto& entry = nodes_[address];
+        if (!entry) {
+            entry = std::make_shared<node_metrics>();
+        }
+        return entry;
+    }
+
+    std::map<std::string, node_metrics::snapshot> take_snapshot(bool reset)
+    {
+        std::map<std::string, std::shared_ptr<node_metrics>> nodes{};
+        {
+            std::scoped_lock lock(nodes_mutex_);
+            nodes = nodes_;
+        }
+        std::map<std::string, node_metrics::snapshot> res{};
+        for (const auto& [address, metrics] : nodes) {
+            res.emplace(address, metrics->take_snapshot(reset));
+        }
+        return res;
+    }
+
+  private:
+    std::mutex nodes_mutex_{};
+    std::map<std::string, std::shared_ptr<node_metrics>> nodes_{};
+};
+} // namespace couchbase
@@ -0,0 +1,41 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+namespace couchbase
+{
+/**
+ * Timestamps of the stages of the KV operation. When the operation has been retried, the stages after "queued" describe
+ * the last attempt. The stages, that have not been reached, are left at the epoch of the clock.
+ */
+struct operation_timings {
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point queued{};   // the command has been created by the bucket
+    clock::time_point encoded{};  // the request has been encoded and handed to the session
+    clock::time_point written{};  // the frame has been written to the socket
+    clock::time_point received{}; // the response has been read from the socket
+    clock::time_point decoded{};  // the response has been decoded and is about to be passed to the caller
+
+    // time spent by the data service, reported in the framing extras when the tracing feature is negotiated
+    std::optional<std::chrono::microseconds> server_duration{};
+};
+} // namespace couchbase
@@ -35,6 +35,7 @@
 #include <operations/document_increment.hxx>
 #include <operations/document_decrement.hxx>
 #include <operations/document_get_projected.hxx>
+#include <operations/document_get_replica.hxx>
 
 #include <operations/document_query.hxx>
 #include <operations/document_search.hxx>
@@ -167,6 +167,12 @@ struct analytics_request {
     std::vector<tao::json::value> positional_parameters{};
     std::map<std::string, tao::json::value> named_parameters{};
 
+    /**
+     * When set, receives raw JSON of every row as soon as it arrives, and the rows of the response payload stay empty.
+     */
+    std::function<void(std::string&&)> row_callback{};
+    std::shared_ptr<io::http_streaming_control> streaming_control{}; // lets the consumer pause and cancel the stream of rows
+
     void encode_to(encoded_request_type& encoded)
     {
         tao::json::value body{ { "statement", statement },
@@ -211,6 +217,9 @@ struct analytics_request {
         encoded.method = "POST";
         encoded.path = "/query/service";
         encoded.body = tao::json::to_string(body);
+        if (row_callback) {
+            encoded.streaming.emplace(io::http_streaming{ "results", row_callback, streaming_control });
+        }
     }
 };
 
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_decrement.hxx>
 
 namespace couchbase::operations
@@ -30,6 +31,7 @@ struct decrement_response {
     std::uint64_t content{};
     std::uint64_t cas{};
     mutation_token token{};
+    operation_timings timings{};
 };
 
 struct decrement_request {
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_exists.hxx>
 
 namespace couchbase::operations
@@ -32,6 +33,7 @@ struct exists_response {
     std::uint16_t partition_id{};
     std::uint64_t cas{};
     observe_status status{ observe_status::invalid };
+    operation_timings timings{};
 };
 
 struct exists_request {
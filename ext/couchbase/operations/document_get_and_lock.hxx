@@ -18,6 +18,7 @@
 #pragma once
 
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_get_and_lock.hxx>
 
 namespace couchbase::operations
@@ -30,6 +31,7 @@ struct get_and_lock_response {
     std::string value{};
     std::uint64_t cas{};
     std::uint32_t flags{};
+    operation_timings timings{};
 };
 
 struct get_and_lock_request {
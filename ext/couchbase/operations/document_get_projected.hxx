@@ -18,6 +18,7 @@
 #pragma once
 
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_lookup_in.hxx>
 
 namespace couchbase::operations
@@ -31,6 +32,7 @@ struct get_projected_response {
     std::uint64_t cas{};
     std::uint32_t flags{};
     std::optional<std::uint32_t> expiration{};
+    operation_timings timings{};
 };
 
 struct get_projected_request {
@@ -20,6 +20,7 @@
 #include <protocol/cmd_increment.hxx>
 #include <protocol/durability_level.hxx>
 #include <operations.hxx>
+#include <operation_timings.hxx>
 #include <protocol/client_response.hxx>
 
 namespace couchbase::operations
@@ -32,6 +33,7 @@ struct increment_response {
     std::uint64_t content{};
     std::uint64_t cas{};
     mutation_token token{};
+    operation_timings timings{};
 };
 
 struct increment_request {
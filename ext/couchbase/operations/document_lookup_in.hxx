@@ -19,6 +19,7 @@
 
 #include <gsl/gsl_assert>
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_lookup_in.hxx>
 
 namespace couchbase::operations
@@ -38,6 +39,7 @@ struct lookup_in_response {
     std::error_code ec{};
     std::uint64_t cas{};
     std::vector<field> fields{};
+    operation_timings timings{};
 };
 
 struct lookup_in_request {
@@ -27,6 +27,7 @@
 
 #include <mutation_token.hxx>
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <timeout_defaults.hxx>
 #include <errors.hxx>
 
@@ -48,6 +49,7 @@ struct mutate_in_response {
     mutation_token token{};
     std::vector<field> fields{};
     std::optional<std::size_t> first_error_index{};
+    operation_timings timings{};
 };
 
 struct mutate_in_request {
@@ -30,6 +30,7 @@
 #include <service_type.hxx>
 #include <platform/uuid.h>
 #include <timeout_defaults.hxx>
+#include <query_cache.hxx>
 #include <io/http_message.hxx>
 
 namespace couchbase::operations
@@ -180,11 +181,28 @@ struct query_request {
     std::vector<tao::json::value> positional_parameters{};
     std::map<std::string, tao::json::value> named_parameters{};
 
+    /**
+     * When set, receives raw JSON of every row as soon as it arrives, and the rows of the response payload stay empty.
+     */
+    std::function<void(std::string&&)> row_callback{};
+    std::shared_ptr<io::http_streaming_control> streaming_control{}; // lets the consumer pause and cancel the stream of rows
+
+    /**
+     * Prepared statement, that is executed instead of the statement text. The cluster looks it up for non-adhoc queries.
+     */
+    std::optional<query_cache::entry> prepared{};
+
     void encode_to(encoded_request_type& encoded)
     {
-        tao::json::value body{ { "statement", statement },
-                               { "client_context_id", client_context_id },
-                               { "timeout", fmt::format("{}ms", timeout.count()) } };
+        tao::json::value body{ { "client_context_id", client_context_id }, { "timeout", fmt::format("{}ms", timeout.count()) } };
+        if (prepared) {
+            body["prepared"] = prepared->name;
+            if (prepared->encoded_plan) {
+                body["encoded_plan"] = *prepared->encoded_plan;
+            }
+        } else {
+            body["statement"] = statement;
+        }
         if (positional_parameters.empty()) {
             for (auto& param : named_parameters) {
                 Expects(param.first.empty() == false);
@@ -263,6 +281,9 @@ struct query_request {
         encoded.method = "POST";
         encoded.path = "/query/service";
         encoded.body = tao::json::to_string(body);
+        if (row_callback) {
+            encoded.streaming.emplace(io::http_streaming{ "results", row_callback, streaming_control });
+        }
     }
 };
 
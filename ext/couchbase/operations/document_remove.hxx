@@ -18,6 +18,7 @@
 #pragma once
 
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_remove.hxx>
 
 namespace couchbase::operations
@@ -29,6 +30,7 @@ struct remove_response {
     std::error_code ec{};
     std::uint64_t cas{};
     mutation_token token{};
+    operation_timings timings{};
 };
 
 struct remove_request {
@@ -38,6 +40,7 @@ struct remove_request {
     document_id id;
     uint16_t partition{};
     uint32_t opaque{};
+    uint64_t cas{ 0 };
     protocol::durability_level durability_level{ protocol::durability_level::none };
     std::optional<std::uint16_t> durability_timeout{};
     std::chrono::milliseconds timeout{ timeout_defaults::key_value_timeout };
@@ -46,6 +49,7 @@ struct remove_request {
     {
         encoded.opaque(opaque);
         encoded.partition(partition);
+        encoded.cas(cas);
         encoded.body().id(id);
         if (durability_level != protocol::durability_level::none) {
             encoded.body().durability(durability_level, durability_timeout);
@@ -38,20 +38,11 @@ struct search_response {
         std::map<std::string, std::string> errors;
     };
 
-    struct search_location {
-        std::string field;
-        std::string term;
-        std::uint64_t position;
-        std::uint64_t start_offset;
-        std::uint64_t end_offset;
-        std::optional<std::vector<std::uint64_t>> array_positions{};
-    };
-
     struct search_row {
         std::string index;
         std::string id;
         double score;
-        std::vector<search_location> locations{};
+        std::string locations{}; // raw JSON, decoded only when the application asks for locations
         std::map<std::string, std::vector<std::string>> fragments{};
         std::string fields{};
         std::string explanation{};
@@ -127,6 +118,12 @@ struct search_request {
 
     std::map<std::string, tao::json::value> raw{};
 
+    /**
+     * When set, receives raw JSON of every hit as soon as it arrives, and the rows of the response stay empty.
+     */
+    std::function<void(std::string&&)> row_callback{};
+    std::shared_ptr<io::http_streaming_control> streaming_control{}; // lets the consumer pause and cancel the stream of rows
+
     void encode_to(encoded_request_type& encoded)
     {
         tao::json::value body{
@@ -192,9 +189,40 @@ struct search_request {
         encoded.method = "POST";
         encoded.path = fmt::format("/api/index/{}/query", index_name);
         encoded.body = tao::json::to_string(body);
+        if (row_callback) {
+            encoded.streaming.emplace(io::http_streaming{ "hits", row_callback, streaming_control });
+        }
     }
 };
 
+search_response::search_row
+make_search_row(const tao::json::value& entry)
+{
+    search_response::search_row row{};
+    row.index = entry.at("index").get_string();
+    row.id = entry.at("id").get_string();
+    row.score = entry.at("score").get_double();
+    const auto* locations = entry.find("locations");
+    if (locations != nullptr && locations->is_object()) {
+        row.locations = tao::json::to_string(*locations);
+    }
+    const auto* fragments_map = entry.find("fragments");
+    if (fragments_map != nullptr && fragments_map->is_object()) {
+        for (const auto& field : fragments_map->get_object()) {
+            row.fragments.emplace(field.first, field.second.as<std::vector<std::string>>());
+        }
+    }
+    const auto* fields = entry.find("fields");
+    if (fields != nullptr && fields->is_object()) {
+        row.fields = tao::json::to_string(*fields);
+    }
+    const auto* explanation = entry.find("explanation");
+    if (explanation != nullptr && explanation->is_object()) {
+        row.explanation = tao::json::to_string(*explanation);
+    }
+    return row;
+}
+
 search_response
 make_response(std::error_code ec, search_request& request, search_request::encoded_response_type encoded)
 {
@@ -227,46 +255,9 @@ make_response(std::error_code ec, search_request& request, search_request::encod
             }
             const auto* rows = payload.find("hits");
             if (rows != nullptr && rows->is_array()) {
+                response.rows.reserve(rows->get_array().size());
                 for (const auto& entry : rows->get_array()) {
-                    search_response::search_row row{};
-                    row.index = entry.at("index").get_string();
-                    row.id = entry.at("id").get_string();
-                    row.score = entry.at("score").get_double();
-                    const auto* locations = entry.find("locations");
-                    if (locations != nullptr && locations->is_object()) {
-                        for (const auto& field : locations->get_object()) {
-                            for (const auto& term : field.second.get_object()) {
-                                for (const auto& loc : term.second.get_array()) {
-                                    search_response::search_location location{};
-                                    location.field = field.first;
-                                    location.term = term.first;
-                                    location.position = loc.at("pos").get_unsigned();
-                                    location.start_offset = loc.at("start").get_unsigned();
-                                    location.end_offset = loc.at("end").get_unsigned();
-                                    const auto* ap = loc.find("array_positions");
-                                    if (ap != nullptr && ap->is_array()) {
-                                        location.array_positions.emplace(ap->as<std::vector<std::uint64_t>>());
-                                    }
-                                    row.locations.emplace_back(location);
-                                }
-                            }
-                        }
-                    }
-                    const auto* fragments_map = entry.find("fragments");
-                    if (fragments_map != nullptr && fragments_map->is_object()) {
-                        for (const auto& field : fragments_map->get_object()) {
-                            row.fragments.emplace(field.first, field.second.as<std::vector<std::string>>());
-                        }
-                    }
-                    const auto* fields = entry.find("fields");
-                    if (fields != nullptr && fields->is_object()) {
-                        row.fields = tao::json::to_string(*fields);
-                    }
-                    const auto* explanation = entry.find("explanation");
-                    if (explanation != nullptr && explanation->is_object()) {
-                        row.explanation = tao::json::to_string(*explanation);
-                    }
-                    response.rows.emplace_back(row);
+                    response.rows.emplace_back(make_search_row(entry));
                 }
             }
             const auto* facets = payload.find("facets");
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_touch.hxx>
 
 namespace couchbase::operations
@@ -28,6 +29,7 @@ struct touch_response {
     std::uint32_t opaque;
     std::error_code ec{};
     std::uint64_t cas{};
+    operation_timings timings{};
 };
 
 struct touch_request {
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_unlock.hxx>
 
 namespace couchbase::operations
@@ -28,6 +29,7 @@ struct unlock_response {
     std::uint32_t opaque;
     std::error_code ec{};
     std::uint64_t cas{};
+    operation_timings timings{};
 };
 
 struct unlock_request {
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <document_id.hxx>
+#include <operation_timings.hxx>
 #include <protocol/cmd_upsert.hxx>
 #include <protocol/durability_level.hxx>
 
@@ -30,6 +31,7 @@ struct upsert_response {
     std::error_code ec{};
     std::uint64_t cas{};
     mutation_token token{};
+    operation_timings timings{};
 };
 
 struct upsert_request {
@@ -36,6 +36,7 @@ struct origin {
       , nodes_(other.nodes_)
       , next_node_(nodes_.begin())
       ,exhausted_{false}
+      , options_(other.options_)
     {
     }
 
@@ -55,6 +56,7 @@ struct origin {
         nodes_ = other.nodes_;
         next_node_ = nodes_.begin();
         exhausted_ = false;
+        options_ = other.options_;
         return *this;
     }
 
@@ -70,6 +72,7 @@ struct origin {
     origin(std::string username, std::string password, const utils::connection_string& connstr)
       : username_(std::move(username))
       , password_(std::move(password))
+      , options_(connstr.options)
     {
         nodes_.reserve(connstr.bootstrap_nodes.size());
         for (const auto& node : connstr.bootstrap_nodes) {
@@ -94,6 +97,16 @@ struct origin {
         return nodes_;
     }
 
+    [[nodiscard]] const cluster_options& options() const
+    {
+        return options_;
+    }
+
+    void options(const cluster_options& options)
+    {
+        options_ = options;
+    }
+
     [[nodiscard]] std::pair<std::string, std::string> next_address()
     {
         if (exhausted_) {
@@ -124,6 +137,7 @@ struct origin {
     node_list nodes_{};
     node_list::iterator next_node_{};
     bool exhausted_{ false };
+    cluster_options options_{};
 };
 
 } // namespace couchbase
@@ -0,0 +1,171 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <asio.hpp>
+#include <spdlog/spdlog.h>
+#include <tao/json.hpp>
+
+#include <cluster_options.hxx>
+
+namespace couchbase
+{
+/**
+ * Collects the KV responses, that arrived after their operations had been cancelled (usually by the deadline), and
+ * periodically logs a sample of them as a single JSON report.
+ *
+ * Orphans show that the timeouts are too tight for the cluster, or that the node is stalling, so the responses, that were
+ * late the most, are preferred in the sample.
+ */
+class orphan_reporter : public std::enable_shared_from_this<orphan_reporter>
+{
+  public:
+    struct orphan {
+        std::string operation_name;
+        std::uint32_t opaque;
+        std::string remote_socket;
+        std::optional<std::chrono::microseconds> server_duration{};
+        std::optional<std::chrono::microseconds> late_by{}; // time between cancellation and the response, if known
+    };
+
+    orphan_reporter(asio::io_context& ctx, const cluster_options& options)
+      : strand_(asio::make_strand(ctx))
+      , emit_timer_(strand_)
+      , emit_interval_(options.tracing_orphaned_emit_interval)
+      , sample_size_(options.tracing_orphaned_sample_size)
+    {
+    }
+
+    void start()
+    {
+        asio::post(strand_, [self = shared_from_this()]() { self->rearm(); });
+    }
+
+    void stop()
+    {
+        stopped_ = true;
+        // the timer is not thread-safe, and its handler might be rearming it on another IO thread
+        asio::post(strand_, [self = shared_from_this()]() { self->emit_timer_.cancel(); });
+        emit_report();
+    }
+
+    void report(orphan&& response)
+    {
+        std::scoped_lock lock(samples_mutex_);
+        ++total_count_;
+        if (samples_.size() < sample_size_) {
+            samples_.emplace(std::move(response));
+        } else if (later_first{}(response, samples_.top())) {
+            samples_.pop();
+            samples_.emplace(std::move(response));
+        }
+    }
+
+  private:
+    struct later_first {
+        bool operator()(const orphan& lhs, const orphan& rhs) const
+        {
+            return lhs.late_by.value_or(std::chrono::microseconds::zero()) > rhs.late_by.value_or(std::chrono::microseconds::zero());
+        }
+    };
+
+    /**
+     * Must be invoked on the strand.
+     */
+    void rearm()
+    {
+        if (stopped_) {
+            return;
+        }
+        emit_timer_.expires_after(emit_interval_);
+        emit_timer_.async_wait([self = shared_from_this()](std::error_code ec) {
+            if (ec == asio::error::operation_aborted) {
+                return;
+            }
+            self->emit_report();
+            self->rearm();
+        });
+    }
+
+    static tao::json::value to_json(const orphan& response)
+    {
+        tao::json::value entry{
+            { "operation_name", response.operation_name },
+            { "operation_id", fmt::format("0x{:x}", response.opaque) },
+            { "last_remote_socket", response.remote_socket },
+        };
+        if (response.server_duration) {
+            entry["server_duration_us"] = response.server_duration->count();
+        }
+        if (response.late_by) {
+            entry["late_by_us"] = response.late_by->count();
+        }
+        return entry;
+    }
+
+    void emit_report()
+    {
+        std::size_t total_count = 0;
+        std::priority_queue<orphan, std::vector<orphan>, later_first> samples{};
+        {
+            std::scoped_lock lock(samples_mutex_);
+            std::swap(total_count, total_count_);
+            std::swap(samples, samples_);
+        }
+        if (total_count == 0) {
+            return;
+        }
+        std::vector<tao::json::value> top_requests{};
+        top_requests.reserve(samples.size());
+        while (!samples.empty()) {
+            top_requests.emplace_back(to_json(samples.top()));
+            samples.pop();
+        }
+        std::reverse(top_requests.begin(), top_requests.end());
+        tao::json::value report{
+            { "kv",
+              tao::json::value{
+                { "total_count", total_count },
+                { "top_requests", top_requests },
+              } },
+        };
+        spdlog::warn("Orphaned responses observed: {}", tao::json::to_string(report));
+    }
+
+    asio::strand<asio::io_context::executor_type> strand_;
+    asio::steady_timer emit_timer_; // accessed only on the strand
+    std::chrono::milliseconds emit_interval_;
+    std::size_t sample_size_;
+    std::atomic_bool stopped_{ false };
+    std::mutex samples_mutex_{};
+    std::size_t total_count_{ 0 };
+    // the least late of the kept responses is on the top, so that it can be replaced by the later one
+    std::priority_queue<orphan, std::vector<orphan>, later_first> samples_{};
+};
+} // namespace couchbase
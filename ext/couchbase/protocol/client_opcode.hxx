@@ -35,6 +35,7 @@ enum class client_opcode : uint8_t {
     sasl_list_mechs = 0x20,
     sasl_auth = 0x21,
     sasl_step = 0x22,
+    get_replica = 0x83,
     select_bucket = 0x89,
     observe = 0x92,
     get_and_lock = 0x94,
@@ -96,6 +97,7 @@ is_valid_client_opcode(uint8_t code)
         case client_opcode::increment:
         case client_opcode::decrement:
         case client_opcode::get_collection_id:
+        case client_opcode::get_replica:
             return true;
     }
     return false;
@@ -204,6 +206,9 @@ struct fmt::formatter<couchbase::protocol::client_opcode> : formatter<string_vie
             case couchbase::protocol::client_opcode::get_collection_id:
                 name = "get_collection_uid";
                 break;
+            case couchbase::protocol::client_opcode::get_replica:
+                name = "get_replica";
+                break;
         }
         return formatter<string_view>::format(name, ctx);
     }
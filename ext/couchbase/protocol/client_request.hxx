@@ -21,6 +21,8 @@
 #include <arpa/inet.h>
 #endif
 
+#include <string_view>
+
 #include <snappy.h>
 
 #include <gsl/gsl_util>
@@ -47,6 +49,7 @@ class client_request
     std::uint64_t cas_{ 0 };
     Body body_;
     std::vector<std::uint8_t> payload_;
+    std::string_view detached_value_{};
 
   public:
     client_opcode opcode()
@@ -84,25 +87,65 @@ class client_request
         return body_;
     }
 
+    /**
+     * Replaces the buffer of the payload, so that the next call of data() or data_with_detached_value() does not allocate
+     * if the buffer has enough capacity.
+     */
+    void reuse_buffer(std::vector<std::uint8_t>&& buffer)
+    {
+        payload_ = std::move(buffer);
+        payload_.clear();
+    }
+
     std::vector<std::uint8_t>& data(bool try_to_compress = false)
+    {
+        write_payload(is_mutation() && try_to_compress, false);
+        return payload_;
+    }
+
+    /**
+     * Encodes the request like data() does, but large values are not copied into the payload. In this case the payload
+     * holds only header, framing extras, extras and key, and the value returned by detached_value() has to be written to
+     * the socket right after it.
+     */
+    std::vector<std::uint8_t>& data_with_detached_value(bool try_to_compress = false)
+    {
+        write_payload(is_mutation() && try_to_compress, true);
+        return payload_;
+    }
+
+    /**
+     * @return the value, that has not been copied into the payload by data_with_detached_value(), or empty view
+     */
+    [[nodiscard]] std::string_view detached_value() const
+    {
+        return detached_value_;
+    }
+
+  private:
+    bool is_mutation() const
     {
         switch (opcode_) {
             case protocol::client_opcode::insert:
             case protocol::client_opcode::upsert:
             case protocol::client_opcode::replace:
-                write_payload(try_to_compress);
-                break;
+                return true;
             default:
-                write_payload(false);
-                break;
+                return false;
         }
-        return payload_;
     }
 
-  private:
-    void write_payload(bool try_to_compress)
+    void write_payload(bool try_to_compress, bool detach_value)
     {
-        payload_.resize(header_size + body_.size(), 0);
+        const auto& value = body_.value();
+        const auto* value_data = reinterpret_cast<const char*>(value.data());
+        std::size_t value_size = value.size();
+        detached_value_ = {};
+
+        static const std::size_t min_size_to_detach = 4096;
+        bool value_detached = detach_value && value_size >= min_size_to_detach;
+        std::size_t body_size_without_value = body_.size() - value_size;
+        payload_.resize(header_size + body_size_without_value + (value_detached ? 0 : value_size), 0);
         payload_[0] = static_cast<uint8_t>(magic_);
         payload_[1] = static_cast<uint8_t>(opcode_);
 
@@ -140,21 +183,27 @@ class client_request
 
         static const std::size_t min_size_to_compress = 32;
         static const double min_ratio = 0.83;
-        if (try_to_compress && body_.value().size() > min_size_to_compress) {
-            std::string compressed;
-            std::size_t compressed_size =
-              snappy::Compress(reinterpret_cast<const char*>(body_.value().data()), body_.value().size(), &compressed);
-            if (gsl::narrow_cast<double>(compressed_size) / gsl::narrow_cast<double>(body().value().size()) < min_ratio) {
-                std::copy(compressed.begin(), compressed.end(), body_itr);
+        if (try_to_compress && value_size > min_size_to_compress) {
+            std::size_t offset = header_size + body_size_without_value;
+            payload_.resize(offset + snappy::MaxCompressedLength(value_size));
+            std::size_t compressed_size = 0;
+            snappy::RawCompress(value_data, value_size, reinterpret_cast<char*>(payload_.data() + offset), &compressed_size);
+            if (gsl::narrow_cast<double>(compressed_size) / gsl::narrow_cast<double>(value_size) < min_ratio) {
                 payload_[5] |= static_cast<uint8_t>(protocol::datatype::snappy);
-                size_t new_body_size = body_.size() - (body_.value().size() - compressed_size);
+                size_t new_body_size = body_size_without_value + compressed_size;
                 body_size = htonl(gsl::narrow_cast<uint32_t>(new_body_size));
                 memcpy(payload_.data() + 8, &body_size, sizeof(body_size));
                 payload_.resize(header_size + new_body_size);
                 return;
             }
+            payload_.resize(offset + (value_detached ? 0 : value_size));
+            body_itr = payload_.begin() + static_cast<std::ptrdiff_t>(offset);
+        }
+        if (value_detached) {
+            detached_value_ = std::string_view(value_data, value_size);
+            return;
         }
-        std::copy(body_.value().begin(), body_.value().end(), body_itr);
+        std::copy(value_data, value_data + value_size, body_itr);
     }
 };
 } // namespace couchbase::protocol
@@ -36,6 +36,33 @@ struct enhanced_error {
     std::string ref;
 };
 
+/**
+ * Decodes the time spent by the server on the operation from the framing extras of the response
+ *
+ * @return duration in microseconds, or zero if the server did not report it
+ */
+inline double
+parse_server_duration_us(const std::uint8_t* framing_extras, std::size_t framing_extras_size)
+{
+    double server_duration_us = 0;
+    std::size_t offset = 0;
+    while (offset < framing_extras_size) {
+        std::uint8_t frame_size = framing_extras[offset] & 0xfU;
+        std::uint8_t frame_id = (static_cast<std::uint32_t>(framing_extras[offset]) >> 4U) & 0xfU;
+        offset++;
+        if (frame_id == static_cast<std::uint8_t>(response_frame_info_id::server_duration)) {
+            if (frame_size == 2 && framing_extras_size - offset >= frame_size) {
+                std::uint16_t encoded_duration{};
+                std::memcpy(&encoded_duration, framing_extras + offset, sizeof(encoded_duration));
+                encoded_duration = ntohs(encoded_duration);
+                server_duration_us = std::pow(encoded_duration, 1.74) / 2;
+            }
+        }
+        offset += frame_size;
+    }
+    return server_duration_us;
+}
+
 template<typename Body>
 class client_response
 {
@@ -177,21 +204,7 @@ class client_response
         if (framing_extras_size_ == 0) {
             return;
         }
-        size_t offset = 0;
-        while (offset < framing_extras_size_) {
-            std::uint8_t frame_size = data_[offset] & 0xfU;
-            std::uint8_t frame_id = (static_cast<std::uint32_t>(data_[offset]) >> 4U) & 0xfU;
-            offset++;
-            if (frame_id == static_cast<std::uint8_t>(response_frame_info_id::server_duration)) {
-                if (frame_size == 2 && framing_extras_size_ - offset >= frame_size) {
-                    std::uint16_t encoded_duration{};
-                    std::memcpy(&encoded_duration, data_.data() + offset, sizeof(encoded_duration));
-                    encoded_duration = ntohs(encoded_duration);
-                    info_.server_duration_us = std::pow(encoded_duration, 1.74) / 2;
-                }
-            }
-            offset += frame_size;
-        }
+        info_.server_duration_us = parse_server_duration_us(data_.data(), framing_extras_size_);
     }
 
     [[nodiscard]] std::vector<std::uint8_t>& data()
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <string_view>
+
 #include <protocol/status.hxx>
 #include <protocol/client_opcode.hxx>
 #include <protocol/frame_info_id.hxx>
@@ -76,7 +78,7 @@ class insert_request_body
   private:
     std::string key_{};
     std::vector<std::uint8_t> extras_{};
-    std::vector<std::uint8_t> content_{};
+    std::string_view content_{};
     std::uint32_t flags_{};
     std::uint32_t expiration_{};
     std::vector<std::uint8_t> framing_extras_{};
@@ -110,9 +112,12 @@ class insert_request_body
         }
     }
 
+    /**
+     * The content is not copied, the caller must keep it alive until the request has been written to the socket
+     */
     void content(const std::string& content)
     {
-        content_ = { content.begin(), content.end() };
+        content_ = content;
     }
 
     void flags(uint32_t flags)
@@ -143,7 +148,7 @@ class insert_request_body
         return extras_;
     }
 
-    const std::vector<std::uint8_t>& value()
+    std::string_view value()
     {
         return content_;
     }
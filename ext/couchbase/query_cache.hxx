@@ -0,0 +1,101 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace couchbase
+{
+/**
+ * Prepared N1QL statements, that have been received from the query service, keyed by the text of the statement.
+ *
+ * The least recently used entries are evicted, when the number of entries exceeds the capacity.
+ */
+class query_cache
+{
+  public:
+    struct entry {
+        std::string name;
+        std::optional<std::string> encoded_plan{};
+    };
+
+    explicit query_cache(std::size_t capacity = 5000)
+      : capacity_(capacity)
+    {
+    }
+
+    void capacity(std::size_t capacity)
+    {
+        std::scoped_lock lock(mutex_);
+        capacity_ = capacity;
+        evict();
+    }
+
+    std::optional<entry> get(const std::string& statement)
+    {
+        std::scoped_lock lock(mutex_);
+        auto it = index_.find(statement);
+        if (it == index_.end()) {
+            return {};
+        }
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+
+    void put(const std::string& statement, entry prepared)
+    {
+        std::scoped_lock lock(mutex_);
+        if (auto it = index_.find(statement); it != index_.end()) {
+            it->second->second = std::move(prepared);
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        entries_.emplace_front(statement, std::move(prepared));
+        index_.emplace(statement, entries_.begin());
+        evict();
+    }
+
+    void erase(const std::string& statement)
+    {
+        std::scoped_lock lock(mutex_);
+        if (auto it = index_.find(statement); it != index_.end()) {
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+    }
+
+  private:
+    void evict()
+    {
+        while (entries_.size() > capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+    }
+
+    std::mutex mutex_{};
+    std::size_t capacity_;
+    std::list<std::pair<std::string, entry>> entries_{};
+    std::unordered_map<std::string, std::list<std::pair<std::string, entry>>::iterator> index_{};
+};
+} // namespace couchbase
@@ -0,0 +1,223 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <asio.hpp>
+#include <spdlog/spdlog.h>
+#include <tao/json.hpp>
+
+#include <cluster_options.hxx>
+#include <operation_timings.hxx>
+#include <service_type.hxx>
+
+namespace couchbase
+{
+/**
+ * Collects the operations, that took longer than the threshold of their service, and periodically logs the slowest of
+ * them as a single JSON report.
+ *
+ * The description of the operation is only built when it exceeds the threshold, and at most sample_size operations are
+ * kept for every service between the reports, so the tracer is cheap enough to stay enabled in production.
+ */
+class threshold_logging_tracer : public std::enable_shared_from_this<threshold_logging_tracer>
+{
+  public:
+    struct span {
+        std::string operation_name;
+        std::chrono::microseconds total_duration;
+        std::string operation_id{}; // opaque of the KV request, or client context ID of the HTTP request
+        std::string document_id{};
+        std::string remote_socket{};
+        std::optional<operation_timings> timings{}; // stages of the KV operation
+    };
+
+    threshold_logging_tracer(asio::io_context& ctx, const cluster_options& options)
+      : strand_(asio::make_strand(ctx))
+      , emit_timer_(strand_)
+      , emit_interval_(options.tracing_threshold_emit_interval)
+      , sample_size_(options.tracing_threshold_sample_size)
+    {
+        thresholds_[service_type::kv] = options.tracing_threshold_kv;
+        thresholds_[service_type::query] = options.tracing_threshold_query;
+        thresholds_[service_type::views] = options.tracing_threshold_view;
+        thresholds_[service_type::search] = options.tracing_threshold_search;
+        thresholds_[service_type::analytics] = options.tracing_threshold_analytics;
+    }
+
+    void start()
+    {
+        asio::post(strand_, [self = shared_from_this()]() { self->rearm(); });
+    }
+
+    void stop()
+    {
+        stopped_ = true;
+        // the timer is not thread-safe, and its handler might be rearming it on another IO thread
+        asio::post(strand_, [self = shared_from_this()]() { self->emit_timer_.cancel(); });
+        emit_report();
+    }
+
+    /**
+     * @return true if the operation of the service has to be reported
+     */
+    [[nodiscard]] bool exceeds_threshold(service_type service, std::chrono::microseconds total_duration) const
+    {
+        auto threshold = thresholds_.find(service);
+        return threshold != thresholds_.end() && total_duration >= threshold->second;
+    }
+
+    void report(service_type service, span&& operation)
+    {
+        if (!exceeds_threshold(service, operation.total_duration)) {
+            return;
+        }
+        std::scoped_lock lock(samples_mutex_);
+        auto& samples = samples_[service];
+        ++samples.total_count;
+        if (samples.top.size() < sample_size_) {
+            samples.top.emplace(std::move(operation));
+        } else if (samples.top.top().total_duration < operation.total_duration) {
+            samples.top.pop();
+            samples.top.emplace(std::move(operation));
+        }
+    }
+
+  private:
+    struct faster_first {
+        bool operator()(const span& lhs, const span& rhs) const
+        {
+            return lhs.total_duration > rhs.total_duration;
+        }
+    };
+
+    struct service_samples {
+        std::size_t total_count{ 0 };
+        // the fastest of the kept operations is on the top, so that it can be replaced by the slower one
+        std::priority_queue<span, std::vector<span>, faster_first> top{};
+    };
+
+    /**
+     * Must be invoked on the strand.
+     */
+    void rearm()
+    {
+        if (stopped_) {
+            return;
+        }
+        emit_timer_.expires_after(emit_interval_);
+        emit_timer_.async_wait([self = shared_from_this()](std::error_code ec) {
+            if (ec == asio::error::operation_aborted) {
+                return;
+            }
+            self->emit_report();
+            self->rearm();
+        });
+    }
+
+    static void add_duration(tao::json::value& entry,
+                             const std::string& name,
+                             operation_timings::clock::time_point start,
+                             operation_timings::clock::time_point end)
+    {
+        if (start.time_since_epoch().count() == 0 || end.time_since_epoch().count() == 0 || end < start) {
+            return;
+        }
+        entry[name] = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    }
+
+    static tao::json::value to_json(const span& operation)
+    {
+        tao::json::value entry{
+            { "operation_name", operation.operation_name },
+            { "total_duration_us", operation.total_duration.count() },
+        };
+        if (!operation.operation_id.empty()) {
+            entry["operation_id"] = operation.operation_id;
+        }
+        if (!operation.document_id.empty()) {
+            entry["document_id"] = operation.document_id;
+        }
+        if (!operation.remote_socket.empty()) {
+            entry["last_remote_socket"] = operation.remote_socket;
+        }
+        if (operation.timings) {
+            const auto& timings = operation.timings.value();
+            add_duration(entry, "queue_duration_us", timings.queued, timings.encoded);
+            add_duration(entry, "dispatch_duration_us", timings.encoded, timings.written);
+            add_duration(entry, "network_duration_us", timings.written, timings.received);
+            add_duration(entry, "decode_duration_us", timings.received, timings.decoded);
+            if (timings.server_duration) {
+                entry["server_duration_us"] = timings.server_duration->count();
+                if (const auto* network = entry.find("network_duration_us"); network != nullptr) {
+                    auto server = static_cast<std::int64_t>(timings.server_duration->count());
+                    entry["network_duration_us"] = std::max(network->as<std::int64_t>() - server, std::int64_t{ 0 });
+                }
+            }
+        }
+        return entry;
+    }
+
+    void emit_report()
+    {
+        std::map<service_type, service_samples> samples{};
+        {
+            std::scoped_lock lock(samples_mutex_);
+            std::swap(samples, samples_);
+        }
+        if (samples.empty()) {
+            return;
+        }
+        tao::json::value report = tao::json::empty_object;
+        for (auto& [service, entry] : samples) {
+            std::vector<tao::json::value> top_requests{};
+            top_requests.reserve(entry.top.size());
+            while (!entry.top.empty()) {
+                top_requests.emplace_back(to_json(entry.top.top()));
+                entry.top.pop();
+            }
+            std::reverse(top_requests.begin(), top_requests.end());
+            report[fmt::format("{}", service)] = tao::json::value{
+                { "total_count", entry.total_count },
+                { "top_requests", top_requests },
+            };
+        }
+        spdlog::info("Operations over threshold: {}", tao::json::to_string(report));
+    }
+
+    asio::strand<asio::io_context::executor_type> strand_;
+    asio::steady_timer emit_timer_; // accessed only on the strand
+    std::chrono::milliseconds emit_interval_;
+    std::size_t sample_size_;
+    std::map<service_type, std::chrono::microseconds> thresholds_{};
+    std::atomic_bool stopped_{ false };
+    std::mutex samples_mutex_{};
+    std::map<service_type, service_samples> samples_{};
+};
+} // namespace couchbase
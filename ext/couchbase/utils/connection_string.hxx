@@ -19,9 +19,13 @@
 
 #include <string>
 
+#include <spdlog/spdlog.h>
+
 #include <tao/json/external/pegtl.hpp>
 #include <tao/json/external/pegtl/contrib/uri.hpp>
 
+#include <cluster_options.hxx>
+
 namespace couchbase::utils
 {
 
@@ -48,6 +52,7 @@ struct connection_string {
     std::string scheme{};
     bool tls{ false };
     std::map<std::string, std::string> params{};
+    cluster_options options{};
     std::vector<node> bootstrap_nodes{};
 
     std::optional<std::string> default_bucket_name{};
@@ -200,6 +205,111 @@ struct action<bucket_name> {
 };
 } // namespace priv
 
+/**
+ * Parses unsigned number, that is not less than min and not greater than max. Invalid values are reported and ignored,
+ * so that the receiver keeps its default.
+ */
+static void
+parse_bounded_option(std::size_t& receiver, const std::string& name, const std::string& value, std::size_t min, std::size_t max)
+{
+    try {
+        // std::stoul silently wraps negative numbers around, so "-1" would become the largest value
+        if (value.find('-') != std::string::npos) {
+            throw std::out_of_range(name + " must not be negative");
+        }
+        std::size_t pos = 0;
+        auto parsed = std::stoul(value, &pos);
+        if (pos != value.size()) {
+            throw std::invalid_argument(name + " must be a number");
+        }
+        if (parsed < min || parsed > max) {
+            throw std::out_of_range(name + " is out of range");
+        }
+        receiver = parsed;
+    } catch (const std::logic_error& /* ex */) {
+        spdlog::warn(R"(unable to parse "{}" parameter in connection string (value "{}" is not a number between {} and {}))",
+                     name,
+                     value,
+                     min,
+                     max);
+    }
+}
+
+static void
+parse_positive_option(std::size_t& receiver, const std::string& name, const std::string& value, std::size_t max)
+{
+    parse_bounded_option(receiver, name, value, 1, max);
+}
+
+static void
+parse_non_negative_option(std::size_t& receiver, const std::string& name, const std::string& value, std::size_t max)
+{
+    parse_bounded_option(receiver, name, value, 0, max);
+}
+
+static void
+parse_duration_option(std::chrono::milliseconds& receiver, const std::string& name, const std::string& value)
+{
+    // one day is more than any timeout or interval of the library could reasonably be
+    constexpr std::size_t max_duration_ms = 24 * 60 * 60 * 1000;
+    std::size_t duration = 0;
+    parse_positive_option(duration, name, value, max_duration_ms);
+    if (duration > 0) {
+        receiver = std::chrono::milliseconds(duration);
+    }
+}
+
+static void
+extract_options(connection_string& connstr)
+{
+    connstr.options.enable_tls = connstr.tls;
+    for (const auto& [name, value] : connstr.params) {
+        if (name == "io_threads") {
+            // all IO of the single session (KV or HTTP) is serialized on its strand, so the useful number of threads is
+            // limited by the number of open sessions
+            parse_positive_option(connstr.options.io_threads, name, value, 256);
+        } else if (name == "kv_pool_size") {
+            parse_positive_option(connstr.options.kv_pool_size, name, value, 64);
+        } else if (name == "max_http_connections") {
+            parse_non_negative_option(connstr.options.max_http_connections, name, value, 4096);
+        } else if (name == "http_pool_prewarm") {
+            parse_non_negative_option(connstr.options.http_pool_prewarm, name, value, 1024);
+        } else if (name == "query_prepared_cache_size") {
+            parse_positive_option(connstr.options.query_prepared_cache_size, name, value, 1'000'000);
+        } else if (name == "idle_http_connection_timeout") {
+            parse_duration_option(connstr.options.idle_http_connection_timeout, name, value);
+        } else if (name == "tracing_threshold_kv") {
+            parse_duration_option(connstr.options.tracing_threshold_kv, name, value);
+        } else if (name == "tracing_threshold_query") {
+            parse_duration_option(connstr.options.tracing_threshold_query, name, value);
+        } else if (name == "tracing_threshold_view") {
+            parse_duration_option(connstr.options.tracing_threshold_view, name, value);
+        } else if (name == "tracing_threshold_search") {
+            parse_duration_option(connstr.options.tracing_threshold_search, name, value);
+        } else if (name == "tracing_threshold_analytics") {
+            parse_duration_option(connstr.options.tracing_threshold_analytics, name, value);
+        } else if (name == "tracing_threshold_sample_size") {
+            parse_positive_option(connstr.options.tracing_threshold_sample_size, name, value, 10'000);
+        } else if (name == "tracing_threshold_emit_interval") {
+            parse_duration_option(connstr.options.tracing_threshold_emit_interval, name, value);
+        } else if (name == "tracing_orphaned_sample_size") {
+            parse_positive_option(connstr.options.tracing_orphaned_sample_size, name, value, 10'000);
+        } else if (name == "tracing_orphaned_emit_interval") {
+            parse_duration_option(connstr.options.tracing_orphaned_emit_interval, name, value);
+        } else if (name == "trust_certificate") {
+            connstr.options.trust_certificate = value;
+        } else if (name == "tls_verify") {
+            if (value == "none") {
+                connstr.options.tls_verify = tls_verify_mode::none;
+            } else if (value == "peer") {
+                connstr.options.tls_verify = tls_verify_mode::peer;
+            } else {
+                spdlog::warn(R"(unable to parse "{}" parameter in connection string (value "{}" is not "none" or "peer"))", name, value);
+            }
+        }
+    }
+}
+
 static connection_string
 parse_connection_string(const std::string& input)
 {
@@ -226,6 +336,9 @@ parse_connection_string(const std::string& input)
             res.error = e.what();
         }
     }
+    if (!res.error) {
+        extract_options(res);
+    }
     return res;
 }
 } // namespace couchbase::utils
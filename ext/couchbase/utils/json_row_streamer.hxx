@@ -0,0 +1,208 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace couchbase::utils
+{
+/**
+ * Incremental splitter of the JSON document, that extracts elements of the top-level array while the document is still
+ * being received.
+ *
+ * The body of the query-like responses looks like {"requestID": "...", "results": [{...}, {...}], "metrics": {...}}.
+ * The streamer only tracks nesting and string boundaries, so it does not build any DOM: the raw bytes of every element
+ * of the array under rows_key are handed to the row handler as soon as the element has been closed, and the rest of the
+ * document is collected as metadata, where the array is left empty. The metadata is a valid JSON, and can be parsed
+ * with the same code as the complete body.
+ */
+class json_row_streamer
+{
+  public:
+    using row_handler = std::function<void(std::string&&)>;
+
+    json_row_streamer(std::string rows_key, row_handler handler)
+      : rows_key_(std::move(rows_key))
+      , handler_(std::move(handler))
+    {
+    }
+
+    void feed(std::string_view chunk)
+    {
+        segment_start_ = 0;
+        for (std::size_t i = 0; i < chunk.size(); ++i) {
+            char c = chunk[i];
+            if (in_string_) {
+                if (escape_) {
+                    escape_ = false;
+                } else if (c == '\\') {
+                    escape_ = true;
+                } else if (c == '"') {
+                    in_string_ = false;
+                    capturing_key_ = false;
+                } else if (capturing_key_) {
+                    key_.push_back(c);
+                }
+                continue;
+            }
+            switch (c) {
+                case ' ':
+                case '\t':
+                case '\r':
+                case '\n':
+                    break;
+
+                case '"':
+                    in_string_ = true;
+                    if (depth_ == 1 && expect_key_) {
+                        expect_key_ = false;
+                        capturing_key_ = true;
+                        key_.clear();
+                    }
+                    maybe_start_row(chunk, i);
+                    break;
+
+                case '{':
+                case '[':
+                    maybe_start_row(chunk, i);
+                    ++depth_;
+                    if (depth_ == 2 && c == '[' && key_ == rows_key_ && segment_ == segment_type::metadata) {
+                        // the opening bracket stays in metadata, the elements go to the handler
+                        switch_segment(chunk, i + 1, segment_type::none);
+                    } else if (depth_ == 1 && c == '{') {
+                        expect_key_ = true;
+                    }
+                    break;
+
+                case '}':
+                case ']':
+                    if (depth_ == 2 && in_rows()) {
+                        emit_row(chunk, i);
+                        switch_segment(chunk, i, segment_type::metadata);
+                    }
+                    --depth_;
+                    break;
+
+                case ',':
+                    if (depth_ == 2 && in_rows()) {
+                        emit_row(chunk, i);
+                    } else if (depth_ == 1) {
+                        expect_key_ = true;
+                    }
+                    break;
+
+                default:
+                    maybe_start_row(chunk, i);
+                    break;
+            }
+        }
+        flush_segment(chunk, chunk.size());
+    }
+
+    /**
+     * @return the document without the elements of the array
+     */
+    std::string metadata()
+    {
+        return std::move(metadata_);
+    }
+
+    [[nodiscard]] std::size_t number_of_rows() const
+    {
+        return number_of_rows_;
+    }
+
+  private:
+    enum class segment_type {
+        metadata,
+        row,
+        none, // separators between the elements
+    };
+
+    [[nodiscard]] bool in_rows() const
+    {
+        return segment_ == segment_type::row || segment_ == segment_type::none;
+    }
+
+    void maybe_start_row(std::string_view chunk, std::size_t position)
+    {
+        if (depth_ == 2 && segment_ == segment_type::none) {
+            switch_segment(chunk, position, segment_type::row);
+        }
+    }
+
+    void emit_row(std::string_view chunk, std::size_t position)
+    {
+        if (segment_ != segment_type::row) {
+            return;
+        }
+        switch_segment(chunk, position, segment_type::none);
+        while (!row_.empty() && (row_.back() == ' ' || row_.back() == '\t' || row_.back() == '\r' || row_.back() == '\n')) {
+            row_.pop_back();
+        }
+        ++number_of_rows_;
+        if (handler_) {
+            handler_(std::move(row_));
+        }
+        row_ = {};
+    }
+
+    void flush_segment(std::string_view chunk, std::size_t position)
+    {
+        if (position > segment_start_) {
+            switch (segment_) {
+                case segment_type::metadata:
+                    metadata_.append(chunk.substr(segment_start_, position - segment_start_));
+                    break;
+                case segment_type::row:
+                    row_.append(chunk.substr(segment_start_, position - segment_start_));
+                    break;
+                case segment_type::none:
+                    break;
+            }
+        }
+        segment_start_ = position;
+    }
+
+    void switch_segment(std::string_view chunk, std::size_t position, segment_type segment)
+    {
+        flush_segment(chunk, position);
+        segment_ = segment;
+    }
+
+    std::string rows_key_;
+    row_handler handler_;
+
+    std::size_t depth_{ 0 };
+    bool in_string_{ false };
+    bool escape_{ false };
+    bool expect_key_{ false };
+    bool capturing_key_{ false };
+    std::string key_{};
+
+    segment_type segment_{ segment_type::metadata };
+    std::size_t segment_start_{ 0 };
+    std::string metadata_{};
+    std::string row_{};
+    std::size_t number_of_rows_{ 0 };
+};
+} // namespace couchbase::utils
@@ -0,0 +1,136 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+namespace couchbase::utils
+{
+/**
+ * Lock-free histogram of latencies with logarithmic buckets, similar to HdrHistogram.
+ *
+ * Every power of two is split into sub_bucket_count linear buckets, so the recorded value is known with relative
+ * precision of 1/sub_bucket_count regardless of its magnitude, and the histogram takes fixed amount of memory. Values
+ * are recorded in microseconds, anything larger than max_value is accounted in the last bucket.
+ *
+ * Recording only increments relaxed atomic counters, so it is safe to call from any thread. The snapshot is not taken
+ * atomically across the buckets, which is acceptable for monitoring.
+ */
+class latency_histogram
+{
+  public:
+    static constexpr std::uint32_t sub_bucket_bits = 4;
+    static constexpr std::uint64_t sub_bucket_count = 1U << sub_bucket_bits;
+    static constexpr std::uint32_t max_magnitude = 36; // 2^36us is more than 19 hours
+    static constexpr std::uint64_t max_value = (std::uint64_t{ 1 } << (max_magnitude + 1)) - 1;
+    static constexpr std::size_t bucket_count = sub_bucket_count * (max_magnitude - sub_bucket_bits + 2);
+
+    struct snapshot {
+        std::uint64_t count{ 0 };
+        std::uint64_t mean_us{ 0 };
+        std::uint64_t max_us{ 0 };
+        std::map<double, std::uint64_t> percentiles_us{}; // upper bounds of the buckets for 50, 90, 99 and 99.9
+    };
+
+    void record(std::chrono::microseconds latency)
+    {
+        auto value = static_cast<std::uint64_t>(std::max(latency.count(), std::chrono::microseconds::rep{ 0 }));
+        value = std::min(value, max_value);
+        buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        auto max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @param reset whether the recorded values have to be discarded after taking the snapshot
+     */
+    snapshot take_snapshot(bool reset = false)
+    {
+        snapshot res{};
+        std::array<std::uint64_t, bucket_count> counts{};
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            counts[i] = reset ? buckets_[i].exchange(0, std::memory_order_relaxed) : buckets_[i].load(std::memory_order_relaxed);
+            res.count += counts[i];
+        }
+        auto sum = reset ? sum_.exchange(0, std::memory_order_relaxed) : sum_.load(std::memory_order_relaxed);
+        res.max_us = reset ? max_.exchange(0, std::memory_order_relaxed) : max_.load(std::memory_order_relaxed);
+        if (reset) {
+            count_.store(0, std::memory_order_relaxed);
+        }
+        if (res.count == 0) {
+            return res;
+        }
+        res.mean_us = sum / res.count;
+        std::uint64_t seen = 0;
+        std::size_t index = 0;
+        for (double percentile : { 50.0, 90.0, 99.0, 99.9 }) {
+            auto rank = static_cast<std::uint64_t>(static_cast<double>(res.count) * percentile / 100.0 + 0.5);
+            rank = std::max(rank, std::uint64_t{ 1 });
+            while (index < bucket_count && seen + counts[index] < rank) {
+                seen += counts[index++];
+            }
+            res.percentiles_us[percentile] = std::min(bucket_upper_bound(std::min(index, bucket_count - 1)), res.max_us);
+        }
+        return res;
+    }
+
+    [[nodiscard]] std::uint64_t count() const
+    {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    static std::size_t bucket_index(std::uint64_t value)
+    {
+        if (value < sub_bucket_count) {
+            return static_cast<std::size_t>(value);
+        }
+        std::uint32_t magnitude = sub_bucket_bits;
+        while ((value >> (magnitude + 1)) != 0) {
+            ++magnitude;
+        }
+        auto shift = magnitude - sub_bucket_bits;
+        auto sub_bucket = (value >> shift) - sub_bucket_count;
+        return static_cast<std::size_t>(sub_bucket_count * (shift + 1) + sub_bucket);
+    }
+
+    static std::uint64_t bucket_upper_bound(std::size_t index)
+    {
+        if (index < sub_bucket_count) {
+            return index;
+        }
+        auto shift = index / sub_bucket_count - 1;
+        auto sub_bucket = index % sub_bucket_count;
+        return ((sub_bucket_count + sub_bucket + 1) << shift) - 1;
+    }
+
+  private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> buckets_{};
+    std::atomic<std::uint64_t> count_{ 0 };
+    std::atomic<std::uint64_t> sum_{ 0 };
+    std::atomic<std::uint64_t> max_{ 0 };
+};
+} // namespace couchbase::utils
@@ -0,0 +1,153 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace couchbase::utils
+{
+template<typename Signature, std::size_t InlineSize = 48>
+class movable_function;
+
+/**
+ * Move-only replacement of std::function.
+ *
+ * Callables, that fit into InlineSize bytes and can be moved without exceptions, are stored inline, so wrapping a lambda
+ * that captures a couple of pointers does not allocate. Larger callables are stored on the heap. Unlike std::function,
+ * the callable does not need to be copyable.
+ */
+template<typename Result, typename... Args, std::size_t InlineSize>
+class movable_function<Result(Args...), InlineSize>
+{
+  public:
+    movable_function() noexcept = default;
+
+    movable_function(std::nullptr_t) noexcept
+    {
+    }
+
+    template<typename Callable,
+             typename = std::enable_if_t<!std::is_same_v<std::decay_t<Callable>, movable_function> &&
+                                         std::is_invocable_r_v<Result, std::decay_t<Callable>&, Args...>>>
+    movable_function(Callable&& callable)
+    {
+        using target_type = std::decay_t<Callable>;
+        if constexpr (fits_inline<target_type>()) {
+            new (&storage_) target_type(std::forward<Callable>(callable));
+            ops_ = &inline_ops<target_type>;
+        } else {
+            *reinterpret_cast<target_type**>(&storage_) = new target_type(std::forward<Callable>(callable));
+            ops_ = &heap_ops<target_type>;
+        }
+    }
+
+    movable_function(movable_function&& other) noexcept
+    {
+        move_from(other);
+    }
+
+    movable_function& operator=(movable_function&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    movable_function& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    movable_function(const movable_function&) = delete;
+    movable_function& operator=(const movable_function&) = delete;
+
+    ~movable_function()
+    {
+        reset();
+    }
+
+    Result operator()(Args... args)
+    {
+        return ops_->invoke(&storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ops_ != nullptr;
+    }
+
+    void reset() noexcept
+    {
+        if (ops_ != nullptr) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+  private:
+    struct operations {
+        Result (*invoke)(void* storage, Args&&... args);
+        void (*move)(void* from, void* to) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    using storage_type = std::aligned_storage_t<InlineSize, alignof(std::max_align_t)>;
+
+    template<typename T>
+    static constexpr bool fits_inline()
+    {
+        return sizeof(T) <= sizeof(storage_type) && alignof(std::max_align_t) % alignof(T) == 0 &&
+               std::is_nothrow_move_constructible_v<T>;
+    }
+
+    template<typename T>
+    static constexpr operations inline_ops{
+        [](void* storage, Args&&... args) -> Result { return (*static_cast<T*>(storage))(std::forward<Args>(args)...); },
+        [](void* from, void* to) noexcept {
+            new (to) T(std::move(*static_cast<T*>(from)));
+            static_cast<T*>(from)->~T();
+        },
+        [](void* storage) noexcept { static_cast<T*>(storage)->~T(); },
+    };
+
+    template<typename T>
+    static constexpr operations heap_ops{
+        [](void* storage, Args&&... args) -> Result { return (**static_cast<T**>(storage))(std::forward<Args>(args)...); },
+        [](void* from, void* to) noexcept { *static_cast<T**>(to) = *static_cast<T**>(from); },
+        [](void* storage) noexcept { delete *static_cast<T**>(storage); },
+    };
+
+    void move_from(movable_function& other) noexcept
+    {
+        if (other.ops_ != nullptr) {
+            other.ops_->move(&other.storage_, &storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    storage_type storage_;
+    const operations* ops_{ nullptr };
+};
+} // namespace couchbase::utils
@@ -71,38 +71,35 @@ module Couchbase
     #
     # @return [ViewQueryResult]
     def view_query(design_document_name, view_name, options = ViewOptions.new)
-      resp = @backend.document_view(@name, design_document_name, view_name, options.namespace, {
-          timeout: options.timeout,
-          scan_consistency: options.scan_consistency,
-          skip: options.skip,
-          limit: options.limit,
-          start_key: (JSON.generate(options.start_key) unless options.start_key.nil?),
-          end_key: (JSON.generate(options.end_key) unless options.end_key.nil?),
-          start_key_doc_id: options.start_key_doc_id,
-          end_key_doc_id: options.end_key_doc_id,
-          inclusive_end: options.inclusive_end,
-          group: options.group,
-          group_level: options.group_level,
-          key: (JSON.generate(options.key) unless options.key.nil?),
-          keys: options.keys&.map { |key| JSON.generate(key) },
-          order: options.order,
-          reduce: options.reduce,
-          on_error: options.on_error,
-          debug: options.debug,
-      })
+      resp = @backend.document_view(@name, design_document_name, view_name, options.namespace, view_options(options))
       ViewResult.new do |res|
-        res.meta_data = ViewMetaData.new do |meta|
-          meta.total_rows = resp[:meta][:total_rows]
-          meta.debug_info = resp[:meta][:debug_info]
-        end
-        res.rows = resp[:rows].map do |entry|
-          ViewRow.new do |row|
-            row.id = entry[:id] if entry.key?(:id)
-            row.key = JSON.parse(entry[:key])
-            row.value = JSON.parse(entry[:value])
-          end
-        end
+        res.meta_data = extract_view_meta_data(resp[:meta])
+        res.rows = resp[:rows].map { |entry| extract_view_row(entry) }
+      end
+    end
+
+    # Iterates over all rows of the view index, fetching them with pages of fixed size.
+    #
+    # Unlike paginating {#view_query} with +skip+, every page starts from the key and document ID of the last row of the
+    # previous page, so the server does not walk over the rows it has already returned, and the next page is fetched
+    # while the current one is being processed. The reduce function is never applied, +key+ and +keys+ are not
+    # supported, +skip+ is ignored and +limit+ restricts the total number of rows.
+    #
+    # @param [String] design_document_name name of the design document
+    # @param [String] view_name name of the view to query
+    # @param [ViewOptions] options
+    #
+    # @yieldparam [ViewRow] row
+    #
+    # @return [ViewMetaData, Enumerator] metadata of the last page, or enumerator of rows when block is not given
+    def view_scan(design_document_name, view_name, options = ViewOptions.new)
+      return enum_for(:view_scan, design_document_name, view_name, options) unless block_given?
+
+      meta = @backend.document_view_scan(@name, design_document_name, view_name, options.namespace,
+                                         view_options(options).merge(page_size: options.page_size)) do |entry|
+        yield extract_view_row(entry)
       end
+      extract_view_meta_data(meta)
     end
 
     # @return [Management::CollectionManager]
@@ -135,5 +132,44 @@ module Couchbase
         yield self if block_given?
       end
     end
+
+    private
+
+    def view_options(options)
+      {
+          timeout: options.timeout,
+          scan_consistency: options.scan_consistency,
+          skip: options.skip,
+          limit: options.limit,
+          start_key: (JSON.generate(options.start_key) unless options.start_key.nil?),
+          end_key: (JSON.generate(options.end_key) unless options.end_key.nil?),
+          start_key_doc_id: options.start_key_doc_id,
+          end_key_doc_id: options.end_key_doc_id,
+          inclusive_end: options.inclusive_end,
+          group: options.group,
+          group_level: options.group_level,
+          key: (JSON.generate(options.key) unless options.key.nil?),
+          keys: options.keys&.map { |key| JSON.generate(key) },
+          order: options.order,
+          reduce: options.reduce,
+          on_error: options.on_error,
+          debug: options.debug,
+      }
+    end
+
+    def extract_view_meta_data(meta)
+      ViewMetaData.new do |meta_data|
+        meta_data.total_rows = meta[:total_rows]
+        meta_data.debug_info = meta[:debug_info]
+      end
+    end
+
+    def extract_view_row(entry)
+      ViewRow.new do |row|
+        row.id = entry[:id] if entry.key?(:id)
+        row.key = JSON.parse(entry[:key])
+        row.value = JSON.parse(entry[:value])
+      end
+    end
   end
 end
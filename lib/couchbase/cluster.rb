@@ -14,6 +14,7 @@
 
 require "couchbase/authenticator"
 require "couchbase/bucket"
+require "couchbase/future"
 
 require "couchbase/management/user_manager"
 require "couchbase/management/bucket_manager"
@@ -53,56 +54,27 @@ module Couchbase
     # @param [String] statement the N1QL query statement
     # @param [QueryOptions] options the custom options for this query
     #
+    # @yieldparam [Object] row when the block given, the rows are decoded and yielded as soon as they arrive, instead of
+    #   being collected into the result (which carries only metadata in this case)
+    #
     # @return [QueryResult]
     def query(statement, options = QueryOptions.new)
-      resp = @backend.document_query(statement, {
-          timeout: options.timeout,
-          adhoc: options.adhoc,
-          client_context_id: options.client_context_id,
-          max_parallelism: options.max_parallelism,
-          readonly: options.readonly,
-          scan_wait: options.scan_wait,
-          scan_cap: options.scan_cap,
-          pipeline_batch: options.pipeline_batch,
-          pipeline_cap: options.pipeline_cap,
-          metrics: options.metrics,
-          profile: options.profile,
-          positional_parameters: options.instance_variable_get("@positional_parameters")&.map { |p| JSON.dump(p) },
-          named_parameters: options.instance_variable_get("@named_parameters")&.each_with_object({}) { |(n, v), o| o[n.to_s] = JSON.dump(v) },
-          raw_parameters: options.instance_variable_get("@raw_parameters"),
-          scan_consistency: options.instance_variable_get("@scan_consistency"),
-          mutation_state: options.instance_variable_get("@mutation_state")&.tokens&.map { |t|
-            {
-                bucket_name: t.bucket_name,
-                partition_id: t.partition_id,
-                partition_uuid: t.partition_uuid,
-                sequence_number: t.sequence_number,
-            }
-          },
-      })
+      row_handler = proc { |row| yield JSON.parse(row) } if block_given?
+      resp = @backend.document_query(statement, query_backend_options(options), &row_handler)
+      extract_query_result(resp)
+    end
 
-      QueryResult.new do |res|
-        res.meta_data = QueryMetaData.new do |meta|
-          meta.status = resp[:meta][:status]
-          meta.request_id = resp[:meta][:request_id]
-          meta.client_context_id = resp[:meta][:client_context_id]
-          meta.signature = JSON.parse(resp[:meta][:signature]) if resp[:meta][:signature]
-          meta.profile = JSON.parse(resp[:meta][:profile]) if resp[:meta][:profile]
-          meta.metrics = QueryMetrics.new do |metrics|
-            if resp[:meta][:metrics]
-              metrics.elapsed_time = resp[:meta][:metrics][:elapsed_time]
-              metrics.execution_time = resp[:meta][:metrics][:execution_time]
-              metrics.sort_count = resp[:meta][:metrics][:sort_count]
-              metrics.result_count = resp[:meta][:metrics][:result_count]
-              metrics.result_size = resp[:meta][:metrics][:result_size]
-              metrics.mutation_count = resp[:meta][:metrics][:mutation_count]
-              metrics.error_count = resp[:meta][:metrics][:error_count]
-              metrics.warning_count = resp[:meta][:metrics][:warning_count]
-            end
-          end
-          res[:warnings] = resp[:warnings].map { |warn| QueryWarning.new(warn[:code], warn[:message]) } if resp[:warnings]
-        end
-        res.instance_variable_set("@rows", resp[:rows])
+    # Performs a query against the query (N1QL) services without waiting for the response
+    #
+    # The rows are collected into the result, streaming is available only for the blocking {#query}.
+    #
+    # @param [String] statement the N1QL query statement
+    # @param [QueryOptions] options the custom options for this query
+    #
+    # @return [Future] completed with {QueryResult}
+    def query_async(statement, options = QueryOptions.new)
+      Future.new(@backend.document_query_async(statement, query_backend_options(options))) do |resp|
+        extract_query_result(resp)
       end
     end
 
@@ -111,8 +83,12 @@ module Couchbase
     # @param [String] statement the N1QL query statement
     # @param [AnalyticsOptions] options the custom options for this query
     #
+    # @yieldparam [Object] row when the block given, the rows are decoded with the transcoder and yielded as soon as they
+    #   arrive, instead of being collected into the result (which carries only metadata in this case)
+    #
     # @return [AnalyticsResult]
     def analytics_query(statement, options = AnalyticsOptions.new)
+      row_handler = proc { |row| yield options.transcoder.decode(row, 0) } if block_given?
       resp = @backend.document_analytics(statement, {
           timeout: options.timeout,
           client_context_id: options.client_context_id,
@@ -122,7 +98,7 @@ module Couchbase
           positional_parameters: options.instance_variable_get("@positional_parameters")&.map { |p| JSON.dump(p) },
           named_parameters: options.instance_variable_get("@named_parameters")&.each_with_object({}) { |(n, v), o| o[n.to_s] = JSON.dump(v) },
           raw_parameters: options.instance_variable_get("@raw_parameters"),
-      })
+      }, &row_handler)
 
       AnalyticsResult.new do |res|
         res.transcoder = options.transcoder
@@ -155,8 +131,12 @@ module Couchbase
     # @param [SearchQuery] query the query tree
     # @param [SearchOptions] options the query tree
     #
+    # @yieldparam [SearchRow] row when the block given, the hits are yielded as soon as they arrive, instead of being
+    #   collected into the result (which carries only metadata and facets in this case)
+    #
     # @return [SearchResult]
     def search_query(index_name, query, options = SearchOptions.new)
+      row_handler = proc { |r| yield extract_search_row(r, options) } if block_given?
       resp = @backend.document_search(index_name, JSON.generate(query), {
           timeout: options.timeout,
           limit: options.limit,
@@ -176,7 +156,7 @@ module Couchbase
                 sequence_number: t.sequence_number,
             }
           },
-      })
+      }, &row_handler)
 
       SearchResult.new do |res|
         res.meta_data = SearchMetaData.new do |meta|
@@ -186,29 +166,7 @@ module Couchbase
           meta.metrics.took = resp[:meta_data][:metrics][:took]
           meta.metrics.total_rows = resp[:meta_data][:metrics][:total_rows]
         end
-        res.rows = resp[:rows].map do |r|
-          SearchRow.new do |row|
-            row.transcoder = options.transcoder
-            row.index = r[:index]
-            row.id = r[:id]
-            row.score = r[:score]
-            row.fragments = r[:fragments]
-            row.locations = SearchRowLocations.new(
-                r[:locations].map do |loc|
-                  SearchRowLocation.new do |location|
-                    location.field = loc[:field]
-                    location.term = loc[:term]
-                    location.position = loc[:position]
-                    location.start_offset = loc[:start_offset]
-                    location.end_offset = loc[:end_offset]
-                    location.array_positions = loc[:array_positions]
-                  end
-                end
-            )
-            row.instance_variable_set("@fields", r[:fields])
-            row.explanation = JSON.parse(r[:explanation]) if r[:explanation]
-          end
-        end
+        res.rows = resp[:rows].map { |r| extract_search_row(r, options) }
         res.facets = resp[:facets]&.each_with_object({}) do |(k, v), o|
           facet = case options.facets[k]
                   when SearchFacet::SearchFacetTerm
@@ -297,6 +255,73 @@ module Couchbase
 
     private
 
+    def query_backend_options(options)
+      {
+          timeout: options.timeout,
+          adhoc: options.adhoc,
+          client_context_id: options.client_context_id,
+          max_parallelism: options.max_parallelism,
+          readonly: options.readonly,
+          scan_wait: options.scan_wait,
+          scan_cap: options.scan_cap,
+          pipeline_batch: options.pipeline_batch,
+          pipeline_cap: options.pipeline_cap,
+          metrics: options.metrics,
+          profile: options.profile,
+          positional_parameters: options.instance_variable_get("@positional_parameters")&.map { |p| JSON.dump(p) },
+          named_parameters: options.instance_variable_get("@named_parameters")&.each_with_object({}) { |(n, v), o| o[n.to_s] = JSON.dump(v) },
+          raw_parameters: options.instance_variable_get("@raw_parameters"),
+          scan_consistency: options.instance_variable_get("@scan_consistency"),
+          mutation_state: options.instance_variable_get("@mutation_state")&.tokens&.map { |t|
+            {
+                bucket_name: t.bucket_name,
+                partition_id: t.partition_id,
+                partition_uuid: t.partition_uuid,
+                sequence_number: t.sequence_number,
+            }
+          },
+      }
+    end
+
+    def extract_query_result(resp)
+      QueryResult.new do |res|
+        res.meta_data = QueryMetaData.new do |meta|
+          meta.status = resp[:meta][:status]
+          meta.request_id = resp[:meta][:request_id]
+          meta.client_context_id = resp[:meta][:client_context_id]
+          meta.signature = JSON.parse(resp[:meta][:signature]) if resp[:meta][:signature]
+          meta.profile = JSON.parse(resp[:meta][:profile]) if resp[:meta][:profile]
+          meta.metrics = QueryMetrics.new do |metrics|
+            if resp[:meta][:metrics]
+              metrics.elapsed_time = resp[:meta][:metrics][:elapsed_time]
+              metrics.execution_time = resp[:meta][:metrics][:execution_time]
+              metrics.sort_count = resp[:meta][:metrics][:sort_count]
+              metrics.result_count = resp[:meta][:metrics][:result_count]
+              metrics.result_size = resp[:meta][:metrics][:result_size]
+              metrics.mutation_count = resp[:meta][:metrics][:mutation_count]
+              metrics.error_count = resp[:meta][:metrics][:error_count]
+              metrics.warning_count = resp[:meta][:metrics][:warning_count]
+            end
+          end
+          res[:warnings] = resp[:warnings].map { |warn| QueryWarning.new(warn[:code], warn[:message]) } if resp[:warnings]
+        end
+        res.instance_variable_set("@rows", resp[:rows])
+      end
+    end
+
+    def extract_search_row(r, options)
+      SearchRow.new do |row|
+        row.transcoder = options.transcoder
+        row.index = r[:index]
+        row.id = r[:id]
+        row.score = r[:score]
+        row.fragments = r[:fragments]
+        row.instance_variable_set("@raw_locations", r[:locations])
+        row.instance_variable_set("@fields", r[:fields])
+        row.explanation = JSON.parse(r[:explanation]) if r[:explanation]
+      end
+    end
+
     # Initialize {Cluster} object
     #
     # @param [String] connection_string connection string used to locate the Couchbase Cluster
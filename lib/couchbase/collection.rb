@@ -15,6 +15,7 @@
 require "couchbase/errors"
 require "couchbase/collection_options"
 require "couchbase/binary_collection"
+require "couchbase/future"
 
 module Couchbase
   class Collection
@@ -58,12 +59,42 @@ module Couchbase
              else
                @backend.document_get(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout)
              end
-      GetResult.new do |res|
-        res.transcoder = options.transcoder
-        res.cas = resp[:cas]
-        res.flags = resp[:flags]
-        res.encoded = resp[:content]
-        res.expiration = resp[:expiration] if resp.key?(:expiration)
+      extract_get_result(resp, options)
+    end
+
+    # Fetches the full document from the collection without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it
+    # @param [GetOptions] options request customization, projections are not supported
+    #
+    # @return [Future] completed with {GetResult}
+    def get_async(id, options = GetOptions.new)
+      raise ArgumentError, "projections are not supported by get_async" if options.need_projected_get?
+
+      Future.new(@backend.document_get_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout)) do |resp|
+        extract_get_result(resp, options)
+      end
+    end
+
+    # Fetches multiple documents from the collection
+    #
+    # All requests are dispatched at once, so the whole batch costs roughly one round-trip
+    #
+    # @param [Array<String>] ids the list of document ids
+    # @param [GetMultiOptions] options request customization
+    #
+    # @return [Array<GetResult>] results in the same order as ids, failed entries have the error set
+    def get_multi(ids, options = GetMultiOptions.new)
+      resp = @backend.document_get_multi(bucket_name, "#{@scope_name}.#{@name}", ids, options.timeout)
+      resp.map do |entry|
+        GetResult.new do |res|
+          res.transcoder = options.transcoder
+          res.id = entry[:id]
+          res.error = entry[:error]
+          res.cas = entry[:cas]
+          res.flags = entry[:flags]
+          res.encoded = entry[:content]
+        end
       end
     end
 
@@ -76,11 +107,19 @@ module Couchbase
     # @return [GetResult]
     def get_and_lock(id, lock_time, options = GetAndLockOptions.new)
       resp = @backend.document_get_and_lock(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, lock_time)
-      GetResult.new do |res|
-        res.transcoder = options.transcoder
-        res.cas = resp[:cas]
-        res.flags = resp[:flags]
-        res.encoded = resp[:content]
+      extract_get_result(resp, options)
+    end
+
+    # Fetches the full document and write-locks it without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [Integer] lock_time how long to lock the document (values over 30 seconds will be capped)
+    # @param [GetAndLockOptions] options request customization
+    #
+    # @return [Future] completed with {GetResult}
+    def get_and_lock_async(id, lock_time, options = GetAndLockOptions.new)
+      Future.new(@backend.document_get_and_lock_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, lock_time)) do |resp|
+        extract_get_result(resp, options)
       end
     end
 
@@ -93,11 +132,19 @@ module Couchbase
     # @return [GetResult]
     def get_and_touch(id, expiration, options = GetAndTouchOptions.new)
       resp = @backend.document_get_and_touch(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, expiration)
-      GetResult.new do |res|
-        res.transcoder = options.transcoder
-        res.cas = resp[:cas]
-        res.flags = resp[:flags]
-        res.encoded = resp[:content]
+      extract_get_result(resp, options)
+    end
+
+    # Fetches a full document and resets its expiration time without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [Integer] expiration the new expiration time for the document
+    # @param [GetAndTouchOptions] options request customization
+    #
+    # @return [Future] completed with {GetResult}
+    def get_and_touch_async(id, expiration, options = GetAndTouchOptions.new)
+      Future.new(@backend.document_get_and_touch_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, expiration)) do |resp|
+        extract_get_result(resp, options)
       end
     end
 
@@ -107,15 +154,35 @@ module Couchbase
     # @param [GetAllReplicasOptions] options request customization
     #
     # @return [Array<GetReplicaResult>]
-    def get_all_replicas(id, options = GetAllReplicasOptions.new) end
+    def get_all_replicas(id, options = GetAllReplicasOptions.new)
+      resp = @backend.document_get_all_replicas(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout)
+      resp.map do |entry|
+        GetReplicaResult.new do |res|
+          res.transcoder = options.transcoder
+          res.cas = entry[:cas]
+          res.flags = entry[:flags]
+          res.encoded = entry[:content]
+          res.is_replica = entry[:is_replica]
+        end
+      end
+    end
 
-    # Reads all available replicas, and returns the first found
+    # Reads the active node and all available replicas at the same time, and returns the first copy received
     #
     # @param [String] id the document id which is used to uniquely identify it.
     # @param [GetAnyReplicaOptions] options request customization
     #
     # @return [GetReplicaResult]
-    def get_any_replica(id, options = GetAnyReplicaOptions.new) end
+    def get_any_replica(id, options = GetAnyReplicaOptions.new)
+      resp = @backend.document_get_any_replica(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout)
+      GetReplicaResult.new do |res|
+        res.transcoder = options.transcoder
+        res.cas = resp[:cas]
+        res.flags = resp[:flags]
+        res.encoded = resp[:content]
+        res.is_replica = resp[:is_replica]
+      end
+    end
 
     # Checks if the given document ID exists on the active partition.
     #
@@ -125,10 +192,18 @@ module Couchbase
     # @return [ExistsResult]
     def exists(id, options = ExistsOptions.new)
       resp = @backend.document_exists(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout)
-      ExistsResult.new do |res|
-        res.status = resp[:status]
-        res.partition_id = resp[:partition_id]
-        res.cas = resp[:cas] if res.status != :not_found
+      extract_exists_result(resp)
+    end
+
+    # Checks if the given document ID exists on the active partition without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [ExistsOptions] options request customization
+    #
+    # @return [Future] completed with {ExistsResult}
+    def exists_async(id, options = ExistsOptions.new)
+      Future.new(@backend.document_exists_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout)) do |resp|
+        extract_exists_result(resp)
       end
     end
 
@@ -139,15 +214,44 @@ module Couchbase
     #
     # @return [MutationResult]
     def remove(id, options = RemoveOptions.new)
-      resp = @backend.document_remove(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, {
-          durability_level: options.durability_level
-      })
-      MutationResult.new do |res|
-        res.cas = resp[:cas]
-        res.mutation_token = extract_mutation_token(resp)
+      resp = @backend.document_remove(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, remove_options(options))
+      extract_mutation_result(resp)
+    end
+
+    # Removes a document from the collection without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [RemoveOptions] options request customization
+    #
+    # @return [Future] completed with {MutationResult}
+    def remove_async(id, options = RemoveOptions.new)
+      Future.new(@backend.document_remove_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout,
+                                                remove_options(options))) do |resp|
+        extract_mutation_result(resp)
       end
     end
 
+    # Removes a list of the documents from the collection
+    #
+    # All requests are dispatched at once and pipelined on the connections to the nodes
+    #
+    # @param [Array<String, Array>] ids the list of document ids, or pairs of the document id and the CAS, that the
+    #   document must have to be removed
+    # @param [RemoveMultiOptions] options request customization
+    #
+    # @return [Array<MutationResult>] results in the same order as ids, failed entries have the error set
+    def remove_multi(ids, options = RemoveMultiOptions.new)
+      resp = @backend.document_mutate_multi(bucket_name, "#{@scope_name}.#{@name}", options.timeout, ids.map do |(id, cas)|
+        {
+            operation: :remove,
+            id: id,
+            cas: cas,
+            durability_level: options.durability_level,
+        }
+      end)
+      extract_mutation_multi_results(resp)
+    end
+
     # Inserts a full document which does not exist yet
     #
     # @param [String] id the document id which is used to uniquely identify it.
@@ -157,13 +261,22 @@ module Couchbase
     # @return [MutationResult]
     def insert(id, content, options = InsertOptions.new)
       blob, flags = options.transcoder.encode(content)
-      resp = @backend.document_insert(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags, {
-          durability_level: options.durability_level,
-          expiration: options.expiration,
-      })
-      MutationResult.new do |res|
-        res.cas = resp[:cas]
-        res.mutation_token = extract_mutation_token(resp)
+      resp = @backend.document_insert(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags, mutation_options(options))
+      extract_mutation_result(resp)
+    end
+
+    # Inserts a full document which does not exist yet without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [Object] content the document content to insert
+    # @param [InsertOptions] options request customization
+    #
+    # @return [Future] completed with {MutationResult}
+    def insert_async(id, content, options = InsertOptions.new)
+      blob, flags = options.transcoder.encode(content)
+      Future.new(@backend.document_insert_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags,
+                                              mutation_options(options))) do |resp|
+        extract_mutation_result(resp)
       end
     end
 
@@ -176,16 +289,96 @@ module Couchbase
     # @return [MutationResult]
     def upsert(id, content, options = UpsertOptions.new)
       blob, flags = options.transcoder.encode(content)
-      resp = @backend.document_upsert(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags, {
-          durability_level: options.durability_level,
-          expiration: options.expiration,
-      })
-      MutationResult.new do |res|
-        res.cas = resp[:cas]
-        res.mutation_token = extract_mutation_token(resp)
+      resp = @backend.document_upsert(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags, mutation_options(options))
+      extract_mutation_result(resp)
+    end
+
+    # Upserts (inserts or updates) a full document without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [Object] content the document content to upsert
+    # @param [UpsertOptions] options request customization
+    #
+    # @return [Future] completed with {MutationResult}
+    def upsert_async(id, content, options = UpsertOptions.new)
+      blob, flags = options.transcoder.encode(content)
+      Future.new(@backend.document_upsert_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags,
+                                              mutation_options(options))) do |resp|
+        extract_mutation_result(resp)
       end
     end
 
+    # Inserts a list of the documents which do not exist yet
+    #
+    # All requests are dispatched at once and pipelined on the connections to the nodes
+    #
+    # @param [Array<Array>] id_content list of the pairs, where first entry is the document id, and the second is its content
+    # @param [InsertMultiOptions] options request customization
+    #
+    # @return [Array<MutationResult>] results in the same order as id_content, failed entries have the error set
+    def insert_multi(id_content, options = InsertMultiOptions.new)
+      resp = @backend.document_mutate_multi(bucket_name, "#{@scope_name}.#{@name}", options.timeout, id_content.map do |(id, content)|
+        blob, flags = options.transcoder.encode(content)
+        {
+            operation: :insert,
+            id: id,
+            content: blob,
+            flags: flags,
+            durability_level: options.durability_level,
+            expiration: options.expiration,
+        }
+      end)
+      extract_mutation_multi_results(resp)
+    end
+
+    # Upserts (inserts or updates) a list of the documents which might or might not exist yet
+    #
+    # All requests are dispatched at once and pipelined on the connections to the nodes
+    #
+    # @param [Array<Array>] id_content list of the pairs, where first entry is the document id, and the second is its content
+    # @param [UpsertMultiOptions] options request customization
+    #
+    # @return [Array<MutationResult>] results in the same order as id_content, failed entries have the error set
+    def upsert_multi(id_content, options = UpsertMultiOptions.new)
+      resp = @backend.document_mutate_multi(bucket_name, "#{@scope_name}.#{@name}", options.timeout, id_content.map do |(id, content)|
+        blob, flags = options.transcoder.encode(content)
+        {
+            operation: :upsert,
+            id: id,
+            content: blob,
+            flags: flags,
+            durability_level: options.durability_level,
+            expiration: options.expiration,
+        }
+      end)
+      extract_mutation_multi_results(resp)
+    end
+
+    # Replaces a list of the documents which already exist
+    #
+    # All requests are dispatched at once and pipelined on the connections to the nodes
+    #
+    # @param [Array<Array>] id_content list of the tuples, where first entry is the document id, the second is its content,
+    #   and the optional third one is the CAS, that the document must have to be replaced
+    # @param [ReplaceMultiOptions] options request customization
+    #
+    # @return [Array<MutationResult>] results in the same order as id_content, failed entries have the error set
+    def replace_multi(id_content, options = ReplaceMultiOptions.new)
+      resp = @backend.document_mutate_multi(bucket_name, "#{@scope_name}.#{@name}", options.timeout, id_content.map do |(id, content, cas)|
+        blob, flags = options.transcoder.encode(content)
+        {
+            operation: :replace,
+            id: id,
+            content: blob,
+            flags: flags,
+            cas: cas,
+            durability_level: options.durability_level,
+            expiration: options.expiration,
+        }
+      end)
+      extract_mutation_multi_results(resp)
+    end
+
     # Replaces a full document which already exists
     #
     # @param [String] id the document id which is used to uniquely identify it.
@@ -195,14 +388,22 @@ module Couchbase
     # @return [MutationResult]
     def replace(id, content, options = ReplaceOptions.new)
       blob, flags = options.transcoder.encode(content)
-      resp = @backend.document_replace(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags, {
-          durability_level: options.durability_level,
-          expiration: options.expiration,
-          cas: options.cas,
-      })
-      MutationResult.new do |res|
-        res.cas = resp[:cas]
-        res.mutation_token = extract_mutation_token(resp)
+      resp = @backend.document_replace(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags, replace_options(options))
+      extract_mutation_result(resp)
+    end
+
+    # Replaces a full document which already exists without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [Object] content the document content to replace
+    # @param [ReplaceOptions] options request customization
+    #
+    # @return [Future] completed with {MutationResult}
+    def replace_async(id, content, options = ReplaceOptions.new)
+      blob, flags = options.transcoder.encode(content)
+      Future.new(@backend.document_replace_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, blob, flags,
+                                                 replace_options(options))) do |resp|
+        extract_mutation_result(resp)
       end
     end
 
@@ -215,8 +416,19 @@ module Couchbase
     # @return [MutationResult]
     def touch(id, expiration, options = TouchOptions.new)
       resp = @backend.document_touch(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, expiration)
-      MutationResult.new do |res|
-        res.cas = resp[:cas]
+      extract_mutation_result(resp)
+    end
+
+    # Update the expiration of the document without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [Integer] expiration new expiration time for the document
+    # @param [TouchOptions] options request customization
+    #
+    # @return [Future] completed with {MutationResult}
+    def touch_async(id, expiration, options = TouchOptions.new)
+      Future.new(@backend.document_touch_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, expiration)) do |resp|
+        extract_mutation_result(resp)
       end
     end
 
@@ -231,6 +443,17 @@ module Couchbase
       @backend.document_unlock(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, cas)
     end
 
+    # Unlocks a document without waiting for the response
+    #
+    # @param [String] id the document id which is used to uniquely identify it.
+    # @param [Integer] cas CAS value which is needed to unlock the document
+    # @param [UnlockOptions] options request customization
+    #
+    # @return [Future] completed with the response of the backend, or {Error::DocumentNotFound}
+    def unlock_async(id, cas, options = UnlockOptions.new)
+      Future.new(@backend.document_unlock_async(bucket_name, "#{@scope_name}.#{@name}", id, options.timeout, cas)) { |resp| resp }
+    end
+
     # Performs lookups to document fragments
     #
     # @param [String] id the document id which is used to uniquely identify it.
@@ -319,6 +542,64 @@ module Couchbase
 
     private
 
+    def mutation_options(options)
+      {
+          durability_level: options.durability_level,
+          expiration: options.expiration,
+      }
+    end
+
+    def replace_options(options)
+      mutation_options(options).merge(cas: options.cas)
+    end
+
+    def remove_options(options)
+      {
+          durability_level: options.durability_level,
+          cas: options.cas,
+      }
+    end
+
+    def extract_get_result(resp, options)
+      GetResult.new do |res|
+        res.transcoder = options.transcoder
+        res.cas = resp[:cas]
+        res.timings = resp[:timings]
+        res.flags = resp[:flags]
+        res.encoded = resp[:content]
+        res.expiration = resp[:expiration] if resp.key?(:expiration)
+      end
+    end
+
+    def extract_exists_result(resp)
+      ExistsResult.new do |res|
+        res.status = resp[:status]
+        res.partition_id = resp[:partition_id]
+        res.cas = resp[:cas] if res.status != :not_found
+      end
+    end
+
+    def extract_mutation_result(resp)
+      MutationResult.new do |res|
+        res.cas = resp[:cas]
+        res.timings = resp[:timings]
+        res.mutation_token = extract_mutation_token(resp) if resp.key?(:mutation_token)
+      end
+    end
+
+    def extract_mutation_multi_results(resp)
+      resp.map do |entry|
+        MutationResult.new do |res|
+          res.id = entry[:id]
+          res.error = entry[:error]
+          unless entry.key?(:error)
+            res.cas = entry[:cas]
+            res.mutation_token = extract_mutation_token(entry)
+          end
+        end
+      end
+    end
+
     def extract_mutation_token(resp)
       MutationToken.new do |token|
         token.partition_id = resp[:mutation_token][:partition_id]
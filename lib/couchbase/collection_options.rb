@@ -61,6 +61,17 @@ module Couchbase
       end
     end
 
+    class GetMultiOptions < CommonOptions
+      # @return [JsonTranscoder] transcoder used for decoding
+      attr_accessor :transcoder
+
+      # @yieldparam [GetMultiOptions] self
+      def initialize
+        @transcoder = JsonTranscoder.new
+        yield self if block_given?
+      end
+    end
+
     class GetAndLockOptions < CommonOptions
       # @return [JsonTranscoder] transcoder used for decoding
       attr_accessor :transcoder
@@ -112,6 +123,21 @@ module Couchbase
 
       # @return [JsonTranscoder] The default transcoder which should be used
       attr_accessor :transcoder
+
+      # @return [Hash{Symbol => Integer, nil}] durations of the stages of the operation in microseconds: +:queue+,
+      #   +:dispatch+, +:network+, +:server+, +:decode+ and +:total+
+      attr_accessor :timings
+
+      # @return [String] the document id, set for results of {Collection#get_multi}
+      attr_accessor :id
+
+      # @return [StandardError, nil] the error, if the document has not been fetched by {Collection#get_multi}
+      attr_accessor :error
+
+      # @return [Boolean] true if the document has been fetched successfully
+      def success?
+        @error.nil?
+      end
     end
 
     class GetAllReplicasOptions < CommonOptions
@@ -120,6 +146,7 @@ module Couchbase
 
       # @yieldparam [GetAllReplicasOptions] self
       def initialize
+        @transcoder = JsonTranscoder.new
         yield self if block_given?
       end
     end
@@ -130,6 +157,7 @@ module Couchbase
 
       # @yieldparam [GetAnyReplicaOptions] self
       def initialize
+        @transcoder = JsonTranscoder.new
         yield self if block_given?
       end
     end
@@ -184,6 +212,35 @@ module Couchbase
       end
     end
 
+    class RemoveMultiOptions < CommonOptions
+      # @return [:none, :majority, :majority_and_persist_to_active, :persist_to_majority] level of durability
+      attr_accessor :durability_level
+
+      # @yieldparam [RemoveMultiOptions]
+      def initialize
+        @durability_level = :none
+        yield self if block_given?
+      end
+    end
+
+    class InsertMultiOptions < CommonOptions
+      # @return [Integer] expiration time to associate with the documents
+      attr_accessor :expiration
+
+      # @return [JsonTranscoder] transcoder used for encoding
+      attr_accessor :transcoder
+
+      # @return [:none, :majority, :majority_and_persist_to_active, :persist_to_majority] level of durability
+      attr_accessor :durability_level
+
+      # @yieldparam [InsertMultiOptions]
+      def initialize
+        @transcoder = JsonTranscoder.new
+        @durability_level = :none
+        yield self if block_given?
+      end
+    end
+
     class InsertOptions < CommonOptions
       # @return [Integer] expiration time to associate with the document
       attr_accessor :expiration
@@ -220,6 +277,42 @@ module Couchbase
       end
     end
 
+    class UpsertMultiOptions < CommonOptions
+      # @return [Integer] expiration time to associate with the documents
+      attr_accessor :expiration
+
+      # @return [JsonTranscoder] transcoder used for encoding
+      attr_accessor :transcoder
+
+      # @return [:none, :majority, :majority_and_persist_to_active, :persist_to_majority] level of durability
+      attr_accessor :durability_level
+
+      # @yieldparam [UpsertMultiOptions]
+      def initialize
+        @transcoder = JsonTranscoder.new
+        @durability_level = :none
+        yield self if block_given?
+      end
+    end
+
+    class ReplaceMultiOptions < CommonOptions
+      # @return [Integer] expiration time to associate with the documents
+      attr_accessor :expiration
+
+      # @return [JsonTranscoder] transcoder used for encoding
+      attr_accessor :transcoder
+
+      # @return [:none, :majority, :majority_and_persist_to_active, :persist_to_majority] level of durability
+      attr_accessor :durability_level
+
+      # @yieldparam [ReplaceMultiOptions]
+      def initialize
+        @transcoder = JsonTranscoder.new
+        @durability_level = :none
+        yield self if block_given?
+      end
+    end
+
     class ReplaceOptions < CommonOptions
       # @return [Integer] expiration time to associate with the document
       attr_accessor :expiration
@@ -248,6 +341,21 @@ module Couchbase
       # @return [MutationToken] if returned, holds the mutation token of the document after the mutation
       attr_accessor :mutation_token
 
+      # @return [Hash{Symbol => Integer, nil}] durations of the stages of the operation in microseconds: +:queue+,
+      #   +:dispatch+, +:network+, +:server+, +:decode+ and +:total+
+      attr_accessor :timings
+
+      # @return [String] the document id, set for results of {Collection#upsert_multi} and {Collection#remove_multi}
+      attr_accessor :id
+
+      # @return [StandardError, nil] the error, if the document has not been mutated by the batch operation
+      attr_accessor :error
+
+      # @return [Boolean] true if the document has been mutated successfully
+      def success?
+        @error.nil?
+      end
+
       # @yieldparam [MutationResult] self
       def initialize
         yield self if block_given?
@@ -0,0 +1,69 @@
+#    Copyright 2020 Couchbase, Inc.
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+module Couchbase
+  # Pending result of the operation, that has been dispatched without waiting for the response
+  #
+  # The response is converted into the same result object, that the blocking version of the method returns.
+  class Future
+    # @api private
+    #
+    # @param [Backend::Future] backend_future future returned by the backend
+    # @yieldparam [Hash] resp raw response of the backend
+    # @yieldreturn [Object] result of the operation
+    def initialize(backend_future, &converter)
+      @backend_future = backend_future
+      @converter = converter
+    end
+
+    # @return [Boolean] true if the response has arrived already
+    def completed?
+      @backend_future.completed?
+    end
+
+    # Waits for the response without holding GVL
+    #
+    # @raise [Error::CouchbaseError] if the operation has failed
+    #
+    # @return [Object] result of the operation
+    def value
+      @converter.call(@backend_future.wait)
+    end
+
+    # Registers the block, that will be invoked once the response arrives (immediately, if it has arrived already)
+    #
+    # The block is executed on the dispatcher thread of the cluster, so it should not block for long.
+    #
+    # @yieldparam [Object, nil] result result of the operation, or nil if it has failed
+    # @yieldparam [Exception, nil] error the error, or nil if the operation has succeeded
+    #
+    # @return [Future] self
+    def on_complete
+      @backend_future.on_complete do |resp, error|
+        if error
+          yield nil, error
+        else
+          begin
+            result = @converter.call(resp)
+          rescue StandardError => e
+            yield nil, e
+          else
+            yield result, nil
+          end
+        end
+      end
+      self
+    end
+  end
+end
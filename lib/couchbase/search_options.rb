@@ -12,6 +12,8 @@
 #  See the License for the specific language governing permissions and
 #  limitations under the License.
 
+require "json"
+
 module Couchbase
   class Cluster
     class SearchQuery
@@ -1237,6 +1239,11 @@ module Couchbase
 
       # @return [Array<Integer>] the positions of the term within any elements.
       attr_accessor :array_positions
+
+      # @yieldparam [SearchRowLocation] self
+      def initialize
+        yield self if block_given?
+      end
     end
 
     class SearchRowLocations
@@ -1415,7 +1422,26 @@ module Couchbase
       attr_accessor :score
 
       # @return [SearchRowLocations]
-      attr_accessor :locations
+      def locations
+        @locations ||= SearchRowLocations.new(
+            (@raw_locations ? JSON.parse(@raw_locations) : {}).flat_map do |field, terms|
+              terms.flat_map do |term, entries|
+                entries.map do |entry|
+                  SearchRowLocation.new do |location|
+                    location.field = field
+                    location.term = term
+                    location.position = entry["pos"]
+                    location.start_offset = entry["start"]
+                    location.end_offset = entry["end"]
+                    location.array_positions = entry["array_positions"]
+                  end
+                end
+              end
+            end
+        )
+      end
+
+      attr_writer :locations
 
       # @return [Hash]
       attr_accessor :explanation
@@ -1433,6 +1459,7 @@ module Couchbase
       # @yieldparam [SearchRow] self
       def initialize
         @fields = nil
+        @raw_locations = nil
         yield self if block_given?
       end
     end
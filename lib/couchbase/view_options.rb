@@ -92,6 +92,10 @@ module Couchbase
       # @return [:production, :development]
       attr_accessor :namespace
 
+      # Specifies the number of rows fetched with single request by {Bucket#view_scan}
+      # @return [Integer]
+      attr_accessor :page_size
+
       # @yieldparam [ViewQueryOptions] self
       def initialize
         @namespace = :production
@@ -83,6 +83,34 @@ module Couchbase
       end
     end
 
+    def test_operation_timings
+      doc_id = uniq_id(:foo)
+      res = @collection.upsert(doc_id, {"value" => 42})
+      assert_kind_of Integer, res.timings[:total]
+
+      res = @collection.get(doc_id)
+      assert_kind_of Integer, res.timings[:total]
+      assert_operator res.timings[:total], :>=, res.timings[:decode]
+    end
+
+    def test_replica_reads
+      doc_id = uniq_id(:foo)
+      document = {"value" => 42}
+      @collection.upsert(doc_id, document)
+
+      res = @collection.get_any_replica(doc_id)
+      assert_equal document, res.content
+
+      res = @collection.get_all_replicas(doc_id)
+      refute_empty res
+      assert(res.any? { |r| !r.replica? })
+      res.each { |r| assert_equal document, r.content }
+
+      assert_raises(Couchbase::Error::DocumentIrretrievable) do
+        @collection.get_any_replica(uniq_id(:missing))
+      end
+    end
+
     def test_exists_allows_to_check_document_existence
       doc_id = uniq_id(:foo)
 
@@ -296,6 +324,142 @@ module Couchbase
       end
     end
 
+    def test_get_multi_fetches_documents_in_order
+      present_id = uniq_id(:foo)
+      missing_id = uniq_id(:missing)
+      @collection.upsert(present_id, {"value" => 42})
+
+      res = @collection.get_multi([present_id, missing_id])
+      assert_equal [present_id, missing_id], res.map(&:id)
+      assert res[0].success?
+      assert_equal({"value" => 42}, res[0].content)
+      refute res[1].success?
+      assert_kind_of Couchbase::Error::DocumentNotFound, res[1].error
+    end
+
+    def test_upsert_multi_and_remove_multi
+      ids = Array.new(10) { |i| uniq_id("batch_#{i}") }
+
+      res = @collection.upsert_multi(ids.map { |id| [id, {"id" => id}] })
+      assert_equal ids, res.map(&:id)
+      assert res.all?(&:success?)
+      res.each { |r| refute_equal 0, r.cas }
+      assert_equal({"id" => ids[3]}, @collection.get(ids[3]).content)
+
+      missing_id = uniq_id(:missing)
+      res = @collection.remove_multi(ids + [missing_id])
+      assert res.take(ids.size).all?(&:success?)
+      assert_kind_of Couchbase::Error::DocumentNotFound, res.last.error
+      assert_raises(Couchbase::Error::DocumentNotFound) do
+        @collection.get(ids[3])
+      end
+    end
+
+    def test_insert_multi_and_replace_multi_with_cas
+      ids = Array.new(3) { |i| uniq_id("batch_#{i}") }
+
+      res = @collection.insert_multi(ids.map { |id| [id, {"value" => 1}] })
+      assert res.all?(&:success?)
+      res = @collection.insert_multi([[ids[0], {"value" => 2}]])
+      assert_kind_of Couchbase::Error::DocumentExists, res[0].error
+
+      res = @collection.replace_multi([[ids[0], {"value" => 2}], [ids[1], {"value" => 2}, 1]])
+      assert res[0].success?
+      assert_kind_of Couchbase::Error::CasMismatch, res[1].error
+      cas = res[0].cas
+      assert_equal({"value" => 2}, @collection.get(ids[0]).content)
+
+      res = @collection.remove_multi([[ids[0], cas + 1], ids[1]])
+      assert_kind_of Couchbase::Error::CasMismatch, res[0].error
+      assert res[1].success?
+      res = @collection.remove_multi([[ids[0], cas], ids[2]])
+      assert res.all?(&:success?)
+    end
+
+    def test_remove_supports_optimistic_locking
+      doc_id = uniq_id(:foo)
+      cas = @collection.upsert(doc_id, {"value" => 42}).cas
+
+      options = Collection::RemoveOptions.new
+      options.cas = cas + 1 # incorrect CAS
+      assert_raises(Couchbase::Error::CasMismatch) do
+        @collection.remove(doc_id, options)
+      end
+
+      options.cas = cas # correct CAS
+      @collection.remove(doc_id, options)
+      assert_raises(Couchbase::Error::DocumentNotFound) do
+        @collection.get(doc_id)
+      end
+    end
+
+    def test_async_mutations_and_get
+      doc_id = uniq_id(:foo)
+
+      res = @collection.insert_async(doc_id, {"value" => 1}).value
+      refute_equal 0, res.cas
+      res = @collection.upsert_async(doc_id, {"value" => 2}).value
+      res = @collection.replace_async(doc_id, {"value" => 3}, Collection::ReplaceOptions.new.tap { |o| o.cas = res.cas }).value
+      refute_nil res.mutation_token
+
+      future = @collection.get_async(doc_id)
+      assert_equal({"value" => 3}, future.value.content)
+      assert future.completed?
+
+      assert_equal :found, @collection.exists_async(doc_id).value.status
+      @collection.remove_async(doc_id).value
+      assert_raises(Couchbase::Error::DocumentNotFound) do
+        @collection.get_async(doc_id).value
+      end
+    end
+
+    def test_async_lock_touch_and_unlock
+      doc_id = uniq_id(:foo)
+      @collection.upsert(doc_id, {"value" => 42})
+
+      res = @collection.get_and_lock_async(doc_id, 10).value
+      assert_equal({"value" => 42}, res.content)
+      @collection.unlock_async(doc_id, res.cas).value
+
+      res = @collection.get_and_touch_async(doc_id, 100).value
+      assert_equal({"value" => 42}, res.content)
+      refute_equal 0, @collection.touch_async(doc_id, 100).value.cas
+    end
+
+    def test_async_dispatches_all_requests_before_waiting
+      ids = Array.new(10) { |i| uniq_id("async_#{i}") }
+
+      futures = ids.map { |id| @collection.upsert_async(id, {"id" => id}) }
+      assert futures.map(&:value).all? { |r| r.cas != 0 }
+
+      futures = ids.map { |id| @collection.get_async(id) }
+      assert_equal(ids.map { |id| {"id" => id} }, futures.map { |f| f.value.content })
+    end
+
+    def test_async_on_complete_yields_result_or_error
+      doc_id = uniq_id(:foo)
+      @collection.upsert(doc_id, {"value" => 42})
+
+      queue = Queue.new
+      @collection.get_async(doc_id).on_complete { |res, err| queue << [res, err] }
+      res, err = queue.pop
+      assert_nil err
+      assert_equal({"value" => 42}, res.content)
+
+      @collection.get_async(uniq_id(:missing)).on_complete { |res, err| queue << [res, err] }
+      res, err = queue.pop
+      assert_nil res
+      assert_kind_of Couchbase::Error::DocumentNotFound, err
+    end
+
+    def test_get_async_rejects_projections
+      options = Collection::GetOptions.new
+      options.project("foo")
+      assert_raises(ArgumentError) do
+        @collection.get_async(uniq_id(:foo), options)
+      end
+    end
+
     def test_error_double_insert
       doc_id = uniq_id(:does_not_exist)
 
@@ -41,6 +41,102 @@ module Couchbase
       assert_equal "ruby rules", res.rows.first["greeting"]
     end
 
+    def test_streaming_rows
+      rows = []
+      res = @cluster.query('SELECT RAW i FROM ARRAY_RANGE(0, 5) AS i') { |row| rows << row }
+      assert_equal [0, 1, 2, 3, 4], rows
+      assert_empty res.rows.to_a
+      assert_equal :success, res.meta_data.status
+    end
+
+    def test_search_row_decodes_locations
+      row = Cluster::SearchRow.new do |r|
+        r.instance_variable_set("@raw_locations", JSON.generate({
+            "name" => {"ruby" => [{"pos" => 1, "start" => 0, "end" => 4, "array_positions" => nil}]},
+            "tags" => {"fast" => [{"pos" => 1, "start" => 0, "end" => 4, "array_positions" => [0]},
+                                  {"pos" => 1, "start" => 0, "end" => 4, "array_positions" => [2]}]},
+        }))
+      end
+
+      assert_equal 3, row.locations.get_all.size
+      assert_equal %w[name tags], row.locations.fields
+      location = row.locations.get_for_field_and_term("name", "ruby").first
+      assert_equal "name", location.field
+      assert_equal "ruby", location.term
+      assert_equal 1, location.position
+      assert_equal 0, location.start_offset
+      assert_equal 4, location.end_offset
+      assert_equal [[0], [2]], row.locations.get_for_field("tags").map(&:array_positions)
+      assert_empty Cluster::SearchRow.new.locations.get_all
+    end
+
+    def test_search_query_streams_rows
+      index_name = uniq_id(:search).tr(".", "_")
+      @cluster.search_indexes.upsert_index(Management::SearchIndex.new do |index|
+        index.name = index_name
+        index.type = "fulltext-index"
+        index.source_type = "couchbase"
+        index.source_name = @bucket.name
+      end)
+      term = uniq_id(:term).delete("._") # single token for the standard analyzer
+      doc_ids = Array.new(3) { |i| uniq_id("search_#{i}") }
+      doc_ids.each { |id| @collection.upsert(id, {"name" => "ruby #{term}"}) }
+
+      options = Cluster::SearchOptions.new
+      options.highlight_style = :html
+      rows = []
+      res = nil
+      30.times do
+        rows = []
+        begin
+          res = @cluster.search_query(index_name, Cluster::SearchQuery.match(term), options) { |row| rows << row }
+        rescue StandardError
+          # the index has not been planned yet
+          res = nil
+        end
+        break if rows.size == doc_ids.size
+
+        sleep(1)
+      end
+
+      refute_nil res
+      assert_equal doc_ids.sort, rows.map(&:id).sort
+      assert_empty res.rows
+      assert_equal doc_ids.size, res.meta_data.metrics.total_rows
+      rows.each do |row|
+        location = row.locations.get_for_field_and_term("name", term).first
+        refute_nil location
+        assert_equal 2, location.position
+        assert_equal 5, location.start_offset
+        assert_equal 5 + term.size, location.end_offset
+      end
+    ensure
+      @cluster.search_indexes.drop_index(index_name) if index_name
+    end
+
+    def test_query_async
+      future = @cluster.query_async('SELECT "ruby rules" AS greeting')
+      res = future.value
+      assert_equal "ruby rules", res.rows.first["greeting"]
+      assert_equal :success, res.meta_data.status
+    end
+
+    def test_query_async_raises_parsing_error
+      assert_raises(Error::ParsingFailure) do
+        @cluster.query_async("BAD QUERY").value
+      end
+    end
+
+    def test_prepared_query
+      options = Cluster::QueryOptions.new
+      options.adhoc = false
+      options.named_parameters({"greeting" => "ruby rules"})
+      2.times do
+        res = @cluster.query('SELECT $greeting AS greeting', options)
+        assert_equal "ruby rules", res.rows.first["greeting"]
+      end
+    end
+
     def test_query_with_metrics
       options = Cluster::QueryOptions.new
       options.metrics = true
@@ -0,0 +1,88 @@
+#    Copyright 2020 Couchbase, Inc.
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+
+require_relative "test_helper"
+
+module Couchbase
+  class ViewTest < Minitest::Test
+    def setup
+      options = Cluster::ClusterOptions.new
+      options.authenticate(TEST_USERNAME, TEST_PASSWORD)
+      @cluster = Cluster.connect(TEST_CONNECTION_STRING, options)
+      @bucket = @cluster.bucket(TEST_BUCKET)
+      @collection = @bucket.default_collection
+    end
+
+    def teardown
+      @cluster.disconnect
+    end
+
+    def uniq_id(name)
+      "#{name}_#{Time.now.to_f}"
+    end
+
+    def create_design_document(type)
+      design_document = Management::DesignDocument.new do |ddoc|
+        ddoc.name = type
+        # every key is emitted for two documents, so that the pages end between the rows with the same key
+        map = "function (doc, meta) { if (doc.type == \"#{type}\") { emit(Math.floor(doc.num / 2), null); } }"
+        ddoc.views = {"by_pair" => Management::View.new(map)}
+      end
+      @bucket.view_indexes.upsert_design_document(design_document, :production)
+    end
+
+    def scan(design_document_name, options)
+      10.times do
+        return @bucket.view_scan(design_document_name, "by_pair", options).to_a
+      rescue Error::DesignDocumentNotFound, Error::ViewNotFound
+        # the design document has not been propagated to all nodes yet
+        sleep(1)
+      end
+      flunk("design document #{design_document_name} is not available")
+    end
+
+    def test_view_scan_paginates_across_page_boundaries
+      type = uniq_id(:view_scan).delete(".")
+      ids = Array.new(7) { |i| "#{type}_#{i}" }
+      ids.each_with_index { |id, i| @collection.upsert(id, {"type" => type, "num" => i}) }
+      create_design_document(type)
+
+      options = Bucket::ViewOptions.new
+      options.scan_consistency = :request_plus
+      options.page_size = 3
+      rows = scan(type, options)
+      assert_equal ids, rows.map(&:id)
+      assert_equal [0, 0, 1, 1, 2, 2, 3], rows.map(&:key)
+
+      options.limit = 5
+      rows = scan(type, options)
+      assert_equal ids.take(5), rows.map(&:id)
+
+      meta = @bucket.view_scan(type, "by_pair", options) { |row| refute_nil row.id }
+      assert_kind_of Bucket::ViewMetaData, meta
+    ensure
+      @bucket.view_indexes.drop_design_document(type, :production) if type
+    end
+
+    def test_view_scan_rejects_non_positive_page_size
+      [0, -1].each do |page_size|
+        options = Bucket::ViewOptions.new
+        options.page_size = page_size
+        assert_raises(ArgumentError) do
+          @bucket.view_scan("does_not_exist", "by_pair", options) { |_row| flunk("no rows expected") }
+        end
+      end
+    end
+  end
+end